@@ -1,12 +1,20 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "AssetManager_Custom.h"
+#include "Item.h"
+#include "Engine/AssetManagerSettings.h"
 
 const FPrimaryAssetType	UAssetManager_Custom::InventoryItem = TEXT("InventoryItem");
+const FItemId UAssetManager_Custom::InvalidItemId = 0;
+
+TArray<TArray<FItemDefinition, TAlignedHeapAllocator<PLATFORM_CACHE_LINE_SIZE>>> UAssetManager_Custom::ItemDefinitionBlocks;
+const FItemDefinition UAssetManager_Custom::EmptyItemDefinition;
 
 UAssetManager_Custom::UAssetManager_Custom()
 {
-	
+	ItemRegistryHash = 0;
+	bIsItemRegistryBuilt = false;
+	bUseItemManifest = false;
 }
 
 UAssetManager_Custom& UAssetManager_Custom::Get()
@@ -26,15 +34,47 @@ UAssetManager_Custom& UAssetManager_Custom::Get()
 
 void UAssetManager_Custom::StartInitialLoading()
 {
+#if !WITH_EDITOR
+	// the editor always scans, items are created and edited there
+	bUseItemManifest = ItemManifest.LoadFromFile(FItemManifest::GetDefaultFilename()) && ItemManifest.Items.Num() > 0;
+#endif
+
 	Super::StartInitialLoading();
 }
 
-UAssetManager_Custom* UAssetManager_Custom::ForceLoadItem(const FPrimaryAssetId& PrimaryAssetId, const bool bLogWarning) const
+void UAssetManager_Custom::PostInitialAssetScan()
+{
+	Super::PostInitialAssetScan();
+
+	BuildItemRegistry();
+}
+
+void UAssetManager_Custom::ScanPrimaryAssetTypesFromConfig()
+{
+	Super::ScanPrimaryAssetTypesFromConfig();
+
+	if (bUseItemManifest)
+	{
+		RegisterManifestItems();
+	}
+}
+
+bool UAssetManager_Custom::ShouldScanPrimaryAssetType(FPrimaryAssetTypeInfo& TypeInfo) const
+{
+	if (bUseItemManifest && TypeInfo.PrimaryAssetType == InventoryItem)
+	{
+		return false;
+	}
+
+	return Super::ShouldScanPrimaryAssetType(TypeInfo);
+}
+
+UItem* UAssetManager_Custom::ForceLoadItem(const FPrimaryAssetId& PrimaryAssetId, const bool bLogWarning) const
 {
 	const FSoftObjectPath ItemPath = GetPrimaryAssetPath(PrimaryAssetId);
 
 	// This does a synchronous load and may hitch
-	UAssetManager_Custom* LoadedItem = Cast<UAssetManager_Custom>(ItemPath.TryLoad());
+	UItem* LoadedItem = Cast<UItem>(ItemPath.TryLoad());
 
 	if (bLogWarning && LoadedItem == nullptr)
 	{
@@ -43,3 +83,221 @@ UAssetManager_Custom* UAssetManager_Custom::ForceLoadItem(const FPrimaryAssetId&
 
 	return LoadedItem;
 }
+
+TSharedPtr<FStreamableHandle> UAssetManager_Custom::LoadItems(const TArray<FPrimaryAssetId>& ItemIds, const TArray<FName>& Bundles, FOnItemsLoaded OnItemsLoaded, const TAsyncLoadPriority Priority)
+{
+	TArray<FPrimaryAssetId> ValidItemIds;
+	ValidItemIds.Reserve(ItemIds.Num());
+
+	for (const FPrimaryAssetId& ItemId: ItemIds)
+	{
+		if (ItemId.PrimaryAssetType == InventoryItem && GetPrimaryAssetPath(ItemId).IsValid())
+		{
+			ValidItemIds.AddUnique(ItemId);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Skipping unknown item identifier %s in async item load!"), *ItemId.ToString());
+		}
+	}
+
+	const FStreamableDelegate OnLoaded = FStreamableDelegate::CreateLambda([this, ValidItemIds, OnItemsLoaded]()
+	{
+		TArray<UItem*> LoadedItems;
+		LoadedItems.Reserve(ValidItemIds.Num());
+
+		for (const FPrimaryAssetId& ItemId: ValidItemIds)
+		{
+			UItem* LoadedItem = GetPrimaryAssetObject<UItem>(ItemId);
+			if (LoadedItem)
+			{
+				LoadedItems.Add(LoadedItem);
+			}
+		}
+
+		OnItemsLoaded.ExecuteIfBound(LoadedItems);
+	});
+
+	return LoadPrimaryAssets(ValidItemIds, Bundles, OnLoaded, Priority);
+}
+
+TSharedPtr<FStreamableHandle> UAssetManager_Custom::LoadAllItems(const TArray<FName>& Bundles, FOnItemsLoaded OnItemsLoaded, const TAsyncLoadPriority Priority)
+{
+	TArray<FPrimaryAssetId> ItemIds;
+	GetPrimaryAssetIdList(InventoryItem, ItemIds);
+
+	return LoadItems(ItemIds, Bundles, OnItemsLoaded, Priority);
+}
+
+FItemId UAssetManager_Custom::GetItemId(const FPrimaryAssetId& PrimaryAssetId) const
+{
+	const FItemId* ItemId = ItemIds.Find(PrimaryAssetId);
+	return ItemId ? *ItemId : InvalidItemId;
+}
+
+FPrimaryAssetId UAssetManager_Custom::GetItemPrimaryAssetId(const FItemId ItemId) const
+{
+	if (ItemId == InvalidItemId || !RegisteredItems.IsValidIndex(ItemId))
+	{
+		return FPrimaryAssetId();
+	}
+
+	return RegisteredItems[ItemId];
+}
+
+UItem* UAssetManager_Custom::GetLoadedItem(const FItemId ItemId) const
+{
+	const FPrimaryAssetId PrimaryAssetId = GetItemPrimaryAssetId(ItemId);
+	return PrimaryAssetId.IsValid() ? GetPrimaryAssetObject<UItem>(PrimaryAssetId) : nullptr;
+}
+
+FItemId UAssetManager_Custom::RegisterItem(const FPrimaryAssetId& PrimaryAssetId)
+{
+	if (!bIsItemRegistryBuilt || PrimaryAssetId.PrimaryAssetType != InventoryItem)
+	{
+		return InvalidItemId;
+	}
+
+	const FItemId* ExistingItemId = ItemIds.Find(PrimaryAssetId);
+	if (ExistingItemId)
+	{
+		return *ExistingItemId;
+	}
+
+	if (RegisteredItems.Num() > MAX_uint16)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to register item %s, the item registry is full!"), *PrimaryAssetId.ToString());
+		return InvalidItemId;
+	}
+
+	const FItemId ItemId = static_cast<FItemId>(RegisteredItems.Add(PrimaryAssetId));
+	ItemIds.Add(PrimaryAssetId, ItemId);
+	AddItemDefinition();
+
+	return ItemId;
+}
+
+int32 UAssetManager_Custom::GetNumRegisteredItems() const
+{
+	return FMath::Max(RegisteredItems.Num() - 1, 0);
+}
+
+void UAssetManager_Custom::BuildItemRegistry()
+{
+	TArray<FPrimaryAssetId> ScannedItems;
+	GetPrimaryAssetIdList(InventoryItem, ScannedItems);
+
+	ScannedItems.Sort([](const FPrimaryAssetId& A, const FPrimaryAssetId& B)
+	{
+		return A.PrimaryAssetName.LexicalLess(B.PrimaryAssetName);
+	});
+
+	RegisteredItems.Reset(ScannedItems.Num() + 1);
+	ItemIds.Reset();
+	ItemRegistryHash = 0;
+
+	// one block per 256 identifiers at most, the block array itself never moves either
+	ItemDefinitionBlocks.Empty(FMath::DivideAndRoundUp(MAX_uint16 + 1, ItemDefinitionsPerBlock));
+
+	RegisteredItems.Add(FPrimaryAssetId());
+	AddItemDefinition();
+	bIsItemRegistryBuilt = true;
+
+	for (const FPrimaryAssetId& ScannedItem: ScannedItems)
+	{
+		if (RegisterItem(ScannedItem) == InvalidItemId)
+		{
+			break;
+		}
+
+		ItemRegistryHash = FCrc::StrCrc32(*ScannedItem.ToString(), ItemRegistryHash);
+	}
+
+	if (bUseItemManifest)
+	{
+		if (ItemManifest.RegistryHash != ItemRegistryHash)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Item manifest was written for another item registry, run the ItemManifest commandlet again!"));
+		}
+
+		for (const FItemManifestEntry& Entry: ItemManifest.Items)
+		{
+			const FItemId ItemId = GetItemId(FPrimaryAssetId(InventoryItem, Entry.AssetName));
+			if (ItemId != InvalidItemId)
+			{
+				ItemDefinitionBlocks[ItemId / ItemDefinitionsPerBlock][ItemId % ItemDefinitionsPerBlock] = Entry.Definition;
+			}
+		}
+
+		ItemManifest.Items.Empty();
+	}
+
+	// items loaded before the scan, the others bake their definition once they are loaded
+	for (const FPrimaryAssetId& ScannedItem: ScannedItems)
+	{
+		const UItem* LoadedItem = GetPrimaryAssetObject<UItem>(ScannedItem);
+		if (LoadedItem)
+		{
+			UpdateItemDefinition(LoadedItem);
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Registered %d inventory items, registry hash %08x"), GetNumRegisteredItems(), ItemRegistryHash);
+}
+
+void UAssetManager_Custom::UpdateItemDefinition(const UItem* Item)
+{
+	if (Item == nullptr)
+	{
+		return;
+	}
+
+	const FPrimaryAssetId PrimaryAssetId = Item->GetPrimaryAssetId();
+
+	FItemId ItemId = GetItemId(PrimaryAssetId);
+	if (ItemId == InvalidItemId)
+	{
+		ItemId = RegisterItem(PrimaryAssetId);
+	}
+
+	if (ItemId == InvalidItemId)
+	{
+		return;
+	}
+
+	ItemDefinitionBlocks[ItemId / ItemDefinitionsPerBlock][ItemId % ItemDefinitionsPerBlock] = Item->BakeDefinition();
+	Item->CachedItemId = ItemId;
+}
+
+void UAssetManager_Custom::AddItemDefinition()
+{
+	if (ItemDefinitionBlocks.Num() == 0 || ItemDefinitionBlocks.Last().Num() == ItemDefinitionsPerBlock)
+	{
+		ItemDefinitionBlocks.AddDefaulted_GetRef().Reserve(ItemDefinitionsPerBlock);
+	}
+
+	ItemDefinitionBlocks.Last().AddDefaulted();
+}
+
+void UAssetManager_Custom::RegisterManifestItems()
+{
+	const UAssetManagerSettings& Settings = GetSettings();
+
+	for (const FPrimaryAssetTypeInfo& TypeInfo: Settings.PrimaryAssetTypesToScan)
+	{
+		if (TypeInfo.PrimaryAssetType == InventoryItem)
+		{
+			// no paths, this only registers the type so its assets can be added below
+			ScanPathsForPrimaryAssets(InventoryItem, TArray<FString>(), UItem::StaticClass(), false, false, false);
+			SetPrimaryAssetTypeRules(InventoryItem, TypeInfo.Rules);
+			break;
+		}
+	}
+
+	for (const FItemManifestEntry& Entry: ItemManifest.Items)
+	{
+		AddDynamicAsset(FPrimaryAssetId(InventoryItem, Entry.AssetName), Entry.AssetPath, Entry.BundleData);
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Registered %d inventory items from the item manifest"), ItemManifest.Items.Num());
+}
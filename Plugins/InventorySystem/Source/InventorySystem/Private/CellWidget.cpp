@@ -3,7 +3,6 @@
 #include "CellWidget.h"
 #include "DraggedSlotWidget.h"
 #include "GridWidget.h"
-#include "ItemInstance.h"
 #include "SlotWidget.h"
 #include "Blueprint/DragDropOperation.h"
 #include "Blueprint/WidgetLayoutLibrary.h"
@@ -57,9 +56,12 @@ void UCellWidget::OnItemRotated()
 	// 	}
 	// }
 
-	if (ParentWidget->Inventory->DoesItemFit(DraggedSlotWidget->InventorySlot.ItemInstance->SizeInCells, Coordinates))
+	const FItemInstanceData& DraggedInstance = DraggedSlotWidget->InventorySlot.Instance;
+	const TArray<FPoint2D> SizeInCells = DraggedInstance.GetSizeInCells();
+
+	if (ParentWidget->Inventory->DoesSizeFit(DraggedInstance.Size, Coordinates))
 	{
-		for (const FPoint2D& Cell: DraggedSlotWidget->InventorySlot.ItemInstance->SizeInCells)
+		for (const FPoint2D& Cell: SizeInCells)
 		{
 			FPoint2D TargetCell = Cell + Coordinates;
 			const int32 CellIndex = ParentWidget->GetCellIndex(TargetCell);
@@ -72,7 +74,7 @@ void UCellWidget::OnItemRotated()
 	}
 	else
 	{
-		for (const FPoint2D& Cell: DraggedSlotWidget->InventorySlot.ItemInstance->SizeInCells)
+		for (const FPoint2D& Cell: SizeInCells)
 		{
 			FPoint2D TargetCell = Cell + Coordinates;
 			const int32 CellIndex = ParentWidget->GetCellIndex(TargetCell);
@@ -136,8 +138,8 @@ void UCellWidget::NativeOnDragEnter(const FGeometry& InGeometry, const FDragDrop
 
 	CachedDragDropOperation = InOperation;
 
-	const UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
-	DraggedSlotWidget->InventorySlot.ItemInstance->OnItemRotated.AddDynamic(this, &ThisClass::OnItemRotated);
+	UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
+	DraggedSlotWidget->OnSlotRotated.AddDynamic(this, &ThisClass::OnItemRotated);
 
 	for (UCellWidget* CellWidget: ParentWidget->CellsWidgets)
 	{
@@ -149,9 +151,12 @@ void UCellWidget::NativeOnDragEnter(const FGeometry& InGeometry, const FDragDrop
 		
 	}
 
-	if (ParentWidget->Inventory->DoesItemFit(DraggedSlotWidget->InventorySlot.ItemInstance->SizeInCells, Coordinates))
+	const FItemInstanceData& DraggedInstance = DraggedSlotWidget->InventorySlot.Instance;
+	const TArray<FPoint2D> SizeInCells = DraggedInstance.GetSizeInCells();
+
+	if (ParentWidget->Inventory->DoesSizeFit(DraggedInstance.Size, Coordinates))
 	{
-		for (const FPoint2D& Cell: DraggedSlotWidget->InventorySlot.ItemInstance->SizeInCells)
+		for (const FPoint2D& Cell: SizeInCells)
 		{
 			FPoint2D TargetCell = Cell + Coordinates;
 			const int32 CellIndex = ParentWidget->GetCellIndex(TargetCell);
@@ -164,7 +169,7 @@ void UCellWidget::NativeOnDragEnter(const FGeometry& InGeometry, const FDragDrop
 	}
 	else
 	{
-		for (const FPoint2D& Cell: DraggedSlotWidget->InventorySlot.ItemInstance->SizeInCells)
+		for (const FPoint2D& Cell: SizeInCells)
 		{
 			FPoint2D TargetCell = Cell + Coordinates;
 			const int32 CellIndex = ParentWidget->GetCellIndex(TargetCell);
@@ -181,14 +186,14 @@ void UCellWidget::NativeOnDragLeave(const FDragDropEvent& InDragDropEvent, UDrag
 {
 	Super::NativeOnDragLeave(InDragDropEvent, InOperation);
 
-	const UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
+	UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
 
 	for (UCellWidget* CellWidget: ParentWidget->CellsWidgets)
 	{
 		CellWidget->SetCellColor(CellWidget->DefaultColor);
 	}
 
-	DraggedSlotWidget->InventorySlot.ItemInstance->OnItemRotated.RemoveAll(this);
+	DraggedSlotWidget->OnSlotRotated.RemoveAll(this);
 	//ParentWidget->Inventory->Slots.Add(DraggedSlotWidget->InventorySlot); //TODO: Wtf is this?
 }
 
@@ -196,20 +201,21 @@ void UCellWidget::NativeOnDragCancelled(const FDragDropEvent& InDragDropEvent, U
 {
 	Super::NativeOnDragCancelled(InDragDropEvent, InOperation);
 
-	const UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
+	UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
 
 	for (UCellWidget* CellWidget: ParentWidget->CellsWidgets)
 	{
 		CellWidget->SetCellColor(CellWidget->DefaultColor);
 	}
 	
-	DraggedSlotWidget->InventorySlot.ItemInstance->OnItemRotated.RemoveAll(this);
+	DraggedSlotWidget->OnSlotRotated.RemoveAll(this);
 	ParentWidget->Inventory->Slots.Add(DraggedSlotWidget->InventorySlot);
+	ParentWidget->Inventory->MarkSlotsChanged();
 }
 
 bool UCellWidget::NativeOnDrop(const FGeometry& InGeometry, const FDragDropEvent& InDragDropEvent, UDragDropOperation* InOperation)
 {
-	const UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
+	UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
 
 	for (UCellWidget* CellWidget: ParentWidget->CellsWidgets)
 	{
@@ -225,7 +231,7 @@ bool UCellWidget::NativeOnDrop(const FGeometry& InGeometry, const FDragDropEvent
 		}
 	}
 
-	DraggedSlotWidget->InventorySlot.ItemInstance->OnItemRotated.RemoveAll(this);
+	DraggedSlotWidget->OnSlotRotated.RemoveAll(this);
 	
 	ParentWidget->Inventory->MoveItemOnSlot(DraggedSlotWidget->InventorySlot, Coordinates);
 	
@@ -4,7 +4,6 @@
 
 #include "CellWidget.h"
 #include "GridWidget.h"
-#include "ItemInstance.h"
 
 UDraggedSlotWidget::UDraggedSlotWidget(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
@@ -40,7 +39,11 @@ void UDraggedSlotWidget::OnRotateItem()
 		CellWidget->SetCellColor(CellWidget->DefaultColor);
 	}
 	
-	InventorySlot.ItemInstance->Rotate();
+	if (InventorySlot.Rotate())
+	{
+		OnSlotRotated.Broadcast();
+	}
+
 	OnDraggedSlotDataReceived();
 	OnRotate();
 }
@@ -1,6 +1,8 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "EquipmentSlotWidget.h"
+#include "Item.h"
+#include "Engine/AssetManager.h"
 
 UEquipmentSlotWidget::UEquipmentSlotWidget(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
@@ -10,9 +12,56 @@ UEquipmentSlotWidget::UEquipmentSlotWidget(const FObjectInitializer& ObjectIniti
 void UEquipmentSlotWidget::SetEquipmentSlotData(const FEquipmentSlot& InEquipmentSlot)
 {
 	EquipmentSlot = InEquipmentSlot;
+
+	RequestSlotImage();
 	OnEquipmentSlotDataReceived();
 }
 
+void UEquipmentSlotWidget::OnSlotImageLoaded_Implementation()
+{
+	OnEquipmentSlotDataReceived();
+}
+
+void UEquipmentSlotWidget::NativeDestruct()
+{
+	CancelSlotImageRequest();
+	Super::NativeDestruct();
+}
+
+void UEquipmentSlotWidget::RequestSlotImage()
+{
+	CancelSlotImageRequest();
+
+	UItem* Item = EquipmentSlot.Data.GetItem();
+	if (Item == nullptr || Item->UpdateImageResource())
+	{
+		return;
+	}
+
+	SlotImageHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Item->ImageResource.ToSoftObjectPath(), FStreamableDelegate::CreateUObject(this, &ThisClass::OnSlotImageStreamed));
+}
+
+void UEquipmentSlotWidget::OnSlotImageStreamed()
+{
+	SlotImageHandle.Reset();
+
+	// the slot may have received another item while the icon was loading
+	UItem* Item = EquipmentSlot.Data.GetItem();
+	if (Item && Item->UpdateImageResource())
+	{
+		OnSlotImageLoaded();
+	}
+}
+
+void UEquipmentSlotWidget::CancelSlotImageRequest()
+{
+	if (SlotImageHandle.IsValid())
+	{
+		SlotImageHandle->CancelHandle();
+		SlotImageHandle.Reset();
+	}
+}
+
 FReply UEquipmentSlotWidget::NativeOnMouseButtonDown(const FGeometry& InGeometry, const FPointerEvent& InMouseEvent)
 {
 	if (InMouseEvent.GetEffectingButton() == EKeys::LeftMouseButton)
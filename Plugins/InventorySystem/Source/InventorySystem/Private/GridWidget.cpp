@@ -48,12 +48,37 @@ void UGridWidget::OnInventoryWeightChanged()
 	SetWeight(Inventory->CurrentWeight, Inventory->MaxWeight);
 }
 
+void UGridWidget::OnStashRegionChanged()
+{
+	for (UCellWidget* CellWidget: CellsWidgets)
+	{
+		OnCellWidgetRemoved(CellWidget);
+	}
+
+	CellsWidgets.Empty();
+
+	// only the cells of the loaded pages are listed
+	for (const FPoint2D& Cell: Inventory->Cells)
+	{
+		UCellWidget* CellWidget = CreateWidget<UCellWidget>(GetOwningPlayer(), CellWidgetClass);
+		check(CellWidget != nullptr);
+
+		CellWidget->SetCellData(Cell, Inventory->CellSize, this);
+
+		CellsWidgets.Add(CellWidget);
+		OnCellWidgetCreated(CellWidget);
+	}
+}
+
 void UGridWidget::NativeOnInventoryDataReceived()
 {
 	// if (Inventory == nullptr)
 	// {
 	// 	return;
 	// }
+
+	// the widgets read the cells and slots directly
+	Inventory->WakeUp();
 	
 	if (!Inventory->OnInventoryUpdated.IsAlreadyBound(this, &ThisClass::OnInventoryUpdated))
 	{
@@ -64,20 +89,15 @@ void UGridWidget::NativeOnInventoryDataReceived()
 	{
 		Inventory->OnWeightChanged.AddDynamic(this, &ThisClass::OnInventoryWeightChanged);
 	}
-	
-	CellsWidgets.Empty();
-	
-	for (const FPoint2D& Cell: Inventory->Cells)
-	{
-		UCellWidget* CellWidget = CreateWidget<UCellWidget>(GetOwningPlayer(), CellWidgetClass);
-		check(CellWidget != nullptr);
 
-		CellWidget->SetCellData(Cell, Inventory->CellSize, this);
-		
-		CellsWidgets.Add(CellWidget);
-		OnCellWidgetCreated(CellWidget);
+	if (!Inventory->OnStashRegionChanged.IsAlreadyBound(this, &ThisClass::OnStashRegionChanged))
+	{
+		Inventory->OnStashRegionChanged.AddDynamic(this, &ThisClass::OnStashRegionChanged);
 	}
 
+	CellsWidgets.Empty();
+	OnStashRegionChanged();
+
 	SlotsWidgets.Empty();
 
 	for (const FSlot& CurrentSlot: Inventory->Slots)
@@ -0,0 +1,437 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryAuditSubsystem.h"
+#include "InventoryPlacement.h"
+#include "InventoryStats.h"
+#include "Item.h"
+#include "ItemInstance.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("Inventory Audit Snapshot"), STAT_InventoryAuditSnapshot, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Inventory Audit Report"), STAT_InventoryAuditReport, STATGROUP_Inventory);
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs AuditInventoriesCommand(
+	TEXT("Inventory.Audit"),
+	TEXT("Audits every inventory of the world and logs the violations found"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UInventoryAuditSubsystem* AuditSubsystem = World ? World->GetSubsystem<UInventoryAuditSubsystem>() : nullptr;
+
+		if (AuditSubsystem == nullptr || !AuditSubsystem->StartAudit())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("An inventory audit is already running"));
+		}
+	}));
+#endif
+
+UInventoryAuditSubsystem::UInventoryAuditSubsystem()
+{
+	AuditInterval = 0.0f;
+	SnapshotBudgetMs = 1.0f;
+
+	TimeSinceLastAudit = 0.0f;
+	AuditStartTime = 0.0;
+	NumSkippedInventories = 0;
+	bIsAuditRunning = false;
+}
+
+void UInventoryAuditSubsystem::Deinitialize()
+{
+	// the validation task only holds the snapshots, it finishes on its own
+	PendingInventories.Empty();
+	Snapshots.Reset();
+	Result = TFuture<TArray<FAuditViolation>>();
+	bIsAuditRunning = false;
+
+	Super::Deinitialize();
+}
+
+void UInventoryAuditSubsystem::Tick(const float DeltaTime)
+{
+	if (!bIsAuditRunning)
+	{
+		TimeSinceLastAudit += DeltaTime;
+
+		if (AuditInterval > 0.0f && TimeSinceLastAudit >= AuditInterval && GetWorld()->GetNetMode() != NM_Client)
+		{
+			StartAudit();
+		}
+
+		return;
+	}
+
+	if (PendingInventories.Num() > 0)
+	{
+		SnapshotInventories();
+
+		if (PendingInventories.Num() == 0)
+		{
+			StartValidation();
+		}
+
+		return;
+	}
+
+	if (Result.IsValid() && Result.IsReady())
+	{
+		const TArray<FAuditViolation> Violations = Result.Get();
+
+		Result = TFuture<TArray<FAuditViolation>>();
+		bIsAuditRunning = false;
+
+		ReportViolations(Violations);
+		Snapshots.Reset();
+	}
+}
+
+bool UInventoryAuditSubsystem::IsTickable() const
+{
+	return bIsAuditRunning || AuditInterval > 0.0f;
+}
+
+ETickableTickType UInventoryAuditSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UInventoryAuditSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UInventoryAuditSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInventoryAuditSubsystem, STATGROUP_Tickables);
+}
+
+bool UInventoryAuditSubsystem::StartAudit()
+{
+	if (bIsAuditRunning)
+	{
+		return false;
+	}
+
+	const UWorld* World = GetWorld();
+
+	for (TObjectIterator<UInventoryComponent> It; It; ++It)
+	{
+		UInventoryComponent* Inventory = *It;
+		if (!Inventory->IsTemplate() && Inventory->IsRegistered() && Inventory->GetWorld() == World)
+		{
+			PendingInventories.Add(Inventory);
+		}
+	}
+
+	Snapshots = MakeShared<FAuditSnapshots, ESPMode::ThreadSafe>();
+	Snapshots->Reserve(PendingInventories.Num());
+
+	TimeSinceLastAudit = 0.0f;
+	AuditStartTime = FPlatformTime::Seconds();
+	NumSkippedInventories = 0;
+	bIsAuditRunning = true;
+
+	if (PendingInventories.Num() == 0)
+	{
+		StartValidation();
+	}
+
+	return true;
+}
+
+bool UInventoryAuditSubsystem::IsAuditRunning() const
+{
+	return bIsAuditRunning;
+}
+
+void UInventoryAuditSubsystem::SnapshotInventories()
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryAuditSnapshot);
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = SnapshotBudgetMs / 1000.0;
+
+	int32 NumProcessedInventories = 0;
+
+	while (NumProcessedInventories < PendingInventories.Num())
+	{
+		UInventoryComponent* Inventory = PendingInventories[NumProcessedInventories++].Get();
+
+		// waking a hibernating inventory up would cost more than the audit saves
+		if (Inventory == nullptr || Inventory->IsHibernating())
+		{
+			NumSkippedInventories++;
+			continue;
+		}
+
+		FInventoryAuditSnapshot& Snapshot = Snapshots->AddDefaulted_GetRef();
+		Snapshot.Inventory = Inventory;
+		Snapshot.GridSize = Inventory->GridSize;
+		Snapshot.CurrentWeight = Inventory->CurrentWeight;
+		Snapshot.MaxWeight = Inventory->MaxWeight;
+		Snapshot.NumGridSlots = Inventory->Slots.Num();
+
+		Snapshot.Slots.Reserve(Inventory->Slots.Num() + Inventory->EquipmentSlots.Num());
+
+		const auto AddSlot = [&Snapshot](const FSlot& Slot)
+		{
+			const FItemDefinition& ItemDefinition = Slot.Instance.GetDefinition();
+
+			FAuditSlot& AuditSlot = Snapshot.Slots.AddDefaulted_GetRef();
+			AuditSlot.Item = Slot.GetItem();
+			AuditSlot.ItemInstance = Slot.ItemInstance;
+			AuditSlot.TopLeftCoordinates = Slot.Instance.TopLeftCoordinates;
+			AuditSlot.Size = Slot.Instance.Size;
+			AuditSlot.Quantity = Slot.Quantity;
+			AuditSlot.MaxSlotQuantity = ItemDefinition.GetMaxSlotQuantity();
+		};
+
+		for (const FSlot& Slot: Inventory->Slots)
+		{
+			AddSlot(Slot);
+		}
+
+		for (const FEquipmentSlot& EquipmentSlot: Inventory->EquipmentSlots)
+		{
+			if (EquipmentSlot.Data.IsOccupied())
+			{
+				AddSlot(EquipmentSlot.Data);
+			}
+		}
+
+		if (FPlatformTime::Seconds() - StartTime >= Budget)
+		{
+			break;
+		}
+	}
+
+	PendingInventories.RemoveAt(0, NumProcessedInventories, false);
+}
+
+void UInventoryAuditSubsystem::StartValidation()
+{
+	TSharedPtr<FAuditSnapshots, ESPMode::ThreadSafe> AuditSnapshots = Snapshots;
+
+	Result = Async(EAsyncExecution::ThreadPool, [AuditSnapshots]()
+	{
+		TArray<TArray<FAuditViolation>> SnapshotViolations;
+		SnapshotViolations.SetNum(AuditSnapshots->Num());
+
+		ParallelFor(AuditSnapshots->Num(), [&AuditSnapshots, &SnapshotViolations](const int32 I)
+		{
+			ValidateSnapshot((*AuditSnapshots)[I], I, SnapshotViolations[I]);
+		});
+
+		TArray<FAuditViolation> Violations;
+
+		for (const TArray<FAuditViolation>& InventoryViolations: SnapshotViolations)
+		{
+			Violations.Append(InventoryViolations);
+		}
+
+		FindDuplicatedItemInstances(*AuditSnapshots, Violations);
+
+		return Violations;
+	});
+}
+
+void UInventoryAuditSubsystem::ReportViolations(const TArray<FAuditViolation>& Violations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryAuditReport);
+
+	// an item instance moved between two inventories while they were copied shows up in both, only instances still held twice are duplicated
+	TMap<const UItemInstance*, int32> NumItemInstanceHolders;
+
+	for (const FAuditViolation& Violation: Violations)
+	{
+		if (Violation.Type != EInventoryViolationType::DuplicatedItemInstance)
+		{
+			continue;
+		}
+
+		const FInventoryAuditSnapshot& Snapshot = (*Snapshots)[Violation.SnapshotIndex];
+		const UItemInstance* ItemInstance = Snapshot.Slots[Violation.SlotIndex].ItemInstance.Get();
+
+		if (ItemInstance && HoldsItemInstance(Snapshot.Inventory.Get(), ItemInstance))
+		{
+			NumItemInstanceHolders.FindOrAdd(ItemInstance)++;
+		}
+	}
+
+	TArray<FInventoryViolation> ReportedViolations;
+	ReportedViolations.Reserve(Violations.Num());
+
+	for (const FAuditViolation& Violation: Violations)
+	{
+		const FInventoryAuditSnapshot& Snapshot = (*Snapshots)[Violation.SnapshotIndex];
+
+		UInventoryComponent* Inventory = Snapshot.Inventory.Get();
+		if (Inventory == nullptr)
+		{
+			continue;
+		}
+
+		FInventoryViolation& ReportedViolation = ReportedViolations.AddDefaulted_GetRef();
+		ReportedViolation.Inventory = Inventory;
+		ReportedViolation.Type = Violation.Type;
+
+		if (Violation.SlotIndex == INDEX_NONE)
+		{
+			ReportedViolation.Quantity = FMath::CeilToInt(Snapshot.CurrentWeight);
+		}
+		else
+		{
+			const FAuditSlot& Slot = Snapshot.Slots[Violation.SlotIndex];
+
+			if (Violation.Type == EInventoryViolationType::DuplicatedItemInstance)
+			{
+				const UItemInstance* ItemInstance = Slot.ItemInstance.Get();
+				if (NumItemInstanceHolders.FindRef(ItemInstance) < 2 || !HoldsItemInstance(Inventory, ItemInstance))
+				{
+					ReportedViolations.Pop(false);
+					continue;
+				}
+			}
+
+			ReportedViolation.Item = Slot.Item.Get();
+			ReportedViolation.Coordinates = Slot.TopLeftCoordinates;
+			ReportedViolation.Quantity = Slot.Quantity;
+		}
+
+		UE_LOG(LogTemp, Warning, TEXT("Inventory audit: %s in %s of %s, %s x%d at (%d, %d)"),
+			*UEnum::GetValueAsString(ReportedViolation.Type), *GetNameSafe(Inventory), *GetNameSafe(Inventory->GetOwner()),
+			*GetNameSafe(ReportedViolation.Item), ReportedViolation.Quantity, ReportedViolation.Coordinates.X, ReportedViolation.Coordinates.Y);
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Inventory audit checked %d inventories in %.2f s, %d skipped, %d violations"),
+		Snapshots->Num(), FPlatformTime::Seconds() - AuditStartTime, NumSkippedInventories, ReportedViolations.Num());
+
+	OnAuditCompleted.Broadcast(ReportedViolations);
+}
+
+void UInventoryAuditSubsystem::ValidateSnapshot(const FInventoryAuditSnapshot& Snapshot, const int32 SnapshotIndex, TArray<FAuditViolation>& OutViolations)
+{
+	// only the window covered by the slots is allocated, a stash grid is far larger than its loaded regions
+	FPoint2D WindowMin(Snapshot.GridSize.X, Snapshot.GridSize.Y);
+	FPoint2D WindowMax(0, 0);
+
+	for (int32 SlotIndex = 0; SlotIndex < Snapshot.NumGridSlots; SlotIndex++)
+	{
+		const FAuditSlot& Slot = Snapshot.Slots[SlotIndex];
+
+		const FPoint2D& TopLeft = Slot.TopLeftCoordinates;
+
+		WindowMin.X = FMath::Clamp(TopLeft.X, 0, WindowMin.X);
+		WindowMin.Y = FMath::Clamp(TopLeft.Y, 0, WindowMin.Y);
+		WindowMax.X = FMath::Clamp(TopLeft.X + Slot.Size.X, WindowMax.X, Snapshot.GridSize.X);
+		WindowMax.Y = FMath::Clamp(TopLeft.Y + Slot.Size.Y, WindowMax.Y, Snapshot.GridSize.Y);
+	}
+
+	FInventoryGridOccupancy Occupancy(WindowMin, FPoint2D(WindowMax.X - WindowMin.X, WindowMax.Y - WindowMin.Y));
+
+	for (int32 SlotIndex = 0; SlotIndex < Snapshot.Slots.Num(); SlotIndex++)
+	{
+		const FAuditSlot& Slot = Snapshot.Slots[SlotIndex];
+
+		if (Slot.Quantity > Slot.MaxSlotQuantity)
+		{
+			OutViolations.Add({ EInventoryViolationType::OverfullStack, SnapshotIndex, SlotIndex });
+		}
+
+		// equipment slots aren't part of the grid
+		if (SlotIndex >= Snapshot.NumGridSlots)
+		{
+			continue;
+		}
+
+		const FPoint2D& TopLeft = Slot.TopLeftCoordinates;
+		const bool bIsWithinBoundaries = TopLeft.X >= 0 && TopLeft.Y >= 0 && TopLeft.X + Slot.Size.X <= Snapshot.GridSize.X && TopLeft.Y + Slot.Size.Y <= Snapshot.GridSize.Y;
+
+		if (!bIsWithinBoundaries)
+		{
+			OutViolations.Add({ EInventoryViolationType::OutOfBoundsSlot, SnapshotIndex, SlotIndex });
+		}
+		else if (!Occupancy.IsFree(TopLeft, Slot.Size))
+		{
+			OutViolations.Add({ EInventoryViolationType::OverlappingSlots, SnapshotIndex, SlotIndex });
+		}
+		else
+		{
+			Occupancy.Occupy(TopLeft, Slot.Size);
+		}
+	}
+
+	// the same weight CanCarryItem checks adds against, summing the slots would flag inventories the component accepted
+	if (Snapshot.CurrentWeight > Snapshot.MaxWeight + KINDA_SMALL_NUMBER)
+	{
+		OutViolations.Add({ EInventoryViolationType::Overweight, SnapshotIndex, INDEX_NONE });
+	}
+}
+
+void UInventoryAuditSubsystem::FindDuplicatedItemInstances(const FAuditSnapshots& Snapshots, TArray<FAuditViolation>& OutViolations)
+{
+	/** Snapshot and slot of the first holder, the slot is set to INDEX_NONE once the first holder was reported */
+	TMap<TWeakObjectPtr<UItemInstance>, TPair<int32, int32>> FirstHolders;
+
+	for (int32 SnapshotIndex = 0; SnapshotIndex < Snapshots.Num(); SnapshotIndex++)
+	{
+		const TArray<FAuditSlot>& Slots = Snapshots[SnapshotIndex].Slots;
+
+		for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); SlotIndex++)
+		{
+			// inline slots have no identity to compare, a copied inline slot is only caught as overlapping within its own inventory
+			// only compared, never resolved off the game thread
+			const TWeakObjectPtr<UItemInstance>& ItemInstance = Slots[SlotIndex].ItemInstance;
+			if (ItemInstance.IsExplicitlyNull())
+			{
+				continue;
+			}
+
+			TPair<int32, int32>* FirstHolder = FirstHolders.Find(ItemInstance);
+
+			if (FirstHolder == nullptr)
+			{
+				FirstHolders.Add(ItemInstance, TPair<int32, int32>(SnapshotIndex, SlotIndex));
+				continue;
+			}
+
+			if (FirstHolder->Value != INDEX_NONE)
+			{
+				OutViolations.Add({ EInventoryViolationType::DuplicatedItemInstance, FirstHolder->Key, FirstHolder->Value });
+				FirstHolder->Value = INDEX_NONE;
+			}
+
+			OutViolations.Add({ EInventoryViolationType::DuplicatedItemInstance, SnapshotIndex, SlotIndex });
+		}
+	}
+}
+
+bool UInventoryAuditSubsystem::HoldsItemInstance(const UInventoryComponent* Inventory, const UItemInstance* ItemInstance)
+{
+	if (Inventory == nullptr)
+	{
+		return false;
+	}
+
+	for (const FSlot& Slot: Inventory->Slots)
+	{
+		if (Slot.ItemInstance == ItemInstance)
+		{
+			return true;
+		}
+	}
+
+	for (const FEquipmentSlot& EquipmentSlot: Inventory->EquipmentSlots)
+	{
+		if (EquipmentSlot.Data.ItemInstance == ItemInstance)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryCommandQueue.h"
+#include "InventoryComponent.h"
+#include "InventoryStats.h"
+#include "Item.h"
+
+DECLARE_CYCLE_STAT(TEXT("Inventory Apply Commands"), STAT_InventoryApplyCommands, STATGROUP_Inventory);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Inventory Commands Applied"), STAT_InventoryCommandsApplied, STATGROUP_Inventory);
+
+FInventoryCommandQueue::FInventoryCommandQueue()
+{
+	NumEnqueuing = 0;
+	bIsClosed = false;
+}
+
+FInventoryCommandQueue::~FInventoryCommandQueue()
+{
+	Close();
+}
+
+TFuture<FInventoryCommandResult> FInventoryCommandQueue::AddItem(UInventoryComponent* Inventory, UItem* Item, const int32 Quantity)
+{
+	return Enqueue(EInventoryCommandType::AddItem, Inventory, Item, Quantity);
+}
+
+TFuture<FInventoryCommandResult> FInventoryCommandQueue::RemoveItem(UInventoryComponent* Inventory, UItem* Item, const int32 Quantity)
+{
+	return Enqueue(EInventoryCommandType::RemoveItem, Inventory, Item, Quantity);
+}
+
+TFuture<FInventoryCommandResult> FInventoryCommandQueue::AddMoney(UInventoryComponent* Inventory, const int32 Value)
+{
+	return Enqueue(EInventoryCommandType::AddMoney, Inventory, nullptr, Value);
+}
+
+TFuture<FInventoryCommandResult> FInventoryCommandQueue::RemoveMoney(UInventoryComponent* Inventory, const int32 Value)
+{
+	return Enqueue(EInventoryCommandType::RemoveMoney, Inventory, nullptr, Value);
+}
+
+int32 FInventoryCommandQueue::ApplyCommands()
+{
+	check(IsInGameThread());
+	SCOPE_CYCLE_COUNTER(STAT_InventoryApplyCommands);
+
+	// each inventory notifies once for the whole drain, as a batch of loot does
+	TArray<UInventoryComponent*, TInlineAllocator<8>> BatchedInventories;
+
+	int32 NumAppliedCommands = 0;
+	TUniquePtr<FCommand> Command;
+
+	while (Commands.Dequeue(Command))
+	{
+		UInventoryComponent* Inventory = Command->Inventory.Get();
+
+		if (Inventory && !BatchedInventories.Contains(Inventory))
+		{
+			BatchedInventories.Add(Inventory);
+			Inventory->BeginNotificationBatch();
+		}
+
+		Command->Promise.SetValue(Inventory ? ApplyCommand(Inventory, *Command) : FInventoryCommandResult());
+		NumAppliedCommands++;
+	}
+
+	for (UInventoryComponent* Inventory: BatchedInventories)
+	{
+		Inventory->EndNotificationBatch();
+	}
+
+	INC_DWORD_STAT_BY(STAT_InventoryCommandsApplied, NumAppliedCommands);
+
+	return NumAppliedCommands;
+}
+
+void FInventoryCommandQueue::Close()
+{
+	bIsClosed = true;
+
+	// a producer that saw the queue open is about to enqueue
+	while (NumEnqueuing > 0)
+	{
+		FPlatformProcess::Yield();
+	}
+
+	TUniquePtr<FCommand> Command;
+
+	while (Commands.Dequeue(Command))
+	{
+		Command->Promise.SetValue(FInventoryCommandResult());
+	}
+}
+
+bool FInventoryCommandQueue::IsEmpty() const
+{
+	return Commands.IsEmpty();
+}
+
+TFuture<FInventoryCommandResult> FInventoryCommandQueue::Enqueue(const EInventoryCommandType Type, UInventoryComponent* Inventory, UItem* Item, const int32 Quantity)
+{
+	TUniquePtr<FCommand> Command = MakeUnique<FCommand>();
+	Command->Type = Type;
+	Command->Inventory = Inventory;
+	Command->Item = Item;
+	Command->Quantity = Quantity;
+
+	TFuture<FInventoryCommandResult> Result = Command->Promise.GetFuture();
+
+	NumEnqueuing++;
+
+	if (bIsClosed)
+	{
+		NumEnqueuing--;
+
+		Command->Promise.SetValue(FInventoryCommandResult());
+		return Result;
+	}
+
+	Commands.Enqueue(MoveTemp(Command));
+	NumEnqueuing--;
+
+	return Result;
+}
+
+FInventoryCommandResult FInventoryCommandQueue::ApplyCommand(UInventoryComponent* Inventory, const FCommand& Command)
+{
+	FInventoryCommandResult Result;
+
+	switch (Command.Type)
+	{
+	case EInventoryCommandType::AddItem:
+		Result.bSucceeded = Inventory->AddNewItem(Command.Item.Get(), Command.Quantity, Result.Quantity);
+		break;
+
+	case EInventoryCommandType::RemoveItem:
+		// RemoveItem also succeeds when fewer items than asked were there to remove
+		Inventory->RemoveItem(Command.Item.Get(), Command.Quantity, Result.Quantity);
+		Result.bSucceeded = Command.Quantity > 0 && Result.Quantity == Command.Quantity;
+		break;
+
+	case EInventoryCommandType::AddMoney:
+		Result.Quantity = FMath::Max(FMath::Min(Command.Quantity, INT32_MAX - Inventory->GetMoney()), 0);
+		Result.bSucceeded = Command.Quantity > 0 && Result.Quantity == Command.Quantity;
+		Inventory->AddMoney(Command.Quantity);
+		break;
+
+	case EInventoryCommandType::RemoveMoney:
+		Result.Quantity = FMath::Max(FMath::Min(Command.Quantity, Inventory->GetMoney()), 0);
+		Result.bSucceeded = Command.Quantity > 0 && Result.Quantity == Command.Quantity;
+		Inventory->RemoveMoney(Command.Quantity);
+		break;
+	}
+
+	return Result;
+}
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryCommandSubsystem.h"
+#include "InventoryCommandQueue.h"
+
+void UInventoryCommandSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	CommandQueue = MakeShared<FInventoryCommandQueue, ESPMode::ThreadSafe>();
+}
+
+void UInventoryCommandSubsystem::Deinitialize()
+{
+	// workers may still hold the queue, their pending and later commands fail
+	CommandQueue->Close();
+	CommandQueue.Reset();
+
+	Super::Deinitialize();
+}
+
+void UInventoryCommandSubsystem::Tick(const float DeltaTime)
+{
+	CommandQueue->ApplyCommands();
+}
+
+bool UInventoryCommandSubsystem::IsTickable() const
+{
+	return CommandQueue.IsValid() && !CommandQueue->IsEmpty();
+}
+
+ETickableTickType UInventoryCommandSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UInventoryCommandSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UInventoryCommandSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInventoryCommandSubsystem, STATGROUP_Tickables);
+}
+
+TSharedRef<FInventoryCommandQueue, ESPMode::ThreadSafe> UInventoryCommandSubsystem::GetCommandQueue() const
+{
+	check(CommandQueue.IsValid());
+	return CommandQueue.ToSharedRef();
+}
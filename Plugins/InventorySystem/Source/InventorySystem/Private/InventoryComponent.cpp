@@ -5,17 +5,145 @@
 #include "ItemInstance.h"
 #include "Item.h"
 #include "Pickup.h"
+#include "PickupSubsystem.h"
+#include "LootProxySubsystem.h"
+#include "ItemInstanceSubsystem.h"
+#include "InventorySaveData.h"
+#include "InventoryJournal.h"
+#include "InventoryStash.h"
+#include "InventoryPlacement.h"
+#include "InventoryQuerySnapshot.h"
+#include "InventoryStats.h"
+#include "AssetManager_Custom.h"
+#include "Engine/AssetManager.h"
+#include "TimerManager.h"
+#include "Async/Async.h"
+#include "Misc/ScopeRWLock.h"
+#include "Serialization/MemoryReader.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Hibernating Inventories"), STAT_HibernatingInventories, STATGROUP_Inventory);
+DECLARE_MEMORY_STAT(TEXT("Hibernated Inventory Bytes"), STAT_HibernatedInventoryBytes, STATGROUP_Inventory);
+DECLARE_MEMORY_STAT(TEXT("Hibernation Bytes Saved"), STAT_HibernationBytesSaved, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Inventory Placement Snapshot"), STAT_InventoryPlacementSnapshot, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Inventory Placement Apply"), STAT_InventoryPlacementApply, STATGROUP_Inventory);
+DECLARE_CYCLE_STAT(TEXT("Inventory Publish Query Snapshot"), STAT_InventoryPublishQuerySnapshot, STATGROUP_Inventory);
+
+/** A request whose slots keep changing while it is planned is planned on the game thread after this many plans */
+static const int32 MaxPlacementPlans = 3;
+
+FItemInstanceData::FItemInstanceData(UItem* InItem)
+{
+	Item = InItem;
+	ItemId = UAssetManager_Custom::InvalidItemId;
+	bIsRotated = false;
+
+	if (Item)
+	{
+		ItemId = Item->GetItemId();
+
+		// assets are registered when they load, an item created at runtime is registered once it first gets a slot
+		if (ItemId == UAssetManager_Custom::InvalidItemId)
+		{
+			UAssetManager_Custom::Get().UpdateItemDefinition(Item);
+			ItemId = Item->GetItemId();
+		}
+
+		Size = Item->GetDefinition().GetSize(false);
+	}
+}
+
+const FItemDefinition& FItemInstanceData::GetDefinition() const
+{
+	return UAssetManager_Custom::GetItemDefinition(ItemId);
+}
+
+bool FItemInstanceData::Rotate()
+{
+	if (Item == nullptr || !GetDefinition().bCanBeRotated)
+	{
+		return false;
+	}
+
+	bIsRotated = !bIsRotated;
+	Size = GetDefinition().GetSize(bIsRotated);
+	return true;
+}
+
+void FItemInstanceData::ResetRotation()
+{
+	if (Item == nullptr)
+	{
+		return;
+	}
+
+	bIsRotated = false;
+	Size = GetDefinition().GetSize(false);
+}
+
+bool FItemInstanceData::ContainsCell(const FPoint2D& Coordinates) const
+{
+	return Coordinates.X >= TopLeftCoordinates.X && Coordinates.X < TopLeftCoordinates.X + Size.X
+		&& Coordinates.Y >= TopLeftCoordinates.Y && Coordinates.Y < TopLeftCoordinates.Y + Size.Y;
+}
+
+TArray<FPoint2D> FItemInstanceData::GetSizeInCells() const
+{
+	TArray<FPoint2D> SizeInCells;
+	SizeInCells.Reserve(Size.X * Size.Y);
+
+	for (int32 I = 0; I < Size.X; I++)
+	{
+		for (int32 J = 0; J < Size.Y; J++)
+		{
+			SizeInCells.Add(FPoint2D(I, J));
+		}
+	}
+
+	return SizeInCells;
+}
+
+bool FSlot::Rotate()
+{
+	if (!Instance.Rotate())
+	{
+		return false;
+	}
+
+	if (ItemInstance)
+	{
+		SyncItemInstance();
+		ItemInstance->NotifyItemRotated();
+	}
+
+	return true;
+}
+
+void FSlot::ResetRotation()
+{
+	Instance.ResetRotation();
+	SyncItemInstance();
+}
+
+void FSlot::SyncItemInstance() const
+{
+	if (ItemInstance)
+	{
+		ItemInstance->SetInstanceData(Instance);
+	}
+}
 
 bool FSlot::IsOnMaxStackSize() const
 {
-	if (ItemInstance == nullptr)
+	if (Instance.Item == nullptr)
 	{
 		return false;
 	}
 
-	if (ItemInstance->Item->bCanBeStacked)
+	const FItemDefinition& ItemDefinition = Instance.GetDefinition();
+
+	if (ItemDefinition.bCanBeStacked)
 	{
-		if (Quantity >= ItemInstance->Item->MaxStackSize)
+		if (Quantity >= ItemDefinition.MaxStackSize)
 		{
 			return true;
 		}
@@ -28,14 +156,16 @@ bool FSlot::IsOnMaxStackSize() const
 
 int32 FSlot::GetMissingStackQuantity() const
 {
-	if (ItemInstance == nullptr)
+	if (Instance.Item == nullptr)
 	{
 		return 0;
 	}
 
-	if (ItemInstance->Item->bCanBeStacked)
+	const FItemDefinition& ItemDefinition = Instance.GetDefinition();
+
+	if (ItemDefinition.bCanBeStacked)
 	{
-		return ItemInstance->Item->MaxStackSize - Quantity;
+		return ItemDefinition.MaxStackSize - Quantity;
 	}
 
 	return 0;
@@ -43,14 +173,16 @@ int32 FSlot::GetMissingStackQuantity() const
 
 void FSlot::SetQuantity(const int32 InQuantity)
 {
-	if (ItemInstance == nullptr)
+	if (Instance.Item == nullptr)
 	{
 		return;
 	}
 	
-	if (ItemInstance->Item->bCanBeStacked)
+	const FItemDefinition& ItemDefinition = Instance.GetDefinition();
+
+	if (ItemDefinition.bCanBeStacked)
 	{
-		Quantity = FMath::Clamp(InQuantity, 0, ItemInstance->Item->MaxStackSize);
+		Quantity = FMath::Clamp(InQuantity, 0, ItemDefinition.MaxStackSize);
 	}
 	else
 	{
@@ -60,14 +192,16 @@ void FSlot::SetQuantity(const int32 InQuantity)
 
 void FSlot::UpdateQuantity(const int32 InQuantity)
 {
-	if (ItemInstance == nullptr)
+	if (Instance.Item == nullptr)
 	{
 		return;
 	}
 	
-	if (ItemInstance->Item->bCanBeStacked)
+	const FItemDefinition& ItemDefinition = Instance.GetDefinition();
+
+	if (ItemDefinition.bCanBeStacked)
 	{
-		Quantity = FMath::Clamp(Quantity + InQuantity, 0, ItemInstance->Item->MaxStackSize);
+		Quantity = FMath::Clamp(Quantity + InQuantity, 0, ItemDefinition.MaxStackSize);
 	}
 	else
 	{
@@ -77,12 +211,12 @@ void FSlot::UpdateQuantity(const int32 InQuantity)
 
 bool FSlot::IsEmpty() const
 {
-	return (ItemInstance == nullptr && Quantity == 0 && OwnerInventory != nullptr);
+	return (Instance.Item == nullptr && Quantity == 0 && OwnerInventory != nullptr);
 }
 
 bool FSlot::IsOccupied() const
 {
-	return (ItemInstance != nullptr && Quantity > 0 && OwnerInventory != nullptr);
+	return (Instance.Item != nullptr && Quantity > 0 && OwnerInventory != nullptr);
 }
 
 bool FSlot::IsValid() const
@@ -90,6 +224,26 @@ bool FSlot::IsValid() const
 	return (OwnerInventory != nullptr && Quantity >= 0);
 }
 
+bool FLootFilter::Matches(const UItem* Item) const
+{
+	if (Item == nullptr)
+	{
+		return false;
+	}
+
+	if (ItemTypes.Num() > 0 && !ItemTypes.Contains(Item->GetDefinition().Type))
+	{
+		return false;
+	}
+
+	if (Items.Num() > 0 && !Items.Contains(Item))
+	{
+		return false;
+	}
+
+	return true;
+}
+
 UInventoryComponent::UInventoryComponent()
 {
 	PrimaryComponentTick.bCanEverTick = false;
@@ -105,19 +259,66 @@ UInventoryComponent::UInventoryComponent()
 
 	bUseScaledMaxWeight = true;
 	PickupSpawnRadiusFromPlayer = 100.0f;
+
+	bAlwaysCreateItemInstanceObjects = false;
+	MaxJournalBytes = 16384;
+	StashPageSize = 16;
+	HibernateIdleTimeout = 0.0f;
+	bIsInitialized = false;
+
+	NotificationBatchDepth = 0;
+	bPendingInventoryUpdated = false;
+	bPendingInventoryInsufficientSpace = false;
+	bPendingInventoryWeightChanged = false;
+
+	HibernationBytesSaved = 0;
+	bIsHibernating = false;
+	bWasAccessed = false;
+
+	InventoryVersion = 0;
+	PlacementSerial = 0;
+	bIsPlacementInFlight = false;
+
+	QuerySnapshot = MakeShared<FInventoryQuerySnapshot, ESPMode::ThreadSafe>();
 }
 
 void UInventoryComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
-	Initialize();
-	AddStartupItems();
+	InitializeGrid();
+	LoadStartupItems();
+
+	if (HibernateIdleTimeout > 0.0f)
+	{
+		GetWorld()->GetTimerManager().SetTimer(HibernateTimerHandle, this, &ThisClass::OnHibernateTimer, HibernateIdleTimeout, true);
+	}
+}
+
+void UInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (StartupItemsHandle.IsValid())
+	{
+		StartupItemsHandle->CancelHandle();
+		StartupItemsHandle.Reset();
+	}
+
+	GetWorld()->GetTimerManager().ClearTimer(HibernateTimerHandle);
+
+	CancelPlacements();
+	CloseJournal();
+	CloseStash();
+	DiscardHibernatedData();
+	ReleaseItemInstances();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 UItemInstance* UInventoryComponent::CreateItemInstance(const TSubclassOf<UItemInstance> ItemInstanceClass) const
 {
-	UItemInstance* ItemInstance = NewObject<UItemInstance>(GetOwner(), ItemInstanceClass);
+	UItemInstanceSubsystem* ItemInstanceSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UItemInstanceSubsystem>() : nullptr;
+
+	UItemInstance* ItemInstance = ItemInstanceSubsystem ? ItemInstanceSubsystem->AcquireItemInstance(ItemInstanceClass) : NewObject<UItemInstance>(GetOwner(), ItemInstanceClass);
 	check(ItemInstance != nullptr);
 
 	ItemInstance->NativeOnConstruct();
@@ -136,6 +337,16 @@ UItemInstance* UInventoryComponent::CreateItemInstance(const TSubclassOf<UItemIn
 	return ItemInstance;
 }
 
+bool UInventoryComponent::ShouldCreateItemInstance(const UItem* Item) const
+{
+	if (Item == nullptr || !Item->ItemInstanceClass || Item->ItemInstanceClass->HasAnyClassFlags(CLASS_Abstract))
+	{
+		return false;
+	}
+
+	return bAlwaysCreateItemInstanceObjects || Item->GetDefinition().bHasItemInstanceBehavior;
+}
+
 bool UInventoryComponent::IsWithinBoundaries(const FPoint2D& Coordinates) const
 {
 	const bool bIsWithinBoundaries = Coordinates.X >= 0 && Coordinates.Y >= 0 && Coordinates.X < GridSize.X && Coordinates.Y < GridSize.Y;
@@ -144,20 +355,24 @@ bool UInventoryComponent::IsWithinBoundaries(const FPoint2D& Coordinates) const
 
 bool UInventoryComponent::IsFreeCell(const FPoint2D& Coordinates)
 {
+	NoteAccess();
+
 	if (!IsWithinBoundaries(Coordinates))
 	{
 		return false;
 	}
 
+	// stash cells outside the loaded regions may hold slots that aren't materialized
+	if (Stash.IsValid() && Stash->IsOpen() && !Stash->IsCellAvailable(Coordinates))
+	{
+		return false;
+	}
+
 	for (const FSlot& Slot: Slots)
 	{
-		for (const FPoint2D& Cell: Slot.ItemInstance->SizeInCells)
+		if (Slot.Instance.ContainsCell(Coordinates))
 		{
-			const bool bIsNotFree = (Cell + Slot.ItemInstance->TopLeftCoordinates == Coordinates);
-			if (bIsNotFree)
-			{
-				return false;
-			}
+			return false;
 		}
 	}
 
@@ -177,8 +392,26 @@ bool UInventoryComponent::DoesItemFit(const TArray<FPoint2D>& SizeInCells, const
 	return true;
 }
 
+bool UInventoryComponent::DoesSizeFit(const FPoint2D& Size, const FPoint2D& Coordinates)
+{
+	for (int32 I = 0; I < Size.X; I++)
+	{
+		for (int32 J = 0; J < Size.Y; J++)
+		{
+			if (!IsFreeCell(FPoint2D(Coordinates.X + I, Coordinates.Y + J)))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 FPoint2D UInventoryComponent::GetFreeCell()
 {
+	NoteAccess();
+
 	for (const FPoint2D& Cell: Cells)
 	{
 		if (IsFreeCell(Cell))
@@ -192,6 +425,8 @@ FPoint2D UInventoryComponent::GetFreeCell()
 
 FPoint2D UInventoryComponent::GetFreeCellWhereItemCanFit(const TArray<FPoint2D>& SizeInCells)
 {
+	NoteAccess();
+
 	for (const FPoint2D& Cell: Cells)
 	{
 		const bool bItemCanFit = IsFreeCell(Cell) && DoesItemFit(SizeInCells, Cell);
@@ -204,6 +439,22 @@ FPoint2D UInventoryComponent::GetFreeCellWhereItemCanFit(const TArray<FPoint2D>&
 	return FPoint2D(INDEX_NONE, INDEX_NONE);
 }
 
+FPoint2D UInventoryComponent::GetFreeCellWhereSizeCanFit(const FPoint2D& Size)
+{
+	NoteAccess();
+
+	for (const FPoint2D& Cell: Cells)
+	{
+		const bool bItemCanFit = IsFreeCell(Cell) && DoesSizeFit(Size, Cell);
+		if (bItemCanFit)
+		{
+			return Cell;
+		}
+	}
+
+	return FPoint2D(INDEX_NONE, INDEX_NONE);
+}
+
 bool UInventoryComponent::IsFull() const
 {
 	return CurrentWeight >= MaxWeight;
@@ -211,9 +462,11 @@ bool UInventoryComponent::IsFull() const
 
 bool UInventoryComponent::DoesItemExist(const UItem* Item)
 {
+	NoteAccess();
+
 	for (const FSlot& Slot: Slots)
 	{
-		if (Slot.ItemInstance->Item == Item)
+		if (Slot.GetItem() == Item)
 		{
 			return true;
 		}
@@ -224,11 +477,18 @@ bool UInventoryComponent::DoesItemExist(const UItem* Item)
 
 int32 UInventoryComponent::CountItemQuantity(const UItem* Item)
 {
+	NoteAccess();
+
+	if (Stash.IsValid() && Stash->IsOpen())
+	{
+		return Item ? Stash->CountItemQuantity(Item->GetItemId()) : 0;
+	}
+
 	int32 Quantity = 0;
 	
 	for (const FSlot& Slot: Slots)
 	{
-		if (Slot.ItemInstance->Item == Item)
+		if (Slot.GetItem() == Item)
 		{
 			Quantity += Slot.Quantity;
 		}
@@ -239,15 +499,13 @@ int32 UInventoryComponent::CountItemQuantity(const UItem* Item)
 
 FSlot UInventoryComponent::GetSlotByCoordinates(const FPoint2D& Coordinates)
 {
+	NoteAccess();
+
 	for (const FSlot& Slot: Slots)
 	{
-		for (const FPoint2D& Cell: Slot.ItemInstance->SizeInCells)
+		if (Slot.Instance.ContainsCell(Coordinates))
 		{
-			const bool bIsWithinThisSlot = (Slot.ItemInstance->TopLeftCoordinates + Cell == Coordinates);
-			if (bIsWithinThisSlot)
-			{
-				return Slot;
-			}
+			return Slot;
 		}
 	}
 
@@ -256,19 +514,17 @@ FSlot UInventoryComponent::GetSlotByCoordinates(const FPoint2D& Coordinates)
 
 int32 UInventoryComponent::GetSlotIndexByCoordinates(const FPoint2D& Coordinates)
 {
+	NoteAccess();
+
 	int32 Index = INDEX_NONE;
 	
 	for (const FSlot& Slot: Slots)
 	{
 		Index++;
 		
-		for (const FPoint2D& Cell: Slot.ItemInstance->SizeInCells)
+		if (Slot.Instance.ContainsCell(Coordinates))
 		{
-			const bool bIsWithinThisSlot = (Slot.ItemInstance->TopLeftCoordinates + Cell == Coordinates);
-			if (bIsWithinThisSlot)
-			{
-				return Index;
-			}
+			return Index;
 		}
 	}
 
@@ -277,538 +533,270 @@ int32 UInventoryComponent::GetSlotIndexByCoordinates(const FPoint2D& Coordinates
 
 bool UInventoryComponent::CanCarryItem(const UItem* Item, const int32 Quantity) const
 {
-	float EstimatedWeight;
-
-	if (Item->bUseScaledWeight)
-	{
-		EstimatedWeight = Quantity * Item->GetScaledWeight();
-	}
-	else
-	{
-		EstimatedWeight = Quantity * Item->Weight;
-	}
-
+	const float EstimatedWeight = Quantity * Item->GetDefinition().Weight;
 	return (CurrentWeight + EstimatedWeight <= MaxWeight);
 }
 
 void UInventoryComponent::Initialize()
+{
+	InitializeGrid();
+	NotifyInventoryInitialized();
+}
+
+void UInventoryComponent::InitializeGrid()
 {
 	if (bUseScaledMaxWeight)
 	{
 		MaxWeight = GridSize.X * GridSize.Y;
 	}
 	
+	DiscardHibernatedData();
+	ReleaseItemInstances();
+	MarkSlotsChanged();
+
 	CurrentWeight = 0.0f;
-	Cells.Empty();
 	Slots.Empty();
 
-	for (int32 I = 0; I < GridSize.X; I++)
-	{
-		for (int32 J = 0; J < GridSize.Y; J++)
-		{
-			Cells.Add(FPoint2D(I, J));
-		}
-	}
+	UpdateCells();
 
 	for (FEquipmentSlot& EquipmentSlot: EquipmentSlots)
 	{
+		EquipmentSlot.Data.Instance = FItemInstanceData();
 		EquipmentSlot.Data.ItemInstance = nullptr;
 		EquipmentSlot.Data.OwnerInventory = this;
 		EquipmentSlot.Data.Quantity = 0;
 	}
-	
-	NotifyInventoryInitialized();
+
+	PublishQuerySnapshot();
 }
 
-void UInventoryComponent::AddStartupItems()
+void UInventoryComponent::UpdateCells()
 {
-	for (const FStartupItem& StartupItem: StartupItems)
+	if (Stash.IsValid() && Stash->IsOpen())
 	{
-		int32 AddedQuantity = 0;
-		AddNewItem(StartupItem.Item, StartupItem.Quantity, AddedQuantity);
+		Stash->GetLoadedCells(Cells);
+		return;
 	}
 
-	AddMoney(DefaultMoney);
+	Cells.Reset(GridSize.X * GridSize.Y);
+
+	for (int32 I = 0; I < GridSize.X; I++)
+	{
+		for (int32 J = 0; J < GridSize.Y; J++)
+		{
+			Cells.Add(FPoint2D(I, J));
+		}
+	}
 }
 
-bool UInventoryComponent::AddNewItem(UItem* Item, const int32 Quantity, int32& AddedQuantity)
+bool UInventoryComponent::FindItemPlacement(FItemInstanceData& Instance)
 {
-	AddedQuantity = 0;
+	FPoint2D Coordinates = GetFreeCellWhereSizeCanFit(Instance.Size);
 
-	if (Item == nullptr)
+	// try to rotate the item and see if it fits
+	if (!IsWithinBoundaries(Coordinates) && Instance.Rotate())
 	{
-		return false;
+		Coordinates = GetFreeCellWhereSizeCanFit(Instance.Size);
 	}
 
-	if (Quantity <= 0)
+	if (!IsWithinBoundaries(Coordinates))
 	{
 		return false;
 	}
 
-	if (IsFull())
-	{
-		NotifyInventoryInsufficientSpace();
-		return false;
-	}
-	
-	int32 RemainingQuantity = Quantity;
+	Instance.TopLeftCoordinates = Coordinates;
+	return true;
+}
+
+FSlot UInventoryComponent::MakeSlot(const FItemInstanceData& Instance, const int32 Quantity)
+{
+	FSlot NewSlot = FSlot(Instance, Quantity, this);
 
-	if (Item->bCanBeStacked)
+	if (ShouldCreateItemInstance(Instance.Item))
 	{
-		if (DoesItemExist(Item))
-		{
-			for (FSlot& Slot: Slots)
-			{
-				const bool bCanStack = !Slot.IsOnMaxStackSize() && Slot.ItemInstance->Item == Item;
-				if (bCanStack)
-				{
-					const int32 MissingStackQuantity = Slot.GetMissingStackQuantity();
-				
-					if (RemainingQuantity <= MissingStackQuantity)
-					{
-						if (!CanCarryItem(Item, MissingStackQuantity))
-						{
-							NotifyInventoryUpdated();
-							NotifyInventoryInsufficientSpace();
-							return false;
-						}
-					
-						Slot.UpdateQuantity(MissingStackQuantity);
-						AddedQuantity += MissingStackQuantity;
-						RemainingQuantity -= MissingStackQuantity;
-					
-						NotifyInventoryUpdated();
-						NotifyInventoryWeightChanged();
-						NotifyInventoryItemAdded(Item, AddedQuantity);
-						return true;
-					}
+		NewSlot.ItemInstance = CreateItemInstance(Instance.Item->ItemInstanceClass);
+		NewSlot.ItemInstance->OwnerInventory = this;
+		NewSlot.SyncItemInstance();
 
-					if (!CanCarryItem(Item, MissingStackQuantity))
-					{
-						NotifyInventoryUpdated();
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				
-					Slot.UpdateQuantity(MissingStackQuantity);
-					AddedQuantity += MissingStackQuantity;
-					RemainingQuantity -= MissingStackQuantity;
-				}
-			}
+		// items rotated to fit still notify their instance, as when they were rotated after being constructed
+		if (Instance.bIsRotated)
+		{
+			NewSlot.ItemInstance->NotifyItemRotated();
 		}
+	}
 
-		while (RemainingQuantity >= Item->MaxStackSize)
-		{
-			UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-			check(NewItemInstance != nullptr);
+	return NewSlot;
+}
 
-			FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-			if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, Item->MaxStackSize))
-			{
-				NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
-				
-				FSlot NewSlot = FSlot(NewItemInstance, Item->MaxStackSize, this);
-				Slots.Add(NewSlot);
+FSlot UInventoryComponent::MakeSavedSlot(const FItemInstanceData& Instance, const FSavedSlot& SavedSlot)
+{
+	FSlot NewSlot = MakeSlot(Instance, SavedSlot.Quantity);
 
-				AddedQuantity += Item->MaxStackSize;
-				RemainingQuantity -= Item->MaxStackSize;
-			}
-			else
-			{
-				// try to rotate the item and see if it fits
-				if (Item->CanBeRotated())
-				{
-					NewItemInstance->Rotate();
-					FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
+	if (NewSlot.ItemInstance && SavedSlot.CustomData.Num() > 0)
+	{
+		FMemoryReader Reader(SavedSlot.CustomData);
+		NewSlot.ItemInstance->SerializeCustomData(Reader);
+	}
 
-					if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, Item->MaxStackSize))
-					{
-						NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
+	return NewSlot;
+}
 
-						FSlot NewSlot = FSlot(NewItemInstance, Item->MaxStackSize, this);
-						Slots.Add(NewSlot);
+int32 UInventoryComponent::RelocateMisplacedSlots()
+{
+	// placements are trusted as long as they don't overlap, checked against the cells covered so far instead of every slot
+	FInventoryGridOccupancy Occupancy(GridSize);
+	TArray<FSlot> DisplacedSlots;
 
-						AddedQuantity += Item->MaxStackSize;
-						RemainingQuantity -= Item->MaxStackSize;
-					}
-					else
-					{
-						NotifyInventoryUpdated();
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				}
-				else
-				{
-					NotifyInventoryUpdated();
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-		}
-		
-		if (RemainingQuantity > 0)
+	for (int32 I = 0; I < Slots.Num(); I++)
+	{
+		const FItemInstanceData& Instance = Slots[I].Instance;
+
+		if (Occupancy.IsFree(Instance.TopLeftCoordinates, Instance.Size))
 		{
-			UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-			check(NewItemInstance != nullptr);
+			Occupancy.Occupy(Instance.TopLeftCoordinates, Instance.Size);
+			continue;
+		}
 
-			const FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-			if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, RemainingQuantity))
-			{
-				NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
+		ReleaseItemInstance(Slots[I]);
 
-				const FSlot NewSlot = FSlot(NewItemInstance, RemainingQuantity, this);
-				Slots.Add(NewSlot);
+		DisplacedSlots.Add(Slots[I]);
+		Slots.RemoveAt(I--);
+	}
 
-				AddedQuantity += RemainingQuantity;
+	for (const FSlot& DisplacedSlot: DisplacedSlots)
+	{
+		int32 AddedQuantity = 0;
+		AddExistingItem_Internal(DisplacedSlot.GetItem(), DisplacedSlot.Quantity, AddedQuantity);
 
-				NotifyInventoryUpdated();
-				NotifyInventoryWeightChanged();
-				NotifyInventoryItemAdded(Item, RemainingQuantity);
+		if (AddedQuantity < DisplacedSlot.Quantity)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s lost %d %s, the slot no longer fits"), *GetNameSafe(this), DisplacedSlot.Quantity - AddedQuantity, *GetNameSafe(DisplacedSlot.GetItem()));
+		}
+	}
 
-				return true;
-			}
-			else
-			{
-				// try to rotate the item and see if it fits
-				if (Item->CanBeRotated())
-				{
-					NewItemInstance->Rotate();
-					const FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
+	return DisplacedSlots.Num();
+}
 
-					if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, RemainingQuantity))
-					{
-						NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
+void UInventoryComponent::ReleaseItemInstance(const FSlot& Slot) const
+{
+	if (Slot.ItemInstance == nullptr)
+	{
+		return;
+	}
 
-						const FSlot NewSlot = FSlot(NewItemInstance, RemainingQuantity, this);
-						Slots.Add(NewSlot);
+	UItemInstanceSubsystem* ItemInstanceSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UItemInstanceSubsystem>() : nullptr;
+	if (ItemInstanceSubsystem)
+	{
+		ItemInstanceSubsystem->ReleaseItemInstance(Slot.ItemInstance);
+	}
+}
 
-						AddedQuantity += RemainingQuantity;
+void UInventoryComponent::ReleaseItemInstances()
+{
+	for (FSlot& Slot: Slots)
+	{
+		ReleaseItemInstance(Slot);
+		Slot.ItemInstance = nullptr;
+	}
 
-						NotifyInventoryUpdated();
-						NotifyInventoryWeightChanged();
-						NotifyInventoryItemAdded(Item, RemainingQuantity);
+	for (FEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		ReleaseItemInstance(EquipmentSlot.Data);
+		EquipmentSlot.Data.ItemInstance = nullptr;
+	}
+}
 
-						return true;
-					}
-					else
-					{
-						NotifyInventoryUpdated();
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				}
-				else
-				{
-					NotifyInventoryUpdated();
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-		}
+void UInventoryComponent::AddStartupItems()
+{
+	NoteAccess();
 
-		NotifyInventoryUpdated();
-		NotifyInventoryWeightChanged();
-		NotifyInventoryItemAdded(Item, AddedQuantity);
+	for (const FStartupItem& StartupItem: StartupItems)
+	{
+		UItem* Item = StartupItem.Item.LoadSynchronous();
+		if (Item == nullptr)
+		{
+			continue;
+		}
 
-		return true;
+		int32 AddedQuantity = 0;
+		AddNewItem(Item, StartupItem.Quantity, AddedQuantity);
 	}
 
-	while (RemainingQuantity > 0)
-	{
-		UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-		check(NewItemInstance != nullptr);
+	AddMoney(DefaultMoney);
+}
 
-		const FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-		if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, 1))
-		{
-			NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
+bool UInventoryComponent::IsInitialized() const
+{
+	return bIsInitialized;
+}
 
-			const FSlot NewSlot = FSlot(NewItemInstance, 1, this);
-			Slots.Add(NewSlot);
+void UInventoryComponent::LoadStartupItems()
+{
+	TArray<FSoftObjectPath> ItemsToLoad;
 
-			AddedQuantity += 1;
-			RemainingQuantity -= 1;
-		}
-		else
+	for (const FStartupItem& StartupItem: StartupItems)
+	{
+		// the item instance class is a hard reference of the item, it is loaded along with it
+		if (!StartupItem.Item.IsNull() && StartupItem.Item.Get() == nullptr)
 		{
-			// try to rotate the item and see if it fits
-			if (Item->CanBeRotated())
-			{
-				NewItemInstance->Rotate();
-				const FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
+			ItemsToLoad.AddUnique(StartupItem.Item.ToSoftObjectPath());
+		}
+	}
 
-				if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, 1))
-				{
-					NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
+	if (ItemsToLoad.Num() == 0)
+	{
+		OnStartupItemsLoaded();
+		return;
+	}
 
-					const FSlot NewSlot = FSlot(NewItemInstance, 1, this);
-					Slots.Add(NewSlot);
+	StartupItemsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(ItemsToLoad, FStreamableDelegate::CreateUObject(this, &ThisClass::OnStartupItemsLoaded));
 
-					AddedQuantity += 1;
-					RemainingQuantity -= 1;
-				}
-				else
-				{
-					NotifyInventoryUpdated();
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-			else
-			{
-				NotifyInventoryUpdated();
-				NotifyInventoryInsufficientSpace();
-				return false;
-			}
-		}
+	// no handle is returned when none of the paths could be requested
+	if (!StartupItemsHandle.IsValid() && !bIsInitialized)
+	{
+		OnStartupItemsLoaded();
 	}
+}
 
-	NotifyInventoryUpdated();
-	NotifyInventoryWeightChanged();
-	NotifyInventoryItemAdded(Item, AddedQuantity);
+void UInventoryComponent::OnStartupItemsLoaded()
+{
+	// keeps the handle until the items are owned by slots, so they can't be collected in between
+	AddStartupItems();
+	StartupItemsHandle.Reset();
 
-	return true;
+	NotifyInventoryInitialized();
 }
 
-bool UInventoryComponent::AddExistingItem(UItemInstance* ItemInstance, const int32 Quantity, int32& AddedQuantity)
+bool UInventoryComponent::AddNewItem(UItem* Item, const int32 Quantity, int32& AddedQuantity)
 {
+	NoteAccess();
+
 	AddedQuantity = 0;
-	UItem* Item = ItemInstance->Item;
-	
-	if (IsFull())
-	{
-		NotifyInventoryInsufficientSpace();
-		return false;
-	}
-	
+
 	if (Item == nullptr)
 	{
 		return false;
 	}
-	
-	int32 RemainingQuantity = Quantity;
-	
-	if (Item->bCanBeStacked)
-	{
-		if (DoesItemExist(Item))
-		{
-			for (FSlot& Slot: Slots)
-			{
-				const bool bCanStack = !Slot.IsOnMaxStackSize() && Slot.ItemInstance->Item == Item;
-				if (bCanStack)
-				{
-					const int32 MissingStackQuantity = Slot.GetMissingStackQuantity();
-				
-					if (RemainingQuantity <= MissingStackQuantity)
-					{
-						if (!CanCarryItem(Item, MissingStackQuantity))
-						{
-							NotifyInventoryUpdated();
-							NotifyInventoryInsufficientSpace();
-							return false;
-						}
-					
-						Slot.UpdateQuantity(MissingStackQuantity);
-						AddedQuantity += MissingStackQuantity;
-						RemainingQuantity -= MissingStackQuantity;
-					
-						NotifyInventoryUpdated();
-						NotifyInventoryWeightChanged();
-						NotifyInventoryItemAdded(Item, AddedQuantity);
-						return true;
-					}
-	
-					if (!CanCarryItem(Item, MissingStackQuantity))
-					{
-						NotifyInventoryUpdated();
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				
-					Slot.UpdateQuantity(MissingStackQuantity);
-					AddedQuantity += MissingStackQuantity;
-					RemainingQuantity -= MissingStackQuantity;
-				}
-			}
-		}
-	
-		while (RemainingQuantity >= Item->MaxStackSize)
-		{
-			UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-			check(NewItemInstance != nullptr);
-	
-			FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-			if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, Item->MaxStackSize))
-			{
-				NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
-				
-				FSlot NewSlot = FSlot(NewItemInstance, Item->MaxStackSize, this);
-				Slots.Add(NewSlot);
-	
-				AddedQuantity += Item->MaxStackSize;
-				RemainingQuantity -= Item->MaxStackSize;
-			}
-			else
-			{
-				// try to rotate the item and see if it fits
-				if (Item->CanBeRotated())
-				{
-					NewItemInstance->Rotate();
-					FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-	
-					if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, Item->MaxStackSize))
-					{
-						NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
-	
-						FSlot NewSlot = FSlot(NewItemInstance, Item->MaxStackSize, this);
-						Slots.Add(NewSlot);
-	
-						AddedQuantity += Item->MaxStackSize;
-						RemainingQuantity -= Item->MaxStackSize;
-					}
-					else
-					{
-						NotifyInventoryUpdated();
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				}
-				else
-				{
-					NotifyInventoryUpdated();
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-		}
-		
-		if (RemainingQuantity > 0)
-		{
-			UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-			check(NewItemInstance != nullptr);
-	
-			const FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-			if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, RemainingQuantity))
-			{
-				NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
-	
-				const FSlot NewSlot = FSlot(NewItemInstance, RemainingQuantity, this);
-				Slots.Add(NewSlot);
-	
-				AddedQuantity += RemainingQuantity;
-	
-				NotifyInventoryUpdated();
-				NotifyInventoryWeightChanged();
-				NotifyInventoryItemAdded(Item, RemainingQuantity);
-	
-				return true;
-			}
-			else
-			{
-				// try to rotate the item and see if it fits
-				if (Item->CanBeRotated())
-				{
-					NewItemInstance->Rotate();
-					const FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-	
-					if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, RemainingQuantity))
-					{
-						NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
-	
-						const FSlot NewSlot = FSlot(NewItemInstance, RemainingQuantity, this);
-						Slots.Add(NewSlot);
-	
-						AddedQuantity += RemainingQuantity;
-	
-						NotifyInventoryUpdated();
-						NotifyInventoryWeightChanged();
-						NotifyInventoryItemAdded(Item, RemainingQuantity);
-	
-						return true;
-					}
-					else
-					{
-						NotifyInventoryUpdated();
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				}
-				else
-				{
-					NotifyInventoryUpdated();
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-		}
-	
-		NotifyInventoryUpdated();
-		NotifyInventoryWeightChanged();
-		NotifyInventoryItemAdded(Item, AddedQuantity);
-	
-		return true;
-	}
-	
-	while (RemainingQuantity > 0)
+
+	if (Quantity <= 0)
 	{
-		UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-		check(NewItemInstance != nullptr);
-	
-		const FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-		if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, 1))
-		{
-			NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
-	
-			const FSlot NewSlot = FSlot(NewItemInstance, 1, this);
-			Slots.Add(NewSlot);
-	
-			AddedQuantity += 1;
-			RemainingQuantity -= 1;
-		}
-		else
-		{
-			// try to rotate the item and see if it fits
-			if (Item->CanBeRotated())
-			{
-				NewItemInstance->Rotate();
-				const FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-	
-				if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, 1))
-				{
-					NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
-	
-					const FSlot NewSlot = FSlot(NewItemInstance, 1, this);
-					Slots.Add(NewSlot);
-	
-					AddedQuantity += 1;
-					RemainingQuantity -= 1;
-				}
-				else
-				{
-					NotifyInventoryUpdated();
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-			else
-			{
-				NotifyInventoryUpdated();
-				NotifyInventoryInsufficientSpace();
-				return false;
-			}
-		}
+		return false;
 	}
-	
-	NotifyInventoryUpdated();
-	NotifyInventoryWeightChanged();
-	NotifyInventoryItemAdded(Item, AddedQuantity);
 
-	return true;
+	return AddItem_Internal(Item, Quantity, AddedQuantity, true);
+}
+
+bool UInventoryComponent::AddExistingItem(UItemInstance* ItemInstance, const int32 Quantity, int32& AddedQuantity)
+{
+	NoteAccess();
+
+	return AddItem_Internal(ItemInstance ? ItemInstance->Item : nullptr, Quantity, AddedQuantity, true);
 }
 
 bool UInventoryComponent::RemoveItem(UItem* Item, const int32 Quantity, int32& RemovedQuantity)
 {
+	NoteAccess();
+
 	RemovedQuantity = 0;
 
 	if (Item == nullptr)
@@ -833,9 +821,10 @@ bool UInventoryComponent::RemoveItem(UItem* Item, const int32 Quantity, int32& R
 	{
 		for (auto It = Slots.CreateIterator(); It; ++It)
 		{
-			if (Item == It->ItemInstance->Item)
+			if (Item == It->GetItem())
 			{
 				RemovedQuantity += It->Quantity;
+				ReleaseItemInstance(*It);
 				It.RemoveCurrent();
 			}
 		}
@@ -846,16 +835,19 @@ bool UInventoryComponent::RemoveItem(UItem* Item, const int32 Quantity, int32& R
 		return true;
 	}
 
-	if (Item->bCanBeStacked)
+	const FItemDefinition& ItemDefinition = Item->GetDefinition();
+
+	if (ItemDefinition.bCanBeStacked)
 	{
 		for (auto It = Slots.CreateIterator(); It; ++It)
 		{
-			if (Item == It->ItemInstance->Item && PendingQuantity > 0)
+			if (Item == It->GetItem() && PendingQuantity > 0)
 			{
 				if (PendingQuantity >= It->Quantity)
 				{
 					RemovedQuantity += It->Quantity;
 					PendingQuantity -= It->Quantity;
+					ReleaseItemInstance(*It);
 					It.RemoveCurrent();
 				}
 				else
@@ -877,10 +869,11 @@ bool UInventoryComponent::RemoveItem(UItem* Item, const int32 Quantity, int32& R
 	// Removing non-stackable items
 	for (auto It = Slots.CreateIterator(); It; ++It)
 	{
-		if (Item == It->ItemInstance->Item && PendingQuantity > 0)
+		if (Item == It->GetItem() && PendingQuantity > 0)
 		{
 			RemovedQuantity += It->Quantity;
 			PendingQuantity -= It->Quantity;
+			ReleaseItemInstance(*It);
 			It.RemoveCurrent();
 		}
 	}
@@ -892,6 +885,22 @@ bool UInventoryComponent::RemoveItem(UItem* Item, const int32 Quantity, int32& R
 }
 
 bool UInventoryComponent::RemoveItemOnSlot(const FSlot& Slot, const int32 Quantity, int32& RemovedQuantity)
+{
+	NoteAccess();
+
+	// the slot may be an element of Slots, it is removed before its instance is released
+	const FSlot RemovedSlot = Slot;
+
+	const bool bIsRemoved = RemoveItemOnSlot_Internal(RemovedSlot, Quantity, RemovedQuantity);
+	if (bIsRemoved && RemovedQuantity >= RemovedSlot.Quantity)
+	{
+		ReleaseItemInstance(RemovedSlot);
+	}
+
+	return bIsRemoved;
+}
+
+bool UInventoryComponent::RemoveItemOnSlot_Internal(const FSlot& Slot, const int32 Quantity, int32& RemovedQuantity)
 {
 	RemovedQuantity = 0;
 
@@ -900,11 +909,11 @@ bool UInventoryComponent::RemoveItemOnSlot(const FSlot& Slot, const int32 Quanti
 		return false;
 	}
 
-	const int32 SlotIndex = GetSlotIndexByCoordinates(Slot.ItemInstance->TopLeftCoordinates);
+	const int32 SlotIndex = GetSlotIndexByCoordinates(Slot.Instance.TopLeftCoordinates);
 
 	if (Quantity >= Slot.Quantity)
 	{
-		UItem* RemovedItem = Slot.ItemInstance->Item;
+		UItem* RemovedItem = Slot.GetItem();
 		
 		RemovedQuantity += Slot.Quantity;
 		Slots.Remove(Slot);
@@ -920,26 +929,31 @@ bool UInventoryComponent::RemoveItemOnSlot(const FSlot& Slot, const int32 Quanti
 
 	NotifyInventoryUpdated();
 	NotifyInventoryWeightChanged();
-	NotifyInventoryItemRemoved(Slot.ItemInstance->Item, RemovedQuantity);
+	NotifyInventoryItemRemoved(Slot.GetItem(), RemovedQuantity);
 	return true;
 }
 
 bool UInventoryComponent::MoveItemOnSlot(const FSlot& Slot, const FPoint2D& Destination)
 {
+	NoteAccess();
+
 	if (!IsFreeCell(Destination))
 	{
 		Slots.Add(Slot);
 		return false;
 	}
 
-	if (!DoesItemFit(Slot.ItemInstance->SizeInCells, Destination))
+	if (!DoesSizeFit(Slot.Instance.Size, Destination))
 	{
 		Slots.Add(Slot);
 		return false;
 	}
 
-	Slot.ItemInstance->TopLeftCoordinates = Destination;
-	Slots.Add(Slot);
+	FSlot MovedSlot = Slot;
+	MovedSlot.Instance.TopLeftCoordinates = Destination;
+	MovedSlot.SyncItemInstance();
+
+	Slots.Add(MovedSlot);
 
 	NotifyInventoryUpdated();
 	NotifyInventoryWeightChanged();
@@ -948,6 +962,8 @@ bool UInventoryComponent::MoveItemOnSlot(const FSlot& Slot, const FPoint2D& Dest
 
 void UInventoryComponent::StackItemStackOnSlot(const FSlot& Slot, const FPoint2D& Destination, const int32 Quantity)
 {
+	NoteAccess();
+
 	if (IsFreeCell(Destination))
 	{
 		return;
@@ -967,7 +983,7 @@ void UInventoryComponent::StackItemStackOnSlot(const FSlot& Slot, const FPoint2D
 	const int32 DestinationIndex = Slots.Find(DestinationSlot);
 	const int32 SourceIndex = Slots.Find(Slot);
 
-	if (Slot.ItemInstance->Item != DestinationSlot.ItemInstance->Item || !DestinationSlot.ItemInstance->Item->bCanBeStacked)
+	if (Slot.GetItem() != DestinationSlot.GetItem() || !DestinationSlot.Instance.GetDefinition().bCanBeStacked)
 	{
 		return;
 	}
@@ -984,6 +1000,7 @@ void UInventoryComponent::StackItemStackOnSlot(const FSlot& Slot, const FPoint2D
 		if (Quantity <= MissingStackQuantity)
 		{
 			Slots[DestinationIndex].UpdateQuantity(Slot.Quantity);
+			ReleaseItemInstance(Slot);
 			Slots.Remove(Slot);
 
 			NotifyInventoryWeightChanged();
@@ -1021,6 +1038,8 @@ void UInventoryComponent::StackItemStackOnSlot(const FSlot& Slot, const FPoint2D
 
 void UInventoryComponent::EquipItemOnSlot(const FSlot& Slot)
 {
+	NoteAccess();
+
 	if (EquipmentSlots.Num() <= 0)
 	{
 		return;
@@ -1031,12 +1050,12 @@ void UInventoryComponent::EquipItemOnSlot(const FSlot& Slot)
 		return;
 	}
 
-	if (!Slot.ItemInstance->Item->bCanBeEquipped)
+	if (!Slot.GetItem()->bCanBeEquipped)
 	{
 		return;
 	}
 
-	if (!UInventoryFunctionLibrary::DoesItemHaveValidEquipmentSlot(Slot.ItemInstance->Item))
+	if (!UInventoryFunctionLibrary::DoesItemHaveValidEquipmentSlot(Slot.GetItem()))
 	{
 		return;
 	}
@@ -1046,18 +1065,18 @@ void UInventoryComponent::EquipItemOnSlot(const FSlot& Slot)
 		return;
 	}
 
-	const FEquipmentSlot PrimarySlot = GetEquipmentSlotByType(Slot.ItemInstance->Item->PrimaryEquipmentSlot);
-	const FEquipmentSlot SecondarySlot = GetEquipmentSlotByType(Slot.ItemInstance->Item->SecondaryEquipmentSlot);
+	const FEquipmentSlot PrimarySlot = GetEquipmentSlotByType(Slot.GetItem()->PrimaryEquipmentSlot);
+	const FEquipmentSlot SecondarySlot = GetEquipmentSlotByType(Slot.GetItem()->SecondaryEquipmentSlot);
 
 	if (PrimarySlot.Data.IsEmpty())
 	{
 		const int32 EquipmentSlotIndex = GetEquipmentSlotIndexByType(PrimarySlot.Type);
 
 		EquipmentSlots[EquipmentSlotIndex].Data = Slot;
-		EquipmentSlots[EquipmentSlotIndex].Data.ItemInstance->ResetRotation();
+		EquipmentSlots[EquipmentSlotIndex].Data.ResetRotation();
 		
-		NotifyInventoryItemEquipped(Slot.ItemInstance->Item, Slot.Quantity);
-		K2_OnInventoryItemEquipped(Slot.ItemInstance->Item, Slot.Quantity);
+		NotifyInventoryItemEquipped(Slot.GetItem(), Slot.Quantity);
+		K2_OnInventoryItemEquipped(Slot.GetItem(), Slot.Quantity);
 		Slots.Remove(Slot);
 
 		NotifyInventoryUpdated();
@@ -1068,10 +1087,10 @@ void UInventoryComponent::EquipItemOnSlot(const FSlot& Slot)
 		const int32 EquipmentSlotIndex = GetEquipmentSlotIndexByType(SecondarySlot.Type);
 
 		EquipmentSlots[EquipmentSlotIndex].Data = Slot;
-		EquipmentSlots[EquipmentSlotIndex].Data.ItemInstance->ResetRotation();
+		EquipmentSlots[EquipmentSlotIndex].Data.ResetRotation();
 		
-		NotifyInventoryItemEquipped(Slot.ItemInstance->Item, Slot.Quantity);
-		K2_OnInventoryItemEquipped(Slot.ItemInstance->Item, Slot.Quantity);
+		NotifyInventoryItemEquipped(Slot.GetItem(), Slot.Quantity);
+		K2_OnInventoryItemEquipped(Slot.GetItem(), Slot.Quantity);
 		Slots.Remove(Slot);
 
 		NotifyInventoryUpdated();
@@ -1082,15 +1101,18 @@ void UInventoryComponent::EquipItemOnSlot(const FSlot& Slot)
 		const int32 EquipmentSlotIndex = GetEquipmentSlotIndexByType(PrimarySlot.Type);
 
 		int32 AddedQuantity = 0;
-		const bool bIsAdded = AddExistingItem_Internal(PrimarySlot.Data.ItemInstance, PrimarySlot.Data.Quantity, AddedQuantity);
+		const bool bIsAdded = AddExistingItem_Internal(PrimarySlot.Data.GetItem(), PrimarySlot.Data.Quantity, AddedQuantity);
 
 		if (bIsAdded)
 		{
+			// the unequipped item got a new instance when it was added back
+			ReleaseItemInstance(PrimarySlot.Data);
+
 			EquipmentSlots[EquipmentSlotIndex].Data = Slot;
-			EquipmentSlots[EquipmentSlotIndex].Data.ItemInstance->ResetRotation();
+			EquipmentSlots[EquipmentSlotIndex].Data.ResetRotation();
 			
-			NotifyInventoryItemEquipped(Slot.ItemInstance->Item, Slot.Quantity);
-			K2_OnInventoryItemEquipped(Slot.ItemInstance->Item, Slot.Quantity);
+			NotifyInventoryItemEquipped(Slot.GetItem(), Slot.Quantity);
+			K2_OnInventoryItemEquipped(Slot.GetItem(), Slot.Quantity);
 			Slots.Remove(Slot);
 
 			NotifyInventoryUpdated();
@@ -1101,6 +1123,8 @@ void UInventoryComponent::EquipItemOnSlot(const FSlot& Slot)
 
 void UInventoryComponent::UnequipItem(const EEquipmentSlotType EquipmentSlot)
 {
+	NoteAccess();
+
 	if (EquipmentSlot == EEquipmentSlotType::None)
 	{
 		return;
@@ -1113,16 +1137,19 @@ void UInventoryComponent::UnequipItem(const EEquipmentSlotType EquipmentSlot)
 		const int32 EquipmentSlotIndex = GetEquipmentSlotIndexByType(EquipmentSlot);
 		
 		int32 AddedQuantity = 0;
-		const bool bIsAdded = AddExistingItem_Internal(TargetSlot.Data.ItemInstance, TargetSlot.Data.Quantity, AddedQuantity);
+		const bool bIsAdded = AddExistingItem_Internal(TargetSlot.Data.GetItem(), TargetSlot.Data.Quantity, AddedQuantity);
 
 		if (bIsAdded && AddedQuantity == TargetSlot.Data.Quantity)
 		{
 			//EquipmentSlots[EquipmentSlotIndex].Data.OwnerInventory = nullptr;
+			ReleaseItemInstance(TargetSlot.Data);
+
+			EquipmentSlots[EquipmentSlotIndex].Data.Instance = FItemInstanceData();
 			EquipmentSlots[EquipmentSlotIndex].Data.ItemInstance = nullptr;
 			EquipmentSlots[EquipmentSlotIndex].Data.Quantity = 0;
 
-			NotifyInventoryItemUnequipped(TargetSlot.Data.ItemInstance->Item, TargetSlot.Data.Quantity);
-			K2_OnInventoryItemUnequipped(TargetSlot.Data.ItemInstance->Item, TargetSlot.Data.Quantity);
+			NotifyInventoryItemUnequipped(TargetSlot.Data.GetItem(), TargetSlot.Data.Quantity);
+			K2_OnInventoryItemUnequipped(TargetSlot.Data.GetItem(), TargetSlot.Data.Quantity);
 
 			NotifyInventoryUpdated();
 			NotifyInventoryWeightChanged();
@@ -1132,12 +1159,14 @@ void UInventoryComponent::UnequipItem(const EEquipmentSlotType EquipmentSlot)
 
 bool UInventoryComponent::DropItemOnSlot(const FSlot& Slot)
 {
-	if (!Slot.ItemInstance->Item->bCanBeDropped)
+	NoteAccess();
+
+	if (!Slot.GetItem()->bCanBeDropped)
 	{
 		return false;
 	}
 
-	if (!Slot.ItemInstance->Item->PickupClass)
+	if (!Slot.GetItem()->PickupClass)
 	{
 		return false;
 	}
@@ -1149,19 +1178,9 @@ bool UInventoryComponent::DropItemOnSlot(const FSlot& Slot)
     if (bIsRemoved)
     {
     	const FVector SpawnLocation = GetOwner()->GetActorLocation() + GetOwner()->GetActorForwardVector() * PickupSpawnRadiusFromPlayer;
+    	const FTransform SpawnTransform = FTransform(FRotator::ZeroRotator, SpawnLocation, DataCopy.GetItem()->PickupStaticMeshScale);
 
-    	FActorSpawnParameters SpawnParams;
-    	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-
-    	APickup* SpawnedPickup = GetWorld()->SpawnActor<APickup>(DataCopy.ItemInstance->Item->PickupClass, SpawnLocation, FRotator(), SpawnParams);
-    	if (SpawnedPickup)
-    	{
-    		SpawnedPickup->SetActorScale3D(DataCopy.ItemInstance->Item->PickupStaticMeshScale);
-    		SpawnedPickup->SetPickupData(DataCopy.ItemInstance, DataCopy.Quantity);
-    		return true;
-    	}
-
-    	return false;
+    	return SpawnPickup_Internal(DataCopy.GetItem(), DataCopy.Quantity, SpawnTransform);
     }
 
 	return false;
@@ -1169,6 +1188,8 @@ bool UInventoryComponent::DropItemOnSlot(const FSlot& Slot)
 
 bool UInventoryComponent::LootItem(APickup* Pickup, int32& LootedQuantity)
 {
+	NoteAccess();
+
 	LootedQuantity = 0;
 	
 	if (Pickup == nullptr)
@@ -1177,97 +1198,282 @@ bool UInventoryComponent::LootItem(APickup* Pickup, int32& LootedQuantity)
 	}
 
 	int32 AddedQuantity = 0;
-	const bool bIsLooted = AddExistingItem(Pickup->ItemInstance, Pickup->Quantity, AddedQuantity);
+	const bool bIsLooted = AddNewItem(Pickup->Item, Pickup->Quantity, AddedQuantity);
 
 	LootedQuantity = AddedQuantity;
-	
-	if (bIsLooted)
+
+	// an add that ran out of room still keeps what it added, the pickup must lose it either way
+	if (LootedQuantity > 0)
 	{
 		if (Pickup->Quantity - LootedQuantity <= 0)
 		{
-			Pickup->Destroy();
+			UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>();
+			check(PickupSubsystem != nullptr);
+
+			PickupSubsystem->ReleasePickup(Pickup);
 		}
 		else
 		{
 			Pickup->Quantity = FMath::Clamp((Pickup->Quantity - LootedQuantity), 0, INT32_MAX);
 		}
-
-		return true;
 	}
-	
-	return false;
+
+	return bIsLooted;
 }
 
-void UInventoryComponent::SpawnItem(const UItem* Item, const int32 Quantity, const FTransform& Transform)
+bool UInventoryComponent::LootAllInRadius(const FVector& Center, const float Radius, const FLootFilter& Filter, TArray<FLootedItem>& LootedItems)
 {
-	if (Item == nullptr)
-	{
-		return;
-	}
+	NoteAccess();
 
-	if (Quantity <= 0)
-	{
-		return;
-	}
+	LootedItems.Empty();
 
-	if (!Transform.IsValid())
+	UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>();
+	check(PickupSubsystem != nullptr);
+
+	TArray<APickup*> Pickups;
+	PickupSubsystem->GetPickupsInRadius(Center, Radius, Pickups);
+
+	Pickups.RemoveAllSwap([&Filter](const APickup* Pickup)
 	{
-		return;
-	}
+		return Pickup->Item == nullptr || Pickup->Quantity <= 0 || !Filter.Matches(Pickup->Item);
+	});
 
-	if (!Item->bCanBeDropped)
+	if (Pickups.Num() == 0)
 	{
-		return;
+		return false;
 	}
 
-	if (!Item->PickupClass)
+	Pickups.Sort([&Center](const APickup& A, const APickup& B)
 	{
-		return;
-	}
+		const int32 PriorityA = A.Item->GetDefinition().LootPriority;
+		const int32 PriorityB = B.Item->GetDefinition().LootPriority;
 
-	FActorSpawnParameters SpawnParams;
-	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		if (PriorityA != PriorityB)
+		{
+			return PriorityA > PriorityB;
+		}
 
-	UItemInstance* ItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-	if (ItemInstance == nullptr)
-	{
-		return;
-	}
-	
-	APickup* SpawnedPickup = GetWorld()->SpawnActor<APickup>(Item->PickupClass, Transform.GetLocation(), Transform.GetRotation().Rotator(), SpawnParams);
-	if (SpawnedPickup)
+		return FVector::DistSquared(A.GetActorLocation(), Center) < FVector::DistSquared(B.GetActorLocation(), Center);
+	});
+
+	if (Filter.MaxPickups > 0 && Pickups.Num() > Filter.MaxPickups)
 	{
-		SpawnedPickup->SetActorScale3D(Item->PickupStaticMeshScale);
-		SpawnedPickup->SetPickupData(ItemInstance, Quantity);
+		Pickups.SetNum(Filter.MaxPickups);
 	}
-}
 
-void UInventoryComponent::UseItemOnSlot(const FSlot& Slot)
-{
-	if (Slot.IsEmpty())
+	BeginNotificationBatch();
+
+	for (APickup* Pickup: Pickups)
 	{
-		return;
-	}
-	
-	if (!Slot.ItemInstance->Item->bCanBeConsumed)
+		UItem* Item = Pickup->Item;
+
+		int32 AddedQuantity = 0;
+		AddExistingItem_Internal(Item, Pickup->Quantity, AddedQuantity);
+
+		if (AddedQuantity <= 0)
+		{
+			continue;
+		}
+
+		if (Pickup->Quantity - AddedQuantity <= 0)
+		{
+			PickupSubsystem->ReleasePickup(Pickup);
+		}
+		else
+		{
+			Pickup->Quantity = Pickup->Quantity - AddedQuantity;
+		}
+
+		FLootedItem* LootedItem = LootedItems.FindByPredicate([Item](const FLootedItem& Entry)
+		{
+			return Entry.Item == Item;
+		});
+
+		if (LootedItem)
+		{
+			LootedItem->Quantity += AddedQuantity;
+		}
+		else
+		{
+			LootedItems.Add(FLootedItem(Item, AddedQuantity));
+		}
+	}
+
+	if (LootedItems.Num() > 0)
+	{
+		NotifyInventoryUpdated();
+		NotifyInventoryWeightChanged();
+	}
+
+	EndNotificationBatch();
+
+	if (LootedItems.Num() > 0)
+	{
+		NotifyInventoryItemsLooted(LootedItems);
+		return true;
+	}
+
+	return false;
+}
+
+void UInventoryComponent::SpawnItem(UItem* Item, const int32 Quantity, const FTransform& Transform)
+{
+	if (Item == nullptr)
+	{
+		return;
+	}
+
+	if (Quantity <= 0)
+	{
+		return;
+	}
+
+	if (!Transform.IsValid())
+	{
+		return;
+	}
+
+	if (!Item->bCanBeDropped)
+	{
+		return;
+	}
+
+	if (!Item->PickupClass)
+	{
+		return;
+	}
+
+	const FTransform SpawnTransform = FTransform(Transform.GetRotation(), Transform.GetLocation(), Item->PickupStaticMeshScale);
+	SpawnPickup_Internal(Item, Quantity, SpawnTransform);
+}
+
+void UInventoryComponent::SpawnItems(const TArray<FItemSpawnRequest>& Requests)
+{
+	UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>();
+	check(PickupSubsystem != nullptr);
+
+	ULootProxySubsystem* LootProxySubsystem = GetWorld()->GetSubsystem<ULootProxySubsystem>();
+	const bool bUseLootProxies = LootProxySubsystem && LootProxySubsystem->bUseLootProxies;
+
+	for (const FItemSpawnRequest& Request: Requests)
+	{
+		UItem* Item = Request.Item;
+
+		const bool bIsValidRequest = Item && Request.Quantity > 0 && Request.Transform.IsValid() && Item->bCanBeDropped && Item->PickupClass;
+		if (!bIsValidRequest)
+		{
+			continue;
+		}
+
+		const FTransform SpawnTransform = FTransform(Request.Transform.GetRotation(), Request.Transform.GetLocation(), Item->PickupStaticMeshScale);
+
+		// loot proxies are plain records, their activation is already spread over updates
+		if (bUseLootProxies)
+		{
+			LootProxySubsystem->AddLoot(Item, Request.Quantity, SpawnTransform);
+		}
+		else
+		{
+			PickupSubsystem->QueuePickupSpawn(Item, Request.Quantity, SpawnTransform);
+		}
+	}
+}
+
+bool UInventoryComponent::AddItemsAsync(const TArray<FPendingItem>& Items, const FOnItemsPlaced& OnPlaced)
+{
+	FPlacementRequest Request;
+
+	for (const FPendingItem& PendingItem: Items)
+	{
+		if (PendingItem.Item && PendingItem.Quantity > 0)
+		{
+			Request.Items.Add(PendingItem);
+		}
+	}
+
+	if (Request.Items.Num() == 0)
+	{
+		return false;
+	}
+
+	for (const FPendingItem& PendingItem: Request.Items)
+	{
+		PlacementItems.AddUnique(PendingItem.Item);
+	}
+
+	Request.OnPlaced = OnPlaced;
+	PlacementRequests.Add(MoveTemp(Request));
+
+	StartPlacement();
+
+	return true;
+}
+
+bool UInventoryComponent::SortItemsAsync(const FOnItemsPlaced& OnSorted)
+{
+	// slots outside the loaded stash regions can't be moved
+	if (IsStashOpen())
+	{
+		return false;
+	}
+
+	FPlacementRequest Request;
+	Request.OnPlaced = OnSorted;
+	Request.bIsSort = true;
+
+	PlacementRequests.Add(MoveTemp(Request));
+
+	StartPlacement();
+
+	return true;
+}
+
+int32 UInventoryComponent::GetNumPendingPlacements() const
+{
+	return PlacementRequests.Num();
+}
+
+void UInventoryComponent::UseItemOnSlot(const FSlot& Slot)
+{
+	NoteAccess();
+
+	if (Slot.IsEmpty())
+	{
+		return;
+	}
+	
+	UItem* UsedItem = Slot.GetItem();
+
+	if (!UsedItem->bCanBeConsumed)
 	{
 		return;
 	}
 
-	if (Slot.Quantity < Slot.ItemInstance->Item->ConsumedQuantityPerUsage)
+	if (Slot.Quantity < UsedItem->ConsumedQuantityPerUsage)
 	{
 		return;
 	}
 
-	UItemInstance* UsedItemInstance = Slot.ItemInstance;
-	const int32 UsedQuantity = UsedItemInstance->Item->ConsumedQuantityPerUsage;
+	// only item instance classes overriding OnUsed have an object to notify
+	const FSlot UsedSlot = Slot;
+	const int32 UsedQuantity = UsedItem->ConsumedQuantityPerUsage;
 
 	int32 RemovedQuantity = 0;
-	const bool bIsConsumed = RemoveItemOnSlot(Slot, Slot.ItemInstance->Item->ConsumedQuantityPerUsage, RemovedQuantity);
+	const bool bIsConsumed = RemoveItemOnSlot_Internal(UsedSlot, UsedQuantity, RemovedQuantity);
 	if (bIsConsumed)
 	{
-		UsedItemInstance->OnUsed();
-		NotifyInventoryItemUsed(UsedItemInstance->Item, UsedQuantity);
+		if (UsedSlot.ItemInstance)
+		{
+			UsedSlot.ItemInstance->OnUsed();
+		}
+
+		NotifyInventoryItemUsed(UsedItem, UsedQuantity);
+
+		// the instance is released once OnUsed ran, consuming the last of a stack must not hand out a reset object
+		if (RemovedQuantity >= UsedSlot.Quantity)
+		{
+			ReleaseItemInstance(UsedSlot);
+		}
 	}
 }
 
@@ -1296,6 +1502,8 @@ int32 UInventoryComponent::GetMoney() const
 
 bool UInventoryComponent::IsValidEquipmentSlots()
 {
+	NoteAccess();
+
 	if (EquipmentSlots.Num() <= 0)
 	{
 		return false;
@@ -1337,6 +1545,8 @@ bool UInventoryComponent::IsValidEquipmentSlots()
 
 FEquipmentSlot UInventoryComponent::GetEquipmentSlotByType(const EEquipmentSlotType SlotType)
 {
+	NoteAccess();
+
 	for (const FEquipmentSlot& Slot: EquipmentSlots)
 	{
 		if (Slot.Type == SlotType)
@@ -1350,6 +1560,8 @@ FEquipmentSlot UInventoryComponent::GetEquipmentSlotByType(const EEquipmentSlotT
 
 int32 UInventoryComponent::GetEquipmentSlotIndexByType(const EEquipmentSlotType SlotType)
 {
+	NoteAccess();
+
 	int32 Index = INDEX_NONE;
 	for (const FEquipmentSlot& Slot: EquipmentSlots)
 	{
@@ -1364,10 +1576,127 @@ int32 UInventoryComponent::GetEquipmentSlotIndexByType(const EEquipmentSlotType
 	return INDEX_NONE;
 }
 
-bool UInventoryComponent::AddExistingItem_Internal(const UItemInstance* ItemInstance, const int32 Quantity, int32& AddedQuantity)
+bool UInventoryComponent::SaveInventory(TArray<uint8>& OutData) const
+{
+	FInventorySaveData SaveData;
+	return MakeSaveData(SaveData) && SaveData.SaveToBytes(OutData);
+}
+
+bool UInventoryComponent::LoadInventory(const TArray<uint8>& Data)
+{
+	FInventorySaveData SaveData;
+	return SaveData.LoadFromBytes(Data) && ApplySaveData(SaveData);
+}
+
+bool UInventoryComponent::OpenJournal(const FString& Filename)
+{
+	NoteAccess();
+
+	if (!Journal.IsValid())
+	{
+		Journal = MakeShared<FInventoryJournal>();
+	}
+
+	return Journal->Open(this, FInventorySaveData::GetSavePath(Filename), MaxJournalBytes);
+}
+
+void UInventoryComponent::CloseJournal()
+{
+	if (Journal.IsValid())
+	{
+		Journal->Close();
+	}
+}
+
+bool UInventoryComponent::IsJournalOpen() const
+{
+	return Journal.IsValid() && Journal->IsOpen();
+}
+
+bool UInventoryComponent::OpenStash(const FString& Filename)
+{
+	NoteAccess();
+
+	if (!Stash.IsValid())
+	{
+		Stash = MakeShared<FInventoryStash>();
+	}
+
+	StashQuerySnapshot.Reset();
+
+	const bool bIsOpen = Stash->Open(this, FInventorySaveData::GetSavePath(Filename), StashPageSize);
+
+	if (bIsOpen)
+	{
+		NotifyStashRegionChanged();
+	}
+
+	PublishQuerySnapshot();
+
+	return bIsOpen;
+}
+
+void UInventoryComponent::CloseStash()
+{
+	if (Stash.IsValid() && Stash->IsOpen())
+	{
+		StashQuerySnapshot.Reset();
+
+		Stash->Close();
+
+		NotifyStashRegionChanged();
+		PublishQuerySnapshot();
+	}
+}
+
+void UInventoryComponent::LoadStashRegion(const FPoint2D& Min, const FPoint2D& Max)
+{
+	NoteAccess();
+
+	if (Stash.IsValid())
+	{
+		StashQuerySnapshot.Reset();
+		Stash->LoadRegion(Min, Max);
+	}
+}
+
+void UInventoryComponent::UnloadStashRegion(const FPoint2D& Min, const FPoint2D& Max)
+{
+	if (Stash.IsValid())
+	{
+		StashQuerySnapshot.Reset();
+		Stash->UnloadRegion(Min, Max);
+	}
+}
+
+bool UInventoryComponent::FlushStash()
+{
+	return Stash.IsValid() && Stash->Flush();
+}
+
+bool UInventoryComponent::IsStashOpen() const
+{
+	return Stash.IsValid() && Stash->IsOpen();
+}
+
+bool UInventoryComponent::IsCellLoaded(const FPoint2D& Coordinates) const
+{
+	if (Stash.IsValid() && Stash->IsOpen())
+	{
+		return Stash->IsCellLoaded(Coordinates);
+	}
+
+	return IsWithinBoundaries(Coordinates);
+}
+
+bool UInventoryComponent::AddExistingItem_Internal(UItem* Item, const int32 Quantity, int32& AddedQuantity)
+{
+	return AddItem_Internal(Item, Quantity, AddedQuantity, false);
+}
+
+bool UInventoryComponent::AddItem_Internal(UItem* Item, const int32 Quantity, int32& AddedQuantity, const bool bNotifyAdded)
 {
 	AddedQuantity = 0;
-	const UItem* Item = ItemInstance->Item;
 	
 	if (IsFull())
 	{
@@ -1379,220 +1708,321 @@ bool UInventoryComponent::AddExistingItem_Internal(const UItemInstance* ItemInst
 	{
 		return false;
 	}
-	
-	int32 RemainingQuantity = Quantity;
-	
-	if (Item->bCanBeStacked)
+
+	// the stacks topped up or made before running out of space stay in the inventory
+	const auto FailAdd = [this, bNotifyAdded]()
 	{
-		if (DoesItemExist(Item))
+		if (bNotifyAdded)
 		{
-			for (FSlot& Slot: Slots)
-			{
-				const bool bCanStack = !Slot.IsOnMaxStackSize() && Slot.ItemInstance->Item == Item;
-				if (bCanStack)
-				{
-					const int32 MissingStackQuantity = Slot.GetMissingStackQuantity();
-				
-					if (RemainingQuantity <= MissingStackQuantity)
-					{
-						if (!CanCarryItem(Item, MissingStackQuantity))
-						{
-							NotifyInventoryInsufficientSpace();
-							return false;
-						}
-					
-						Slot.UpdateQuantity(MissingStackQuantity);
-						AddedQuantity += MissingStackQuantity;
-						RemainingQuantity -= MissingStackQuantity;
-						
-						return true;
-					}
-	
-					if (!CanCarryItem(Item, MissingStackQuantity))
-					{
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				
-					Slot.UpdateQuantity(MissingStackQuantity);
-					AddedQuantity += MissingStackQuantity;
-					RemainingQuantity -= MissingStackQuantity;
-				}
-			}
+			NotifyInventoryUpdated();
 		}
+
+		NotifyInventoryInsufficientSpace();
+		return false;
+	};
 	
-		while (RemainingQuantity >= Item->MaxStackSize)
-		{
-			UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-			check(NewItemInstance != nullptr);
-	
-			FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-			if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, Item->MaxStackSize))
-			{
-				NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
-				
-				FSlot NewSlot = FSlot(NewItemInstance, Item->MaxStackSize, this);
-				Slots.Add(NewSlot);
-	
-				AddedQuantity += Item->MaxStackSize;
-				RemainingQuantity -= Item->MaxStackSize;
-			}
-			else
-			{
-				// try to rotate the item and see if it fits
-				if (Item->CanBeRotated())
-				{
-					NewItemInstance->Rotate();
-					FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-	
-					if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, Item->MaxStackSize))
-					{
-						NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
-	
-						FSlot NewSlot = FSlot(NewItemInstance, Item->MaxStackSize, this);
-						Slots.Add(NewSlot);
+	int32 RemainingQuantity = Quantity;
 	
-						AddedQuantity += Item->MaxStackSize;
-						RemainingQuantity -= Item->MaxStackSize;
-					}
-					else
-					{
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				}
-				else
-				{
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-		}
-		
-		if (RemainingQuantity > 0)
+	const FItemDefinition& ItemDefinition = Item->GetDefinition();
+	const int32 MaxSlotQuantity = FMath::Max(ItemDefinition.GetMaxSlotQuantity(), 1);
+
+	if (ItemDefinition.bCanBeStacked && DoesItemExist(Item))
+	{
+		for (FSlot& Slot: Slots)
 		{
-			UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-			check(NewItemInstance != nullptr);
-	
-			const FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-			if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, RemainingQuantity))
+			if (RemainingQuantity <= 0)
 			{
-				NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
-	
-				const FSlot NewSlot = FSlot(NewItemInstance, RemainingQuantity, this);
-				Slots.Add(NewSlot);
-	
-				AddedQuantity += RemainingQuantity;
-	
-				return true;
+				break;
 			}
-			else
+
+			const bool bCanStack = !Slot.IsOnMaxStackSize() && Slot.GetItem() == Item;
+			if (bCanStack)
 			{
-				// try to rotate the item and see if it fits
-				if (Item->CanBeRotated())
-				{
-					NewItemInstance->Rotate();
-					const FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-	
-					if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, RemainingQuantity))
-					{
-						NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
-	
-						const FSlot NewSlot = FSlot(NewItemInstance, RemainingQuantity, this);
-						Slots.Add(NewSlot);
-	
-						AddedQuantity += RemainingQuantity;
-	
-						return true;
-					}
-					else
-					{
-						NotifyInventoryInsufficientSpace();
-						return false;
-					}
-				}
-				else
+				const int32 StackedQuantity = FMath::Min(RemainingQuantity, Slot.GetMissingStackQuantity());
+
+				if (!CanCarryItem(Item, StackedQuantity))
 				{
-					NotifyInventoryInsufficientSpace();
-					return false;
+					return FailAdd();
 				}
+
+				Slot.UpdateQuantity(StackedQuantity);
+				AddedQuantity += StackedQuantity;
+				RemainingQuantity -= StackedQuantity;
 			}
 		}
-	
-		return true;
 	}
-	
+
+	// whole stacks first, then the remainder
 	while (RemainingQuantity > 0)
 	{
-		UItemInstance* NewItemInstance = CreateItemInstance(Item->ItemInstanceClass);
-		check(NewItemInstance != nullptr);
-	
-		const FPoint2D CoordsWhereItemCanFit = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-		if (IsWithinBoundaries(CoordsWhereItemCanFit) && CanCarryItem(Item, 1))
+		const int32 SlotQuantity = FMath::Min(RemainingQuantity, MaxSlotQuantity);
+
+		FItemInstanceData NewInstance(Item);
+
+		if (!FindItemPlacement(NewInstance) || !CanCarryItem(Item, SlotQuantity))
 		{
-			NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFit;
-	
-			const FSlot NewSlot = FSlot(NewItemInstance, 1, this);
-			Slots.Add(NewSlot);
-	
-			AddedQuantity += 1;
-			RemainingQuantity -= 1;
+			return FailAdd();
 		}
-		else
+
+		const FSlot NewSlot = MakeSlot(NewInstance, SlotQuantity);
+		Slots.Add(NewSlot);
+
+		AddedQuantity += SlotQuantity;
+		RemainingQuantity -= SlotQuantity;
+	}
+
+	if (bNotifyAdded)
+	{
+		NotifyInventoryUpdated();
+		NotifyInventoryWeightChanged();
+		NotifyInventoryItemAdded(Item, AddedQuantity);
+	}
+
+	return true;
+}
+
+bool UInventoryComponent::SpawnPickup_Internal(UItem* Item, const int32 Quantity, const FTransform& Transform) const
+{
+	ULootProxySubsystem* LootProxySubsystem = GetWorld()->GetSubsystem<ULootProxySubsystem>();
+	if (LootProxySubsystem && LootProxySubsystem->bUseLootProxies)
+	{
+		return LootProxySubsystem->AddLoot(Item, Quantity, Transform);
+	}
+
+	UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>();
+	check(PickupSubsystem != nullptr);
+
+	return PickupSubsystem->SpawnPickup(Item, Quantity, Transform) != nullptr;
+}
+
+void UInventoryComponent::BeginNotificationBatch()
+{
+	NotificationBatchDepth++;
+}
+
+void UInventoryComponent::EndNotificationBatch()
+{
+	check(NotificationBatchDepth > 0);
+
+	NotificationBatchDepth--;
+	if (NotificationBatchDepth > 0)
+	{
+		return;
+	}
+
+	if (bPendingInventoryUpdated)
+	{
+		bPendingInventoryUpdated = false;
+		NotifyInventoryUpdated();
+	}
+
+	if (bPendingInventoryWeightChanged)
+	{
+		bPendingInventoryWeightChanged = false;
+		NotifyInventoryWeightChanged();
+	}
+
+	if (bPendingInventoryInsufficientSpace)
+	{
+		bPendingInventoryInsufficientSpace = false;
+		NotifyInventoryInsufficientSpace();
+	}
+}
+
+bool UInventoryComponent::MakeSaveData(FInventorySaveData& OutSaveData) const
+{
+	// the hibernated data already is a save, saving doesn't need to wake the inventory up
+	if (bIsHibernating)
+	{
+		if (!OutSaveData.LoadFromCompressedBytes(HibernatedData))
 		{
-			// try to rotate the item and see if it fits
-			if (Item->CanBeRotated())
-			{
-				NewItemInstance->Rotate();
-				const FPoint2D CoordsWhereItemCanFitRotated = GetFreeCellWhereItemCanFit(NewItemInstance->SizeInCells);
-	
-				if (IsWithinBoundaries(CoordsWhereItemCanFitRotated) && CanCarryItem(Item, 1))
-				{
-					NewItemInstance->TopLeftCoordinates = CoordsWhereItemCanFitRotated;
-	
-					const FSlot NewSlot = FSlot(NewItemInstance, 1, this);
-					Slots.Add(NewSlot);
-	
-					AddedQuantity += 1;
-					RemainingQuantity -= 1;
-				}
-				else
-				{
-					NotifyInventoryInsufficientSpace();
-					return false;
-				}
-			}
-			else
-			{
-				NotifyInventoryInsufficientSpace();
-				return false;
-			}
+			return false;
+		}
+
+		// money is kept live while hibernating, the hibernated copy may be stale
+		OutSaveData.Money = Money;
+
+		OutSaveData.ResolveItemNames();
+		return true;
+	}
+
+	if (GridSize.X > FInventorySaveData::MaxGridSize || GridSize.Y > FInventorySaveData::MaxGridSize)
+	{
+		return false;
+	}
+
+	OutSaveData.ItemRegistryHash = UAssetManager_Custom::Get().GetItemRegistryHash();
+	OutSaveData.GridSize = GridSize;
+	OutSaveData.Money = Money;
+
+	OutSaveData.Slots.Reset(Slots.Num());
+	OutSaveData.EquipmentSlots.Reset();
+
+	for (const FSlot& Slot: Slots)
+	{
+		if (!OutSaveData.Slots.AddDefaulted_GetRef().SetFromSlot(Slot))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Can't save %s, %s isn't registered in the item registry"), *GetNameSafe(this), *GetNameSafe(Slot.GetItem()));
+			return false;
+		}
+	}
+
+	for (const FEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		if (!EquipmentSlot.Data.IsOccupied())
+		{
+			continue;
+		}
+
+		FSavedEquipmentSlot& SavedEquipmentSlot = OutSaveData.EquipmentSlots.AddDefaulted_GetRef();
+		SavedEquipmentSlot.Type = EquipmentSlot.Type;
+
+		if (!SavedEquipmentSlot.Slot.SetFromSlot(EquipmentSlot.Data))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Can't save %s, %s isn't registered in the item registry"), *GetNameSafe(this), *GetNameSafe(EquipmentSlot.Data.GetItem()));
+			return false;
 		}
 	}
 
+	OutSaveData.ResolveItemNames();
+
+	return true;
+}
+
+bool UInventoryComponent::ApplySaveData(const FInventorySaveData& SaveData)
+{
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	// every item is resolved before anything is changed, a failed load leaves the inventory as it was
+	TArray<UItem*> SlotItems;
+	SlotItems.Reserve(SaveData.Slots.Num());
+
+	for (const FSavedSlot& SavedSlot: SaveData.Slots)
+	{
+		UItem* Item = AssetManager.GetLoadedItem(SavedSlot.ItemId);
+		if (Item == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Can't load %s, %s isn't loaded"), *GetNameSafe(this), *AssetManager.GetItemPrimaryAssetId(SavedSlot.ItemId).ToString());
+			return false;
+		}
+
+		SlotItems.Add(Item);
+	}
+
+	TArray<UItem*> EquipmentItems;
+	EquipmentItems.Reserve(SaveData.EquipmentSlots.Num());
+
+	for (const FSavedEquipmentSlot& SavedEquipmentSlot: SaveData.EquipmentSlots)
+	{
+		UItem* Item = AssetManager.GetLoadedItem(SavedEquipmentSlot.Slot.ItemId);
+		if (Item == nullptr)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Can't load %s, %s isn't loaded"), *GetNameSafe(this), *AssetManager.GetItemPrimaryAssetId(SavedEquipmentSlot.Slot.ItemId).ToString());
+			return false;
+		}
+
+		EquipmentItems.Add(Item);
+	}
+
+	BeginNotificationBatch();
+
+	GridSize = SaveData.GridSize;
+	InitializeGrid();
+
+	Money = SaveData.Money;
+	Slots.Reserve(SaveData.Slots.Num());
+
+	for (int32 I = 0; I < SaveData.Slots.Num(); I++)
+	{
+		const FSavedSlot& SavedSlot = SaveData.Slots[I];
+
+		FItemInstanceData Instance(SlotItems[I]);
+		Instance.TopLeftCoordinates = SavedSlot.GetTopLeftCoordinates();
+
+		if (SavedSlot.IsRotated())
+		{
+			Instance.Rotate();
+		}
+
+		Slots.Add(MakeSavedSlot(Instance, SavedSlot));
+	}
+
+	// the item size or the grid may have changed since the data was saved
+	RelocateMisplacedSlots();
+
+	for (int32 I = 0; I < SaveData.EquipmentSlots.Num(); I++)
+	{
+		const FSavedEquipmentSlot& SavedEquipmentSlot = SaveData.EquipmentSlots[I];
+
+		const int32 EquipmentSlotIndex = GetEquipmentSlotIndexByType(SavedEquipmentSlot.Type);
+		if (EquipmentSlotIndex == INDEX_NONE)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s has no equipment slot for the saved %s"), *GetNameSafe(this), *GetNameSafe(EquipmentItems[I]));
+			continue;
+		}
+
+		// equipped items are never rotated
+		EquipmentSlots[EquipmentSlotIndex].Data = MakeSavedSlot(FItemInstanceData(EquipmentItems[I]), SavedEquipmentSlot.Slot);
+	}
+
+	NotifyInventoryUpdated();
+	NotifyInventoryWeightChanged();
+	NotifyMoneyChanged();
+
+	EndNotificationBatch();
+
 	return true;
 }
 
 void UInventoryComponent::NotifyInventoryInitialized()
 {
+	bIsInitialized = true;
+
 	OnInventoryInitialized.Broadcast();
 	K2_OnInventoryInitialized();
 }
 
 void UInventoryComponent::NotifyInventoryUpdated()
 {
+	MarkSlotsChanged();
+
+	if (NotificationBatchDepth > 0)
+	{
+		bPendingInventoryUpdated = true;
+		return;
+	}
+
+	if (Journal.IsValid())
+	{
+		Journal->RecordChanges();
+	}
+
+	PublishQuerySnapshot();
+
 	OnInventoryUpdated.Broadcast();
 	K2_OnInventoryUpdated();
 }
 
 void UInventoryComponent::NotifyInventoryInsufficientSpace()
 {
+	if (NotificationBatchDepth > 0)
+	{
+		bPendingInventoryInsufficientSpace = true;
+		return;
+	}
+
 	OnInsufficientSpace.Broadcast();
 	K2_OnInventoryInsufficientSpace();
 }
 
 void UInventoryComponent::NotifyInventoryWeightChanged() 
 {
+	if (NotificationBatchDepth > 0)
+	{
+		bPendingInventoryWeightChanged = true;
+		return;
+	}
+
 	OnWeightChanged.Broadcast();
 	K2_OnInventoryWeightChanged();
 }
@@ -1611,6 +2041,13 @@ void UInventoryComponent::NotifyInventoryItemRemoved(UItem* InItem, const int32
 
 void UInventoryComponent::NotifyMoneyChanged()
 {
+	if (Journal.IsValid())
+	{
+		Journal->RecordChanges();
+	}
+
+	PublishQuerySnapshot();
+
 	OnMoneyChanged.Broadcast();
 	K2_OnMoneyChanged();
 }
@@ -1632,3 +2069,509 @@ void UInventoryComponent::NotifyInventoryItemUsed(UItem* InItem, const int32 InQ
 	OnItemUsed.Broadcast(InItem, InQuantity);
 	K2_OnInventoryItemUsed(InItem, InQuantity);
 }
+
+void UInventoryComponent::NotifyInventoryItemsLooted(const TArray<FLootedItem>& InLootedItems)
+{
+	OnItemsLooted.Broadcast(InLootedItems);
+	K2_OnInventoryItemsLooted(InLootedItems);
+}
+
+bool UInventoryComponent::Hibernate()
+{
+	if (bIsHibernating)
+	{
+		return true;
+	}
+
+	if (!bIsInitialized || NotificationBatchDepth > 0 || IsJournalOpen() || IsStashOpen())
+	{
+		return false;
+	}
+
+	// the instances are created again when waking up, blueprint variables would be lost with them
+	for (const FSlot& Slot: Slots)
+	{
+		if (Slot.ItemInstance && UItemInstance::HasBlueprintState(Slot.ItemInstance->GetClass()))
+		{
+			return false;
+		}
+	}
+
+	for (const FEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		if (EquipmentSlot.Data.ItemInstance && UItemInstance::HasBlueprintState(EquipmentSlot.Data.ItemInstance->GetClass()))
+		{
+			return false;
+		}
+	}
+
+	FInventorySaveData SaveData;
+	if (!MakeSaveData(SaveData) || !SaveData.SaveToCompressedBytes(HibernatedData))
+	{
+		HibernatedData.Empty();
+		return false;
+	}
+
+	const int64 LiveStateSize = GetLiveStateSize();
+
+	for (const FSlot& Slot: Slots)
+	{
+		HibernatedItems.AddUnique(Slot.GetItem());
+	}
+
+	for (FEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		if (EquipmentSlot.Data.IsOccupied())
+		{
+			HibernatedItems.AddUnique(EquipmentSlot.Data.GetItem());
+		}
+	}
+
+	ReleaseItemInstances();
+
+	Slots.Empty();
+	Cells.Empty();
+
+	for (FEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		EquipmentSlot.Data.Instance = FItemInstanceData();
+		EquipmentSlot.Data.Quantity = 0;
+	}
+
+	MarkSlotsChanged();
+
+	HibernatedData.Shrink();
+	HibernationBytesSaved = FMath::Max<int64>(LiveStateSize - HibernatedData.GetAllocatedSize() - HibernatedItems.GetAllocatedSize(), 0);
+	bIsHibernating = true;
+
+	INC_DWORD_STAT(STAT_HibernatingInventories);
+	INC_MEMORY_STAT_BY(STAT_HibernatedInventoryBytes, HibernatedData.GetAllocatedSize());
+	INC_MEMORY_STAT_BY(STAT_HibernationBytesSaved, HibernationBytesSaved);
+
+	return true;
+}
+
+void UInventoryComponent::WakeUp()
+{
+	if (!bIsHibernating)
+	{
+		return;
+	}
+
+	FInventorySaveData SaveData;
+	const bool bIsLoaded = SaveData.LoadFromCompressedBytes(HibernatedData);
+
+	// money changed while hibernating wins over the hibernated copy
+	SaveData.Money = Money;
+
+	// the hibernated items stay referenced until the slots reference them again
+	if (!bIsLoaded || !ApplySaveData(SaveData))
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s failed to wake up, its content is lost"), *GetNameSafe(this));
+		InitializeGrid();
+	}
+}
+
+bool UInventoryComponent::IsHibernating() const
+{
+	return bIsHibernating;
+}
+
+void UInventoryComponent::OnHibernateTimer()
+{
+	if (bWasAccessed)
+	{
+		bWasAccessed = false;
+		return;
+	}
+
+	Hibernate();
+}
+
+void UInventoryComponent::DiscardHibernatedData()
+{
+	if (!bIsHibernating)
+	{
+		return;
+	}
+
+	DEC_DWORD_STAT(STAT_HibernatingInventories);
+	DEC_MEMORY_STAT_BY(STAT_HibernatedInventoryBytes, HibernatedData.GetAllocatedSize());
+	DEC_MEMORY_STAT_BY(STAT_HibernationBytesSaved, HibernationBytesSaved);
+
+	HibernatedData.Empty();
+	HibernatedItems.Empty();
+	HibernationBytesSaved = 0;
+	bIsHibernating = false;
+}
+
+int64 UInventoryComponent::GetLiveStateSize() const
+{
+	int64 LiveStateSize = Slots.GetAllocatedSize() + Cells.GetAllocatedSize();
+
+	for (const FSlot& Slot: Slots)
+	{
+		LiveStateSize += Slot.ItemInstance ? Slot.ItemInstance->GetClass()->GetStructureSize() : 0;
+	}
+
+	for (const FEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		LiveStateSize += EquipmentSlot.Data.ItemInstance ? EquipmentSlot.Data.ItemInstance->GetClass()->GetStructureSize() : 0;
+	}
+
+	return LiveStateSize;
+}
+
+void UInventoryComponent::NotifyStashRegionChanged()
+{
+	MarkSlotsChanged();
+	UpdateCells();
+
+	OnStashRegionChanged.Broadcast();
+}
+
+void UInventoryComponent::MarkSlotsChanged()
+{
+	InventoryVersion++;
+}
+
+TSharedRef<const FInventoryQuerySnapshot, ESPMode::ThreadSafe> UInventoryComponent::GetQuerySnapshot() const
+{
+	FRWScopeLock Lock(QuerySnapshotLock, SLT_ReadOnly);
+	return QuerySnapshot.ToSharedRef();
+}
+
+void UInventoryComponent::PublishQuerySnapshot()
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryPublishQuerySnapshot);
+
+	TSharedPtr<FInventoryQuerySnapshot, ESPMode::ThreadSafe> Snapshot;
+
+	// the slots of a hibernating inventory are packed away, only its money can change meanwhile
+	if (bIsHibernating)
+	{
+		Snapshot = MakeShared<FInventoryQuerySnapshot, ESPMode::ThreadSafe>(*GetQuerySnapshot());
+	}
+	else
+	{
+		if (IsStashOpen() && !StashQuerySnapshot.IsValid())
+		{
+			const TSharedRef<FInventoryQuerySnapshot, ESPMode::ThreadSafe> NewStashQuerySnapshot = MakeShared<FInventoryQuerySnapshot, ESPMode::ThreadSafe>();
+			Stash->GetLoadedOccupancy(NewStashQuerySnapshot->Occupancy);
+
+			TMap<FItemId, int32> UnloadedItemQuantities;
+			Stash->CountUnloadedItemQuantities(UnloadedItemQuantities);
+
+			const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+			for (const TPair<FItemId, int32>& UnloadedItemQuantity: UnloadedItemQuantities)
+			{
+				if (const UItem* Item = AssetManager.GetLoadedItem(UnloadedItemQuantity.Key))
+				{
+					NewStashQuerySnapshot->ItemQuantities.Add(Item, UnloadedItemQuantity.Value);
+				}
+			}
+
+			StashQuerySnapshot = NewStashQuerySnapshot;
+		}
+
+		// the stash part is shared, only the occupancy of the loaded pages and the materialized slots are copied
+		Snapshot = MakeShared<FInventoryQuerySnapshot, ESPMode::ThreadSafe>();
+
+		if (IsStashOpen())
+		{
+			Snapshot->StashSnapshot = StashQuerySnapshot;
+			Snapshot->Occupancy = StashQuerySnapshot->Occupancy;
+		}
+		else
+		{
+			Snapshot->Occupancy = FInventoryGridOccupancy(GridSize);
+		}
+
+		for (const FSlot& Slot: Slots)
+		{
+			Snapshot->ItemQuantities.FindOrAdd(Slot.GetItem()) += Slot.Quantity;
+			Snapshot->Occupancy.Occupy(Slot.Instance.TopLeftCoordinates, Slot.Instance.Size);
+		}
+	}
+
+	Snapshot->InventoryVersion = InventoryVersion;
+	Snapshot->Money = Money;
+
+	// the previous snapshot is released outside of the lock, readers may still hold it
+	TSharedPtr<const FInventoryQuerySnapshot, ESPMode::ThreadSafe> PreviousSnapshot;
+
+	{
+		FRWScopeLock Lock(QuerySnapshotLock, SLT_Write);
+
+		PreviousSnapshot = MoveTemp(QuerySnapshot);
+		QuerySnapshot = Snapshot;
+	}
+}
+
+void UInventoryComponent::StartPlacement()
+{
+	if (bIsPlacementInFlight || PlacementRequests.Num() == 0)
+	{
+		return;
+	}
+
+	NoteAccess();
+
+	FPlacementRequest& Request = PlacementRequests[0];
+	Request.NumPlans++;
+
+	TSharedRef<FInventoryPlacementSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FInventoryPlacementSnapshot, ESPMode::ThreadSafe>();
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_InventoryPlacementSnapshot);
+		MakePlacementSnapshot(Request, *Snapshot);
+	}
+
+	// the slots kept changing while the previous plans were made, planning here guarantees the request completes
+	if (Request.NumPlans > MaxPlacementPlans)
+	{
+		FInventoryPlacementPlan Plan;
+		FInventoryPlacementSolver::Solve(*Snapshot, Plan);
+
+		ApplyPlacementPlan(Plan);
+		return;
+	}
+
+	bIsPlacementInFlight = true;
+
+	const uint32 Serial = ++PlacementSerial;
+	const TWeakObjectPtr<UInventoryComponent> WeakThis(this);
+
+	Async(EAsyncExecution::ThreadPool, [Snapshot, WeakThis, Serial]()
+	{
+		TSharedRef<FInventoryPlacementPlan, ESPMode::ThreadSafe> Plan = MakeShared<FInventoryPlacementPlan, ESPMode::ThreadSafe>();
+		FInventoryPlacementSolver::Solve(*Snapshot, *Plan);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, Serial, Plan]()
+		{
+			if (UInventoryComponent* Inventory = WeakThis.Get())
+			{
+				Inventory->OnPlacementPlanned(Serial, *Plan);
+			}
+		});
+	});
+}
+
+void UInventoryComponent::OnPlacementPlanned(const uint32 Serial, const FInventoryPlacementPlan& Plan)
+{
+	if (!bIsPlacementInFlight || Serial != PlacementSerial)
+	{
+		return;
+	}
+
+	bIsPlacementInFlight = false;
+
+	if (Plan.InventoryVersion != InventoryVersion)
+	{
+		StartPlacement();
+		return;
+	}
+
+	ApplyPlacementPlan(Plan);
+}
+
+void UInventoryComponent::MakePlacementSnapshot(const FPlacementRequest& Request, FInventoryPlacementSnapshot& OutSnapshot) const
+{
+	OutSnapshot.InventoryVersion = InventoryVersion;
+
+	// stash cells outside the loaded regions may hold slots that aren't materialized, they are outside of the window
+	if (Stash.IsValid() && Stash->IsOpen())
+	{
+		Stash->GetLoadedOccupancy(OutSnapshot.Occupancy);
+	}
+	else
+	{
+		OutSnapshot.Occupancy = FInventoryGridOccupancy(GridSize);
+	}
+
+	// the items of a sort are the slots themselves, in slot order
+	if (Request.bIsSort)
+	{
+		OutSnapshot.Items.Reserve(Slots.Num());
+
+		for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); SlotIndex++)
+		{
+			const FSlot& Slot = Slots[SlotIndex];
+			const FItemDefinition& ItemDefinition = Slot.Instance.GetDefinition();
+
+			FPlacementItem& Item = OutSnapshot.Items.AddDefaulted_GetRef();
+			Item.Item = Slot.GetItem();
+			Item.Quantity = Slot.Quantity;
+			Item.MaxSlotQuantity = Slot.Quantity;
+			Item.Size = ItemDefinition.GetSize(false);
+			Item.SlotIndex = SlotIndex;
+			Item.bCanBeRotated = ItemDefinition.bCanBeRotated;
+		}
+
+		return;
+	}
+
+	for (const FSlot& Slot: Slots)
+	{
+		OutSnapshot.Occupancy.Occupy(Slot.Instance.TopLeftCoordinates, Slot.Instance.Size);
+	}
+
+	OutSnapshot.Items.Reserve(Request.Items.Num());
+
+	for (const FPendingItem& PendingItem: Request.Items)
+	{
+		const FItemDefinition& ItemDefinition = PendingItem.Item->GetDefinition();
+
+		FPlacementItem& Item = OutSnapshot.Items.AddDefaulted_GetRef();
+		Item.Item = PendingItem.Item;
+		Item.Quantity = PendingItem.Quantity;
+		Item.MaxSlotQuantity = ItemDefinition.GetMaxSlotQuantity();
+		Item.Size = ItemDefinition.GetSize(false);
+		Item.bCanBeRotated = ItemDefinition.bCanBeRotated;
+	}
+
+	for (int32 SlotIndex = 0; SlotIndex < Slots.Num(); SlotIndex++)
+	{
+		const FSlot& Slot = Slots[SlotIndex];
+
+		const bool bCanStack = Slot.Instance.GetDefinition().bCanBeStacked && !Slot.IsOnMaxStackSize();
+		if (bCanStack && Request.Items.ContainsByPredicate([&Slot](const FPendingItem& PendingItem) { return PendingItem.Item == Slot.GetItem(); }))
+		{
+			OutSnapshot.Stacks.Add({ SlotIndex, Slot.GetItem(), Slot.GetMissingStackQuantity() });
+		}
+	}
+}
+
+void UInventoryComponent::ApplyPlacementPlan(const FInventoryPlacementPlan& Plan)
+{
+	check(Plan.InventoryVersion == InventoryVersion);
+
+	FPlacementRequest Request = MoveTemp(PlacementRequests[0]);
+	PlacementRequests.RemoveAt(0);
+
+	bool bSucceeded = true;
+	TArray<FPendingItem> AddedItems;
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_InventoryPlacementApply);
+
+		for (const int32 UnplacedQuantity: Plan.UnplacedQuantities)
+		{
+			bSucceeded &= UnplacedQuantity == 0;
+		}
+
+		if (Request.bIsSort)
+		{
+			// a partial sort would leave the slots that found no room nowhere
+			if (bSucceeded)
+			{
+				for (const FPlannedSlot& PlannedSlot: Plan.Slots)
+				{
+					FSlot& Slot = Slots[PlannedSlot.ItemIndex];
+
+					if (Slot.Instance.bIsRotated != PlannedSlot.bIsRotated)
+					{
+						Slot.Rotate();
+					}
+
+					Slot.Instance.TopLeftCoordinates = PlannedSlot.TopLeftCoordinates;
+					Slot.SyncItemInstance();
+				}
+
+				NotifyInventoryUpdated();
+			}
+		}
+		else
+		{
+			BeginNotificationBatch();
+
+			for (const FPendingItem& PendingItem: Request.Items)
+			{
+				AddedItems.Add(FPendingItem(PendingItem.Item, 0));
+			}
+
+			for (const FPlannedStack& PlannedStack: Plan.Stacks)
+			{
+				FPendingItem& AddedItem = AddedItems[PlannedStack.ItemIndex];
+
+				if (!CanCarryItem(AddedItem.Item, PlannedStack.Quantity))
+				{
+					bSucceeded = false;
+					continue;
+				}
+
+				Slots[PlannedStack.SlotIndex].UpdateQuantity(PlannedStack.Quantity);
+				AddedItem.Quantity += PlannedStack.Quantity;
+			}
+
+			for (const FPlannedSlot& PlannedSlot: Plan.Slots)
+			{
+				FPendingItem& AddedItem = AddedItems[PlannedSlot.ItemIndex];
+
+				if (!CanCarryItem(AddedItem.Item, PlannedSlot.Quantity))
+				{
+					bSucceeded = false;
+					continue;
+				}
+
+				FItemInstanceData NewInstance(AddedItem.Item);
+
+				if (PlannedSlot.bIsRotated)
+				{
+					NewInstance.Rotate();
+				}
+
+				NewInstance.TopLeftCoordinates = PlannedSlot.TopLeftCoordinates;
+
+				Slots.Add(MakeSlot(NewInstance, PlannedSlot.Quantity));
+				AddedItem.Quantity += PlannedSlot.Quantity;
+			}
+
+			AddedItems.RemoveAll([](const FPendingItem& AddedItem) { return AddedItem.Quantity == 0; });
+
+			if (AddedItems.Num() > 0)
+			{
+				NotifyInventoryUpdated();
+				NotifyInventoryWeightChanged();
+			}
+
+			for (const FPendingItem& AddedItem: AddedItems)
+			{
+				NotifyInventoryItemAdded(AddedItem.Item, AddedItem.Quantity);
+			}
+
+			if (!bSucceeded)
+			{
+				NotifyInventoryInsufficientSpace();
+			}
+
+			EndNotificationBatch();
+		}
+	}
+
+	PlacementItems.Reset();
+
+	for (const FPlacementRequest& QueuedRequest: PlacementRequests)
+	{
+		for (const FPendingItem& PendingItem: QueuedRequest.Items)
+		{
+			PlacementItems.AddUnique(PendingItem.Item);
+		}
+	}
+
+	// the delegate may queue another request, which then starts itself
+	Request.OnPlaced.ExecuteIfBound(bSucceeded, AddedItems);
+
+	StartPlacement();
+}
+
+void UInventoryComponent::CancelPlacements()
+{
+	PlacementRequests.Empty();
+	PlacementItems.Empty();
+
+	// the plan in flight is ignored when it comes back
+	PlacementSerial++;
+	bIsPlacementInFlight = false;
+}
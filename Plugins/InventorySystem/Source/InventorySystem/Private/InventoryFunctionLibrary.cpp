@@ -28,6 +28,11 @@ int32 UInventoryFunctionLibrary::GetSlotMissingStackQuantity(const FSlot& Slot)
 	return Slot.GetMissingStackQuantity();
 }
 
+TArray<FPoint2D> UInventoryFunctionLibrary::GetSlotSizeInCells(const FSlot& Slot)
+{
+	return Slot.Instance.GetSizeInCells();
+}
+
 bool UInventoryFunctionLibrary::IsValidEquipmentSlot(const FEquipmentSlot& EquipmentSlot)
 {
 	return EquipmentSlot.IsValid();
@@ -47,3 +52,18 @@ bool UInventoryFunctionLibrary::DoesItemHaveValidEquipmentSlot(const UItem* Item
 
 	return true;
 }
+
+int32 UInventoryFunctionLibrary::GetItemId(const UItem* Item)
+{
+	return Item ? Item->GetItemId() : UAssetManager_Custom::InvalidItemId;
+}
+
+UItem* UInventoryFunctionLibrary::GetLoadedItemFromId(const int32 ItemId)
+{
+	if (ItemId <= UAssetManager_Custom::InvalidItemId || ItemId > MAX_uint16)
+	{
+		return nullptr;
+	}
+
+	return UAssetManager_Custom::Get().GetLoadedItem(static_cast<FItemId>(ItemId));
+}
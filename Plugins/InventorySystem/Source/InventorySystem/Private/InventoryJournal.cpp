@@ -0,0 +1,668 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryJournal.h"
+#include "InventoryComponent.h"
+#include "Item.h"
+#include "TimerManager.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+const uint32 FInventoryJournal::Magic = 0x4A564E49;
+
+FInventoryJournal::FInventoryJournal()
+{
+	Inventory = nullptr;
+	MaxJournalBytes = 0;
+	JournalSize = 0;
+	Generation = 0;
+	RecordedMoney = 0;
+	RecordedInventoryVersion = 0;
+	bIsWritePending = false;
+}
+
+FInventoryJournal::~FInventoryJournal()
+{
+	JournalHandle.Reset();
+}
+
+bool FInventoryJournal::Open(UInventoryComponent* InInventory, const FString& InFilename, const int32 InMaxJournalBytes)
+{
+	check(InInventory != nullptr);
+
+	Close();
+
+	Inventory = InInventory;
+	SnapshotFilename = InFilename + TEXT(".snapshot");
+	JournalFilename = InFilename + TEXT(".journal");
+	MaxJournalBytes = InMaxJournalBytes;
+	Generation = 0;
+
+	TArray<uint8> SnapshotData;
+	if (FFileHelper::LoadFileToArray(SnapshotData, *SnapshotFilename, FILEREAD_Silent) && !Restore(SnapshotData))
+	{
+		Inventory = nullptr;
+		return false;
+	}
+
+	// the restored journal is folded right away, each session starts with an empty one
+	if (!Compact())
+	{
+		Inventory = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+void FInventoryJournal::Close()
+{
+	if (IsOpen())
+	{
+		Compact();
+	}
+
+	JournalHandle.Reset();
+	Inventory = nullptr;
+}
+
+bool FInventoryJournal::IsOpen() const
+{
+	return JournalHandle.IsValid() && Inventory != nullptr;
+}
+
+void FInventoryJournal::RecordChanges()
+{
+	if (!IsOpen() || bIsWritePending)
+	{
+		return;
+	}
+
+	UWorld* World = Inventory->GetWorld();
+	if (World == nullptr)
+	{
+		WriteChanges();
+		return;
+	}
+
+	// the journal lives as long as its inventory, the write is dropped along with the inventory
+	bIsWritePending = true;
+	World->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(Inventory, [this]()
+	{
+		if (bIsWritePending)
+		{
+			WriteChanges();
+		}
+	}));
+}
+
+void FInventoryJournal::WriteChanges()
+{
+	bIsWritePending = false;
+
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	TArray<uint8> Records;
+	FMemoryWriter Writer(Records);
+
+	if (Inventory->Money != RecordedMoney)
+	{
+		EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::Money;
+		uint32 Money = FMath::Max(Inventory->Money, 0);
+
+		Writer << RecordType;
+		Writer.SerializeIntPacked(Money);
+
+		RecordedMoney = Inventory->Money;
+	}
+
+	// money changes don't change the version
+	if (Inventory->InventoryVersion != RecordedInventoryVersion)
+	{
+		WriteSlotChanges(Writer);
+		WriteEquipmentChanges(Writer);
+
+		RecordedInventoryVersion = Inventory->InventoryVersion;
+	}
+
+	if (Records.Num() == 0)
+	{
+		return;
+	}
+
+	if (!JournalHandle->Write(Records.GetData(), Records.Num()) || !JournalHandle->Flush())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to append to %s, writing a new snapshot instead"), *JournalFilename);
+		Compact();
+		return;
+	}
+
+	JournalSize += Records.Num();
+
+	if (JournalSize > MaxJournalBytes)
+	{
+		Compact();
+	}
+}
+
+bool FInventoryJournal::Compact()
+{
+	if (Inventory == nullptr)
+	{
+		return false;
+	}
+
+	FInventorySaveData SaveData;
+	if (!Inventory->MakeSaveData(SaveData))
+	{
+		return false;
+	}
+
+	uint32 NewGeneration = Generation + 1;
+
+	TArray<uint8> SnapshotData;
+	FMemoryWriter Writer(SnapshotData);
+
+	Writer << NewGeneration;
+	SaveData.Save(Writer);
+
+	// the previous snapshot and journal stay valid until the new snapshot replaced them
+	const FString TempFilename = SnapshotFilename + TEXT(".tmp");
+
+	if (Writer.IsError() || !FFileHelper::SaveArrayToFile(SnapshotData, *TempFilename) || !IFileManager::Get().Move(*SnapshotFilename, *TempFilename, true))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to write the inventory snapshot %s"), *SnapshotFilename);
+		return false;
+	}
+
+	Generation = NewGeneration;
+
+	JournalHandle.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*JournalFilename));
+	if (!JournalHandle.IsValid())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to open the inventory journal %s"), *JournalFilename);
+		return false;
+	}
+
+	TArray<uint8> Header;
+	FMemoryWriter HeaderWriter(Header);
+
+	uint32 FileMagic = Magic;
+	uint32 ItemRegistryHash = SaveData.ItemRegistryHash;
+
+	HeaderWriter << FileMagic;
+	HeaderWriter << Generation;
+	HeaderWriter << ItemRegistryHash;
+
+	JournalHandle->Write(Header.GetData(), Header.Num());
+	JournalHandle->Flush();
+
+	JournalSize = Header.Num();
+
+	CaptureState();
+
+	return true;
+}
+
+int64 FInventoryJournal::GetJournalSize() const
+{
+	return JournalSize;
+}
+
+bool FInventoryJournal::Restore(const TArray<uint8>& SnapshotData)
+{
+	FMemoryReader SnapshotReader(SnapshotData);
+
+	FInventorySaveData SaveData;
+
+	SnapshotReader << Generation;
+	SaveData.Serialize(SnapshotReader);
+
+	if (SnapshotReader.IsError() || !Inventory->ApplySaveData(SaveData))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to restore %s from %s"), *GetNameSafe(Inventory), *SnapshotFilename);
+		return false;
+	}
+
+	TArray<uint8> JournalData;
+	if (!FFileHelper::LoadFileToArray(JournalData, *JournalFilename, FILEREAD_Silent))
+	{
+		return true;
+	}
+
+	FMemoryReader JournalReader(JournalData);
+
+	uint32 FileMagic = 0;
+	uint32 JournalGeneration = 0;
+	uint32 ItemRegistryHash = 0;
+
+	JournalReader << FileMagic;
+	JournalReader << JournalGeneration;
+	JournalReader << ItemRegistryHash;
+
+	// a journal of an older snapshot was already folded into this one, a crash happened before it was emptied
+	if (JournalReader.IsError() || FileMagic != Magic || JournalGeneration != Generation)
+	{
+		return true;
+	}
+
+	// journals hold compact item identifiers only, they can't be remapped like snapshots
+	if (ItemRegistryHash != UAssetManager_Custom::Get().GetItemRegistryHash())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s was written with another item registry, the changes made after its snapshot are lost"), *JournalFilename);
+		return true;
+	}
+
+	Inventory->BeginNotificationBatch();
+
+	while (!JournalReader.AtEnd())
+	{
+		const int64 RecordOffset = JournalReader.Tell();
+
+		if (!ApplyRecord(JournalReader))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s stops at an invalid record at offset %lld, the changes after it are lost"), *JournalFilename, RecordOffset);
+			break;
+		}
+	}
+
+	// records are replayed where they were made, the item size may have changed since then
+	Inventory->RelocateMisplacedSlots();
+
+	Inventory->NotifyInventoryUpdated();
+	Inventory->NotifyMoneyChanged();
+
+	Inventory->EndNotificationBatch();
+
+	return true;
+}
+
+bool FInventoryJournal::ApplyRecord(FArchive& Ar)
+{
+	EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::Money;
+	EEquipmentSlotType EquipmentSlotType = EEquipmentSlotType::None;
+
+	uint32 SlotKey = 0;
+	uint32 Value = 0;
+	FSavedSlot SavedSlot;
+
+	Ar << RecordType;
+
+	switch (RecordType)
+	{
+		case EInventoryJournalRecordType::Money:
+			Ar.SerializeIntPacked(Value);
+			break;
+
+		case EInventoryJournalRecordType::SlotAdded:
+			SavedSlot.Serialize(Ar);
+			break;
+
+		case EInventoryJournalRecordType::SlotRemoved:
+			Ar.SerializeIntPacked(SlotKey);
+			break;
+
+		case EInventoryJournalRecordType::SlotQuantity:
+		case EInventoryJournalRecordType::SlotMoved:
+			Ar.SerializeIntPacked(SlotKey);
+			Ar.SerializeIntPacked(Value);
+			break;
+
+		case EInventoryJournalRecordType::EquipmentSet:
+			Ar << EquipmentSlotType;
+			SavedSlot.Serialize(Ar);
+			break;
+
+		case EInventoryJournalRecordType::EquipmentCleared:
+			Ar << EquipmentSlotType;
+			break;
+
+		default:
+			Ar.SetError();
+			break;
+	}
+
+	if (Ar.IsError())
+	{
+		return false;
+	}
+
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	switch (RecordType)
+	{
+		case EInventoryJournalRecordType::Money:
+		{
+			Inventory->Money = FMath::Min<uint32>(Value, MAX_int32);
+			return true;
+		}
+
+		case EInventoryJournalRecordType::SlotAdded:
+		{
+			UItem* Item = AssetManager.GetLoadedItem(SavedSlot.ItemId);
+			if (Item == nullptr)
+			{
+				return false;
+			}
+
+			FItemInstanceData Instance(Item);
+			Instance.TopLeftCoordinates = SavedSlot.GetTopLeftCoordinates();
+
+			if (SavedSlot.IsRotated())
+			{
+				Instance.Rotate();
+			}
+
+			Inventory->Slots.Add(Inventory->MakeSavedSlot(Instance, SavedSlot));
+			return true;
+		}
+
+		case EInventoryJournalRecordType::SlotRemoved:
+		{
+			const int32 SlotIndex = FindSlotIndex(SlotKey);
+			if (SlotIndex == INDEX_NONE)
+			{
+				return false;
+			}
+
+			Inventory->ReleaseItemInstance(Inventory->Slots[SlotIndex]);
+			Inventory->Slots.RemoveAt(SlotIndex);
+			return true;
+		}
+
+		case EInventoryJournalRecordType::SlotQuantity:
+		{
+			const int32 SlotIndex = FindSlotIndex(SlotKey);
+			if (SlotIndex == INDEX_NONE || Value == 0 || Value > MAX_int32)
+			{
+				return false;
+			}
+
+			Inventory->Slots[SlotIndex].Quantity = static_cast<int32>(Value);
+			return true;
+		}
+
+		case EInventoryJournalRecordType::SlotMoved:
+		{
+			const int32 SlotIndex = FindSlotIndex(SlotKey);
+			if (SlotIndex == INDEX_NONE)
+			{
+				return false;
+			}
+
+			FSavedSlot Placement;
+			Placement.PackedPlacement = Value;
+
+			FSlot& Slot = Inventory->Slots[SlotIndex];
+			Slot.Instance.TopLeftCoordinates = Placement.GetTopLeftCoordinates();
+
+			if (Placement.IsRotated() != static_cast<bool>(Slot.Instance.bIsRotated))
+			{
+				Slot.Rotate();
+			}
+			else
+			{
+				Slot.SyncItemInstance();
+			}
+
+			return true;
+		}
+
+		case EInventoryJournalRecordType::EquipmentSet:
+		case EInventoryJournalRecordType::EquipmentCleared:
+		{
+			UItem* Item = RecordType == EInventoryJournalRecordType::EquipmentSet ? AssetManager.GetLoadedItem(SavedSlot.ItemId) : nullptr;
+			if (RecordType == EInventoryJournalRecordType::EquipmentSet && Item == nullptr)
+			{
+				return false;
+			}
+
+			const int32 EquipmentSlotIndex = Inventory->GetEquipmentSlotIndexByType(EquipmentSlotType);
+			if (EquipmentSlotIndex == INDEX_NONE)
+			{
+				return false;
+			}
+
+			FSlot& EquipmentSlotData = Inventory->EquipmentSlots[EquipmentSlotIndex].Data;
+			Inventory->ReleaseItemInstance(EquipmentSlotData);
+
+			if (Item)
+			{
+				// equipped items are never rotated
+				EquipmentSlotData = Inventory->MakeSavedSlot(FItemInstanceData(Item), SavedSlot);
+			}
+			else
+			{
+				EquipmentSlotData.Instance = FItemInstanceData();
+				EquipmentSlotData.ItemInstance = nullptr;
+				EquipmentSlotData.Quantity = 0;
+			}
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FInventoryJournal::CaptureState()
+{
+	RecordedSlots.Reset();
+
+	for (int32 I = 0; I < Inventory->Slots.Num(); I++)
+	{
+		const FSlotRecord SlotRecord = MakeSlotRecord(Inventory->Slots[I]);
+		RecordedSlots.Add(GetSlotKey(SlotRecord.PackedPlacement), SlotRecord);
+	}
+
+	RecordedEquipmentSlots.Reset();
+
+	for (const FEquipmentSlot& EquipmentSlot: Inventory->EquipmentSlots)
+	{
+		if (EquipmentSlot.Data.IsOccupied())
+		{
+			RecordedEquipmentSlots.Add(EquipmentSlot.Type, MakeSlotRecord(EquipmentSlot.Data));
+		}
+	}
+
+	RecordedMoney = Inventory->Money;
+	RecordedInventoryVersion = Inventory->InventoryVersion;
+
+	// the snapshot already holds the changes of the frame
+	bIsWritePending = false;
+}
+
+void FInventoryJournal::WriteSlotChanges(FArchive& Ar)
+{
+	CurrentSlots.Reset();
+
+	for (int32 I = 0; I < Inventory->Slots.Num(); I++)
+	{
+		FSlotRecord SlotRecord = MakeSlotRecord(Inventory->Slots[I]);
+		SlotRecord.SlotIndex = I;
+
+		CurrentSlots.Add(GetSlotKey(SlotRecord.PackedPlacement), SlotRecord);
+	}
+
+	TArray<uint32, TInlineAllocator<8>> RemovedKeys;
+	TArray<uint32, TInlineAllocator<8>> AddedKeys;
+
+	for (const TPair<uint32, FSlotRecord>& RecordedSlot: RecordedSlots)
+	{
+		const FSlotRecord* CurrentSlot = CurrentSlots.Find(RecordedSlot.Key);
+		if (CurrentSlot == nullptr || CurrentSlot->ItemId != RecordedSlot.Value.ItemId)
+		{
+			RemovedKeys.Add(RecordedSlot.Key);
+		}
+	}
+
+	for (const TPair<uint32, FSlotRecord>& CurrentSlot: CurrentSlots)
+	{
+		const FSlotRecord* RecordedSlot = RecordedSlots.Find(CurrentSlot.Key);
+		if (RecordedSlot == nullptr || RecordedSlot->ItemId != CurrentSlot.Value.ItemId)
+		{
+			AddedKeys.Add(CurrentSlot.Key);
+			continue;
+		}
+
+		// rotated in place
+		if (RecordedSlot->PackedPlacement != CurrentSlot.Value.PackedPlacement)
+		{
+			EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::SlotMoved;
+			uint32 SlotKey = CurrentSlot.Key;
+			uint32 PackedPlacement = CurrentSlot.Value.PackedPlacement;
+
+			Ar << RecordType;
+			Ar.SerializeIntPacked(SlotKey);
+			Ar.SerializeIntPacked(PackedPlacement);
+		}
+
+		if (RecordedSlot->Quantity != CurrentSlot.Value.Quantity)
+		{
+			EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::SlotQuantity;
+			uint32 SlotKey = CurrentSlot.Key;
+			uint32 Quantity = CurrentSlot.Value.Quantity;
+
+			Ar << RecordType;
+			Ar.SerializeIntPacked(SlotKey);
+			Ar.SerializeIntPacked(Quantity);
+		}
+	}
+
+	// a slot that left a cell and a slot of the same stack that appeared on a free cell are a move, moves into vacated cells stay a removal and an addition
+	TArray<TPair<uint32, uint32>, TInlineAllocator<4>> MovedKeys;
+
+	for (int32 AddedIndex = AddedKeys.Num() - 1; AddedIndex >= 0; AddedIndex--)
+	{
+		const FSlotRecord& AddedSlot = CurrentSlots.FindChecked(AddedKeys[AddedIndex]);
+
+		if (RecordedSlots.Contains(AddedKeys[AddedIndex]))
+		{
+			continue;
+		}
+
+		for (int32 RemovedIndex = 0; RemovedIndex < RemovedKeys.Num(); RemovedIndex++)
+		{
+			const FSlotRecord& RemovedSlot = RecordedSlots.FindChecked(RemovedKeys[RemovedIndex]);
+
+			if (RemovedSlot.ItemId == AddedSlot.ItemId && RemovedSlot.Quantity == AddedSlot.Quantity)
+			{
+				MovedKeys.Emplace(RemovedKeys[RemovedIndex], AddedKeys[AddedIndex]);
+
+				RemovedKeys.RemoveAtSwap(RemovedIndex);
+				AddedKeys.RemoveAtSwap(AddedIndex);
+				break;
+			}
+		}
+	}
+
+	for (uint32 SlotKey: RemovedKeys)
+	{
+		EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::SlotRemoved;
+
+		Ar << RecordType;
+		Ar.SerializeIntPacked(SlotKey);
+	}
+
+	for (const TPair<uint32, uint32>& MovedKey: MovedKeys)
+	{
+		EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::SlotMoved;
+		uint32 SlotKey = MovedKey.Key;
+		uint32 PackedPlacement = CurrentSlots.FindChecked(MovedKey.Value).PackedPlacement;
+
+		Ar << RecordType;
+		Ar.SerializeIntPacked(SlotKey);
+		Ar.SerializeIntPacked(PackedPlacement);
+	}
+
+	for (const uint32 SlotKey: AddedKeys)
+	{
+		EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::SlotAdded;
+
+		FSavedSlot SavedSlot;
+		SavedSlot.SetFromSlot(Inventory->Slots[CurrentSlots.FindChecked(SlotKey).SlotIndex]);
+
+		Ar << RecordType;
+		SavedSlot.Serialize(Ar);
+	}
+
+	Swap(RecordedSlots, CurrentSlots);
+}
+
+void FInventoryJournal::WriteEquipmentChanges(FArchive& Ar)
+{
+	for (const FEquipmentSlot& EquipmentSlot: Inventory->EquipmentSlots)
+	{
+		EEquipmentSlotType EquipmentSlotType = EquipmentSlot.Type;
+		const FSlotRecord* RecordedEquipmentSlot = RecordedEquipmentSlots.Find(EquipmentSlotType);
+
+		if (EquipmentSlot.Data.IsOccupied())
+		{
+			const FSlotRecord EquipmentSlotRecord = MakeSlotRecord(EquipmentSlot.Data);
+
+			if (RecordedEquipmentSlot && RecordedEquipmentSlot->ItemId == EquipmentSlotRecord.ItemId && RecordedEquipmentSlot->Quantity == EquipmentSlotRecord.Quantity)
+			{
+				continue;
+			}
+
+			EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::EquipmentSet;
+
+			FSavedSlot SavedSlot;
+			SavedSlot.SetFromSlot(EquipmentSlot.Data);
+
+			Ar << RecordType;
+			Ar << EquipmentSlotType;
+			SavedSlot.Serialize(Ar);
+
+			RecordedEquipmentSlots.Add(EquipmentSlotType, EquipmentSlotRecord);
+		}
+		else if (RecordedEquipmentSlot)
+		{
+			EInventoryJournalRecordType RecordType = EInventoryJournalRecordType::EquipmentCleared;
+
+			Ar << RecordType;
+			Ar << EquipmentSlotType;
+
+			RecordedEquipmentSlots.Remove(EquipmentSlotType);
+		}
+	}
+}
+
+int32 FInventoryJournal::FindSlotIndex(const uint32 SlotKey) const
+{
+	for (int32 I = 0; I < Inventory->Slots.Num(); I++)
+	{
+		const FSlotRecord SlotRecord = MakeSlotRecord(Inventory->Slots[I]);
+		if (GetSlotKey(SlotRecord.PackedPlacement) == SlotKey)
+		{
+			return I;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+FInventoryJournal::FSlotRecord FInventoryJournal::MakeSlotRecord(const FSlot& Slot)
+{
+	FSavedSlot Placement;
+	Placement.SetPlacement(Slot.Instance.TopLeftCoordinates, Slot.Instance.bIsRotated);
+
+	FSlotRecord SlotRecord;
+	SlotRecord.ItemId = Slot.Instance.ItemId;
+	SlotRecord.Quantity = Slot.Quantity;
+	SlotRecord.PackedPlacement = Placement.PackedPlacement;
+	SlotRecord.SlotIndex = INDEX_NONE;
+
+	return SlotRecord;
+}
+
+uint32 FInventoryJournal::GetSlotKey(const uint32 PackedPlacement)
+{
+	return PackedPlacement & ~1u;
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryPlacement.h"
+
+void FInventoryPlacementSolver::Solve(const FInventoryPlacementSnapshot& Snapshot, FInventoryPlacementPlan& OutPlan)
+{
+	OutPlan.InventoryVersion = Snapshot.InventoryVersion;
+	OutPlan.Stacks.Reset();
+	OutPlan.Slots.Reset();
+	OutPlan.UnplacedQuantities.SetNumZeroed(Snapshot.Items.Num());
+
+	FInventoryGridOccupancy Occupancy = Snapshot.Occupancy;
+
+	TArray<int32> MissingQuantities;
+	MissingQuantities.Reserve(Snapshot.Stacks.Num());
+
+	for (const FPlacementStack& Stack: Snapshot.Stacks)
+	{
+		MissingQuantities.Add(Stack.MissingQuantity);
+	}
+
+	TArray<FPlannedSlot> NewSlots;
+
+	for (int32 ItemIndex = 0; ItemIndex < Snapshot.Items.Num(); ItemIndex++)
+	{
+		const FPlacementItem& Item = Snapshot.Items[ItemIndex];
+		int32 RemainingQuantity = Item.Quantity;
+
+		// slots moved by a sort keep their quantity
+		if (Item.SlotIndex == INDEX_NONE && Item.MaxSlotQuantity > 1)
+		{
+			for (int32 StackIndex = 0; StackIndex < Snapshot.Stacks.Num() && RemainingQuantity > 0; StackIndex++)
+			{
+				if (Snapshot.Stacks[StackIndex].Item != Item.Item || MissingQuantities[StackIndex] <= 0)
+				{
+					continue;
+				}
+
+				const int32 StackedQuantity = FMath::Min(RemainingQuantity, MissingQuantities[StackIndex]);
+
+				OutPlan.Stacks.Add({ Snapshot.Stacks[StackIndex].SlotIndex, ItemIndex, StackedQuantity });
+
+				MissingQuantities[StackIndex] -= StackedQuantity;
+				RemainingQuantity -= StackedQuantity;
+			}
+		}
+
+		const int32 MaxSlotQuantity = Item.SlotIndex == INDEX_NONE ? Item.MaxSlotQuantity : Item.Quantity;
+
+		while (RemainingQuantity > 0)
+		{
+			FPlannedSlot& NewSlot = NewSlots.AddDefaulted_GetRef();
+			NewSlot.ItemIndex = ItemIndex;
+			NewSlot.Quantity = FMath::Min(RemainingQuantity, FMath::Max(MaxSlotQuantity, 1));
+			NewSlot.bIsRotated = false;
+
+			RemainingQuantity -= NewSlot.Quantity;
+		}
+	}
+
+	// largest first leaves the small items to fill the gaps, ties keep the order of the items
+	NewSlots.StableSort([&Snapshot](const FPlannedSlot& A, const FPlannedSlot& B)
+	{
+		const FPoint2D& SizeA = Snapshot.Items[A.ItemIndex].Size;
+		const FPoint2D& SizeB = Snapshot.Items[B.ItemIndex].Size;
+
+		if (SizeA.X * SizeA.Y != SizeB.X * SizeB.Y)
+		{
+			return SizeA.X * SizeA.Y > SizeB.X * SizeB.Y;
+		}
+
+		return FMath::Max(SizeA.X, SizeA.Y) > FMath::Max(SizeB.X, SizeB.Y);
+	});
+
+	OutPlan.Slots.Reserve(NewSlots.Num());
+
+	for (FPlannedSlot& NewSlot: NewSlots)
+	{
+		const FPlacementItem& Item = Snapshot.Items[NewSlot.ItemIndex];
+
+		FPoint2D Size = Item.Size;
+
+		if (!Occupancy.FindFree(Size, NewSlot.TopLeftCoordinates))
+		{
+			Size = FPoint2D(Item.Size.Y, Item.Size.X);
+
+			if (!Item.bCanBeRotated || !Occupancy.FindFree(Size, NewSlot.TopLeftCoordinates))
+			{
+				OutPlan.UnplacedQuantities[NewSlot.ItemIndex] += NewSlot.Quantity;
+				continue;
+			}
+
+			NewSlot.bIsRotated = true;
+		}
+
+		Occupancy.Occupy(NewSlot.TopLeftCoordinates, Size);
+		OutPlan.Slots.Add(NewSlot);
+	}
+}
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryQuerySnapshot.h"
+
+FInventoryQuerySnapshot::FInventoryQuerySnapshot()
+{
+	InventoryVersion = 0;
+	Money = 0;
+}
+
+bool FInventoryQuerySnapshot::DoesItemExist(const UItem* Item) const
+{
+	return CountItemQuantity(Item) > 0;
+}
+
+int32 FInventoryQuerySnapshot::CountItemQuantity(const UItem* Item) const
+{
+	return ItemQuantities.FindRef(Item) + (StashSnapshot.IsValid() ? StashSnapshot->CountItemQuantity(Item) : 0);
+}
+
+bool FInventoryQuerySnapshot::IsFreeCell(const FPoint2D& Coordinates) const
+{
+	return Occupancy.IsFree(Coordinates, FPoint2D(1, 1));
+}
+
+bool FInventoryQuerySnapshot::DoesSizeFit(const FPoint2D& Size, const FPoint2D& Coordinates) const
+{
+	return Occupancy.IsFree(Coordinates, Size);
+}
+
+bool FInventoryQuerySnapshot::HasRoomFor(const FPoint2D& Size, const bool bCanBeRotated) const
+{
+	FPoint2D TopLeftCoordinates;
+	return Occupancy.FindFree(Size, TopLeftCoordinates) || (bCanBeRotated && Occupancy.FindFree(FPoint2D(Size.Y, Size.X), TopLeftCoordinates));
+}
@@ -0,0 +1,598 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventorySaveData.h"
+#include "Item.h"
+#include "ItemInstance.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/UObjectIterator.h"
+
+const uint32 FInventorySaveData::Magic = 0x564E4953;
+const uint32 FInventorySaveData::FileMagic = 0x5A564E49;
+const int32 FInventorySaveData::MaxGridSize = 1 << 15;
+const int32 FInventorySaveData::MaxDataSize = 64 * 1024 * 1024;
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkInventorySaveCommand(
+	TEXT("Inventory.BenchmarkSave"),
+	TEXT("Saves and loads every inventory of the world, logs the size and time per inventory and checks the round trip. Usage: Inventory.BenchmarkSave [NumIterations=100]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const int32 NumIterations = Args.IsValidIndex(0) ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100;
+
+		for (TObjectIterator<UInventoryComponent> It; It; ++It)
+		{
+			UInventoryComponent* InventoryComponent = *It;
+			if (InventoryComponent->IsTemplate() || InventoryComponent->GetWorld() != World)
+			{
+				continue;
+			}
+
+			TArray<uint8> Data;
+			FInventorySaveData SaveData;
+
+			double StartTime = FPlatformTime::Seconds();
+
+			for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+			{
+				InventoryComponent->SaveInventory(Data);
+			}
+
+			const double SaveTimeUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / NumIterations;
+			StartTime = FPlatformTime::Seconds();
+
+			for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+			{
+				SaveData.LoadFromBytes(Data);
+			}
+
+			const double LoadTimeUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0 / NumIterations;
+			StartTime = FPlatformTime::Seconds();
+
+			// applying rebuilds the slots and notifies, it is only timed once
+			const bool bIsApplied = InventoryComponent->ApplySaveData(SaveData);
+			const double ApplyTimeUs = (FPlatformTime::Seconds() - StartTime) * 1000000.0;
+
+			TArray<uint8> RoundTripData;
+			const bool bIsRoundTripValid = bIsApplied && InventoryComponent->SaveInventory(RoundTripData) && RoundTripData == Data;
+
+			UE_LOG(LogTemp, Log, TEXT("%s: %d slots, %d bytes, save %.2f us, load %.2f us, apply %.2f us, round trip %s"),
+				*GetPathNameSafe(InventoryComponent), InventoryComponent->Slots.Num(), Data.Num(), SaveTimeUs, LoadTimeUs, ApplyTimeUs, bIsRoundTripValid ? TEXT("valid") : TEXT("INVALID"));
+		}
+	}));
+#endif
+
+bool FSavedSlot::SetFromSlot(const FSlot& Slot)
+{
+	ItemId = Slot.Instance.ItemId;
+	Quantity = Slot.Quantity;
+	SetPlacement(Slot.Instance.TopLeftCoordinates, Slot.Instance.bIsRotated);
+
+	CustomData.Reset();
+
+	if (Slot.ItemInstance)
+	{
+		FMemoryWriter Writer(CustomData);
+		Slot.ItemInstance->SerializeCustomData(Writer);
+	}
+
+	return ItemId != UAssetManager_Custom::InvalidItemId;
+}
+
+void FSavedSlot::SetPlacement(const FPoint2D& TopLeftCoordinates, const bool bIsRotated)
+{
+	PackedPlacement = (bIsRotated ? 1 : 0) | (static_cast<uint32>(TopLeftCoordinates.X) & 0x7FFF) << 1 | (static_cast<uint32>(TopLeftCoordinates.Y) & 0x7FFF) << 16;
+}
+
+FPoint2D FSavedSlot::GetTopLeftCoordinates() const
+{
+	return FPoint2D((PackedPlacement >> 1) & 0x7FFF, (PackedPlacement >> 16) & 0x7FFF);
+}
+
+bool FSavedSlot::IsRotated() const
+{
+	return (PackedPlacement & 1) != 0;
+}
+
+void FSavedSlot::Save(FArchive& Ar) const
+{
+	check(Ar.IsSaving());
+
+	FItemId SavedItemId = ItemId;
+	Ar << SavedItemId;
+
+	uint32 PackedQuantity = Quantity;
+	uint32 SavedPlacement = PackedPlacement;
+	Ar.SerializeIntPacked(PackedQuantity);
+	Ar.SerializeIntPacked(SavedPlacement);
+
+	// most slots have no custom data, its size is packed as well
+	uint32 NumCustomDataBytes = CustomData.Num();
+	Ar.SerializeIntPacked(NumCustomDataBytes);
+
+	Ar.Serialize(const_cast<uint8*>(CustomData.GetData()), CustomData.Num());
+}
+
+void FSavedSlot::Serialize(FArchive& Ar)
+{
+	if (Ar.IsSaving())
+	{
+		Save(Ar);
+		return;
+	}
+
+	Ar << ItemId;
+
+	uint32 PackedQuantity = 0;
+	Ar.SerializeIntPacked(PackedQuantity);
+	Ar.SerializeIntPacked(PackedPlacement);
+
+	uint32 NumCustomDataBytes = 0;
+	Ar.SerializeIntPacked(NumCustomDataBytes);
+
+	if (PackedQuantity == 0 || PackedQuantity > MAX_int32 || NumCustomDataBytes > static_cast<uint32>(Ar.TotalSize() - Ar.Tell()))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Quantity = static_cast<int32>(PackedQuantity);
+	CustomData.SetNumUninitialized(NumCustomDataBytes);
+
+	Ar.Serialize(CustomData.GetData(), CustomData.Num());
+}
+
+FInventorySaveData::FInventorySaveData()
+{
+	Version = static_cast<int32>(EInventorySaveVersion::Latest);
+	ItemRegistryHash = 0;
+	Money = 0;
+	bHasItemNames = false;
+}
+
+void FInventorySaveData::Save(FArchive& Ar) const
+{
+	check(Ar.IsSaving());
+
+	uint32 DataMagic = Magic;
+	int32 FileVersion = static_cast<int32>(EInventorySaveVersion::Latest);
+
+	Ar << DataMagic;
+	Ar << FileVersion;
+
+	uint32 SavedItemRegistryHash = ItemRegistryHash;
+	Ar << SavedItemRegistryHash;
+
+	uint32 GridSizeX = GridSize.X;
+	uint32 GridSizeY = GridSize.Y;
+	uint32 PackedMoney = FMath::Max(Money, 0);
+
+	Ar.SerializeIntPacked(GridSizeX);
+	Ar.SerializeIntPacked(GridSizeY);
+	Ar.SerializeIntPacked(PackedMoney);
+
+	uint32 NumSlots = Slots.Num();
+	Ar.SerializeIntPacked(NumSlots);
+
+	for (const FSavedSlot& Slot: Slots)
+	{
+		Slot.Save(Ar);
+	}
+
+	uint32 NumEquipmentSlots = EquipmentSlots.Num();
+	Ar.SerializeIntPacked(NumEquipmentSlots);
+
+	for (const FSavedEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		EEquipmentSlotType Type = EquipmentSlot.Type;
+		Ar << Type;
+		EquipmentSlot.Slot.Save(Ar);
+	}
+
+	// sections added by newer versions go here, the item names stay last
+
+	// names that weren't resolved beforehand are resolved into a copy, the data itself never changes while it is saved
+	TArray<TPair<FItemId, FString>> SavedItemNames;
+
+	if (bHasItemNames)
+	{
+		SavedItemNames = ItemNames;
+	}
+	else
+	{
+		GetItemNames(SavedItemNames);
+	}
+
+	uint32 NumItems = SavedItemNames.Num();
+	Ar.SerializeIntPacked(NumItems);
+
+	for (TPair<FItemId, FString>& ItemName: SavedItemNames)
+	{
+		Ar << ItemName.Key;
+		Ar << ItemName.Value;
+	}
+}
+
+void FInventorySaveData::Serialize(FArchive& Ar)
+{
+	if (Ar.IsSaving())
+	{
+		Save(Ar);
+		return;
+	}
+
+	uint32 DataMagic = 0;
+	int32 FileVersion = 0;
+
+	Ar << DataMagic;
+	Ar << FileVersion;
+
+	if (DataMagic != Magic || FileVersion < static_cast<int32>(EInventorySaveVersion::Initial) || FileVersion > static_cast<int32>(EInventorySaveVersion::Latest))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Version = FileVersion;
+	bHasItemNames = false;
+	RemovedSlots.Reset();
+
+	Ar << ItemRegistryHash;
+
+	uint32 GridSizeX = 0;
+	uint32 GridSizeY = 0;
+	uint32 PackedMoney = 0;
+
+	Ar.SerializeIntPacked(GridSizeX);
+	Ar.SerializeIntPacked(GridSizeY);
+	Ar.SerializeIntPacked(PackedMoney);
+
+	if (GridSizeX > static_cast<uint32>(MaxGridSize) || GridSizeY > static_cast<uint32>(MaxGridSize) || PackedMoney > MAX_int32)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	GridSize = FPoint2D(GridSizeX, GridSizeY);
+	Money = static_cast<int32>(PackedMoney);
+
+	uint32 NumSlots = 0;
+	Ar.SerializeIntPacked(NumSlots);
+
+	// every slot covers at least one cell
+	if (NumSlots > GridSizeX * GridSizeY)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Slots.SetNum(NumSlots);
+
+	for (FSavedSlot& Slot: Slots)
+	{
+		Slot.Serialize(Ar);
+
+		if (Ar.IsError())
+		{
+			return;
+		}
+	}
+
+	uint32 NumEquipmentSlots = 0;
+	Ar.SerializeIntPacked(NumEquipmentSlots);
+
+	if (NumEquipmentSlots > MAX_uint8)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	EquipmentSlots.SetNum(NumEquipmentSlots);
+
+	for (FSavedEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		Ar << EquipmentSlot.Type;
+		EquipmentSlot.Slot.Serialize(Ar);
+
+		if (Ar.IsError())
+		{
+			return;
+		}
+	}
+
+	// sections added by newer versions go here, read when Version is at least the one that added them
+
+	// identifiers are stable for a given item registry, the names are only needed if it changed
+	if (ItemRegistryHash == UAssetManager_Custom::Get().GetItemRegistryHash())
+	{
+		return;
+	}
+
+	uint32 NumItems = 0;
+	Ar.SerializeIntPacked(NumItems);
+
+	if (NumItems > MAX_uint16)
+	{
+		Ar.SetError();
+		return;
+	}
+
+	TMap<FItemId, FName> SavedItemNames;
+	SavedItemNames.Reserve(NumItems);
+
+	for (uint32 I = 0; I < NumItems; I++)
+	{
+		FItemId ItemId = UAssetManager_Custom::InvalidItemId;
+		FString ItemName;
+
+		Ar << ItemId;
+		Ar << ItemName;
+
+		if (Ar.IsError())
+		{
+			return;
+		}
+
+		SavedItemNames.Add(ItemId, FName(*ItemName));
+	}
+
+	RemapItemIds(SavedItemNames);
+}
+
+bool FInventorySaveData::SaveToBytes(TArray<uint8>& OutData) const
+{
+	OutData.Reset();
+	FMemoryWriter Writer(OutData);
+
+	Save(Writer);
+
+	return !Writer.IsError();
+}
+
+bool FInventorySaveData::SaveToCompressedBytes(TArray<uint8>& OutData, const bool bCompress) const
+{
+	TArray<uint8> Data;
+	if (!SaveToBytes(Data) || Data.Num() > MaxDataSize)
+	{
+		return false;
+	}
+
+	OutData.Reset();
+
+	FMemoryWriter Writer(OutData);
+
+	uint32 HeaderMagic = FileMagic;
+	int32 UncompressedSize = Data.Num();
+	int32 CompressedSize = 0;
+
+	Writer << HeaderMagic;
+	Writer << UncompressedSize;
+
+	const int64 CompressedSizeOffset = Writer.Tell();
+	Writer << CompressedSize;
+
+	if (bCompress)
+	{
+		const int32 HeaderSize = OutData.Num();
+		CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+		OutData.AddUninitialized(CompressedSize);
+
+		if (!FCompression::CompressMemory(NAME_Zlib, OutData.GetData() + HeaderSize, CompressedSize, Data.GetData(), UncompressedSize))
+		{
+			return false;
+		}
+
+		OutData.SetNum(HeaderSize + CompressedSize, false);
+
+		Writer.Seek(CompressedSizeOffset);
+		Writer << CompressedSize;
+	}
+	else
+	{
+		OutData.Append(Data);
+	}
+
+	return true;
+}
+
+bool FInventorySaveData::LoadFromCompressedBytes(const TArray<uint8>& FileData)
+{
+	FMemoryReader Reader(FileData);
+
+	uint32 HeaderMagic = 0;
+	int32 UncompressedSize = 0;
+	int32 CompressedSize = 0;
+
+	Reader << HeaderMagic;
+	Reader << UncompressedSize;
+	Reader << CompressedSize;
+
+	const int32 HeaderSize = Reader.Tell();
+	const int32 StoredSize = CompressedSize > 0 ? CompressedSize : UncompressedSize;
+
+	// the size is read from the file, it is checked before anything is allocated
+	if (Reader.IsError() || HeaderMagic != FileMagic || UncompressedSize < 0 || UncompressedSize > MaxDataSize || StoredSize != FileData.Num() - HeaderSize)
+	{
+		return false;
+	}
+
+	if (CompressedSize == 0)
+	{
+		return LoadFromBytes(TArray<uint8>(FileData.GetData() + HeaderSize, UncompressedSize));
+	}
+
+	TArray<uint8> Data;
+	Data.SetNumUninitialized(UncompressedSize);
+
+	return FCompression::UncompressMemory(NAME_Zlib, Data.GetData(), UncompressedSize, FileData.GetData() + HeaderSize, CompressedSize) && LoadFromBytes(Data);
+}
+
+bool FInventorySaveData::SaveToFile(const FString& Filename, const bool bCompress) const
+{
+	TArray<uint8> FileData;
+	if (!SaveToCompressedBytes(FileData, bCompress))
+	{
+		return false;
+	}
+
+	const FString TempFilename = Filename + TEXT(".tmp");
+	return FFileHelper::SaveArrayToFile(FileData, *TempFilename) && IFileManager::Get().Move(*Filename, *TempFilename, true);
+}
+
+bool FInventorySaveData::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> FileData;
+	return FFileHelper::LoadFileToArray(FileData, *Filename, FILEREAD_Silent) && LoadFromCompressedBytes(FileData);
+}
+
+void FInventorySaveData::ResolveItemNames()
+{
+	GetItemNames(ItemNames);
+	bHasItemNames = true;
+}
+
+void FInventorySaveData::GetItemNames(TArray<TPair<FItemId, FString>>& OutItemNames) const
+{
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	TSet<FItemId> SavedItemIds;
+
+	for (const FSavedSlot& Slot: Slots)
+	{
+		SavedItemIds.Add(Slot.ItemId);
+	}
+
+	for (const FSavedEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		SavedItemIds.Add(EquipmentSlot.Slot.ItemId);
+	}
+
+	OutItemNames.Reset(SavedItemIds.Num());
+
+	for (const FItemId ItemId: SavedItemIds)
+	{
+		OutItemNames.Emplace(ItemId, AssetManager.GetItemPrimaryAssetId(ItemId).PrimaryAssetName.ToString());
+	}
+}
+
+int64 FInventorySaveData::GetEstimatedSize() const
+{
+	int64 EstimatedSize = sizeof(FInventorySaveData) + Slots.GetAllocatedSize() + EquipmentSlots.GetAllocatedSize();
+
+	for (const FSavedSlot& Slot: Slots)
+	{
+		EstimatedSize += Slot.CustomData.GetAllocatedSize();
+	}
+
+	for (const FSavedEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		EstimatedSize += EquipmentSlot.Slot.CustomData.GetAllocatedSize();
+	}
+
+	// the encoded data and its compressed copy are at most about as large as the data itself
+	return EstimatedSize * 3;
+}
+
+FString FInventorySaveData::GetSavePath(const FString& Filename)
+{
+	return FPaths::IsRelative(Filename) ? FPaths::ProjectSavedDir() / TEXT("Inventories") / Filename : Filename;
+}
+
+bool FInventorySaveData::LoadFromBytes(const TArray<uint8>& Data)
+{
+	FMemoryReader Reader(Data);
+	Serialize(Reader);
+
+	if (Reader.IsError())
+	{
+		Slots.Empty();
+		EquipmentSlots.Empty();
+		return false;
+	}
+
+	return true;
+}
+
+void FInventorySaveData::GetItemPrimaryAssetIds(TArray<FPrimaryAssetId>& OutItemIds) const
+{
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	TSet<FItemId> SavedItemIds;
+
+	for (const FSavedSlot& Slot: Slots)
+	{
+		SavedItemIds.Add(Slot.ItemId);
+	}
+
+	for (const FSavedEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		SavedItemIds.Add(EquipmentSlot.Slot.ItemId);
+	}
+
+	OutItemIds.Reset(SavedItemIds.Num());
+
+	for (const FItemId ItemId: SavedItemIds)
+	{
+		OutItemIds.Add(AssetManager.GetItemPrimaryAssetId(ItemId));
+	}
+}
+
+void FInventorySaveData::RemapItemIds(const TMap<FItemId, FName>& SavedItemNames)
+{
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	TMap<FItemId, FItemId> CurrentItemIds;
+	CurrentItemIds.Reserve(SavedItemNames.Num());
+
+	for (const TPair<FItemId, FName>& SavedItemName: SavedItemNames)
+	{
+		const FItemId CurrentItemId = AssetManager.GetItemId(FPrimaryAssetId(UAssetManager_Custom::InventoryItem, SavedItemName.Value));
+
+		if (CurrentItemId == UAssetManager_Custom::InvalidItemId)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Saved item %s no longer exists, its slots are not loaded"), *SavedItemName.Value.ToString());
+		}
+
+		CurrentItemIds.Add(SavedItemName.Key, CurrentItemId);
+	}
+
+	for (FSavedSlot& Slot: Slots)
+	{
+		const FItemId* CurrentItemId = CurrentItemIds.Find(Slot.ItemId);
+		Slot.ItemId = CurrentItemId ? *CurrentItemId : UAssetManager_Custom::InvalidItemId;
+	}
+
+	for (FSavedEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		const FItemId* CurrentItemId = CurrentItemIds.Find(EquipmentSlot.Slot.ItemId);
+		EquipmentSlot.Slot.ItemId = CurrentItemId ? *CurrentItemId : UAssetManager_Custom::InvalidItemId;
+	}
+
+	// kept aside so callers can tell the loss from data that never had these slots
+	for (const FSavedSlot& Slot: Slots)
+	{
+		if (Slot.ItemId == UAssetManager_Custom::InvalidItemId)
+		{
+			RemovedSlots.Add(Slot);
+		}
+	}
+
+	for (const FSavedEquipmentSlot& EquipmentSlot: EquipmentSlots)
+	{
+		if (EquipmentSlot.Slot.ItemId == UAssetManager_Custom::InvalidItemId)
+		{
+			RemovedSlots.Add(EquipmentSlot.Slot);
+		}
+	}
+
+	Slots.RemoveAll([](const FSavedSlot& Slot) { return Slot.ItemId == UAssetManager_Custom::InvalidItemId; });
+	EquipmentSlots.RemoveAll([](const FSavedEquipmentSlot& EquipmentSlot) { return EquipmentSlot.Slot.ItemId == UAssetManager_Custom::InvalidItemId; });
+
+	ItemRegistryHash = AssetManager.GetItemRegistryHash();
+}
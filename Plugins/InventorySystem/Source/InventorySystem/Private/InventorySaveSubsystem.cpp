@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventorySaveSubsystem.h"
+#include "InventoryComponent.h"
+#include "InventorySaveData.h"
+#include "InventoryStats.h"
+#include "Async/Async.h"
+
+DECLARE_CYCLE_STAT(TEXT("Inventory Save Snapshot"), STAT_InventorySaveSnapshot, STATGROUP_Inventory);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Inventory Saves In Flight"), STAT_InventorySavesInFlight, STATGROUP_Inventory);
+
+UInventorySaveSubsystem::UInventorySaveSubsystem()
+{
+	MaxInFlightSaveBytes = 4 * 1024 * 1024;
+	bCompressSaves = true;
+
+	InFlightSaveBytes = 0;
+}
+
+void UInventorySaveSubsystem::Deinitialize()
+{
+	// a save requested right before the world is torn down must still reach the disk
+	FlushSaves();
+
+	Super::Deinitialize();
+}
+
+void UInventorySaveSubsystem::Tick(const float DeltaTime)
+{
+	CompleteSaves(false);
+	StartQueuedSaves();
+}
+
+bool UInventorySaveSubsystem::IsTickable() const
+{
+	return QueuedSaves.Num() > 0 || InFlightSaves.Num() > 0;
+}
+
+ETickableTickType UInventorySaveSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UInventorySaveSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UInventorySaveSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInventorySaveSubsystem, STATGROUP_Tickables);
+}
+
+bool UInventorySaveSubsystem::SaveInventoryAsync(UInventoryComponent* Inventory, const FString& Filename, const FOnInventorySaved& OnSaved)
+{
+	if (Inventory == nullptr || Filename.IsEmpty())
+	{
+		return false;
+	}
+
+	TSharedPtr<FInventorySaveData, ESPMode::ThreadSafe> SaveData = MakeShared<FInventorySaveData, ESPMode::ThreadSafe>();
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_InventorySaveSnapshot);
+
+		if (!Inventory->MakeSaveData(*SaveData))
+		{
+			return false;
+		}
+	}
+
+	const FString SavePath = FInventorySaveData::GetSavePath(Filename);
+
+	FInventorySave* QueuedSave = QueuedSaves.FindByPredicate([&SavePath](const FInventorySave& Save) { return Save.Filename == SavePath; });
+
+	if (QueuedSave == nullptr)
+	{
+		QueuedSave = &QueuedSaves.AddDefaulted_GetRef();
+		QueuedSave->Filename = SavePath;
+	}
+
+	// the queued snapshot is outdated, only the newest one is written
+	QueuedSave->SaveData = SaveData;
+	QueuedSave->EstimatedSize = SaveData->GetEstimatedSize();
+	QueuedSave->OnSavedDelegates.Add(OnSaved);
+
+	StartQueuedSaves();
+
+	return true;
+}
+
+bool UInventorySaveSubsystem::LoadInventory(UInventoryComponent* Inventory, const FString& Filename)
+{
+	if (Inventory == nullptr)
+	{
+		return false;
+	}
+
+	const FString SavePath = FInventorySaveData::GetSavePath(Filename);
+
+	if (IsSaveInFlight(SavePath) || QueuedSaves.ContainsByPredicate([&SavePath](const FInventorySave& Save) { return Save.Filename == SavePath; }))
+	{
+		FlushSaves();
+	}
+
+	FInventorySaveData SaveData;
+	return SaveData.LoadFromFile(SavePath) && Inventory->ApplySaveData(SaveData);
+}
+
+void UInventorySaveSubsystem::FlushSaves()
+{
+	while (QueuedSaves.Num() > 0 || InFlightSaves.Num() > 0)
+	{
+		StartQueuedSaves();
+		CompleteSaves(true);
+	}
+}
+
+int32 UInventorySaveSubsystem::GetNumPendingSaves() const
+{
+	return QueuedSaves.Num() + InFlightSaves.Num();
+}
+
+void UInventorySaveSubsystem::StartQueuedSaves()
+{
+	for (int32 I = 0; I < QueuedSaves.Num(); I++)
+	{
+		if (IsSaveInFlight(QueuedSaves[I].Filename))
+		{
+			continue;
+		}
+
+		// later saves wait as well, so they are written in the order they were requested
+		if (InFlightSaves.Num() > 0 && InFlightSaveBytes + QueuedSaves[I].EstimatedSize > MaxInFlightSaveBytes)
+		{
+			break;
+		}
+
+		FInventorySave& Save = InFlightSaves.Add_GetRef(MoveTemp(QueuedSaves[I]));
+		QueuedSaves.RemoveAt(I--);
+
+		InFlightSaveBytes += Save.EstimatedSize;
+		INC_DWORD_STAT(STAT_InventorySavesInFlight);
+
+		TSharedPtr<const FInventorySaveData, ESPMode::ThreadSafe> SaveData = Save.SaveData;
+		const FString Filename = Save.Filename;
+		const bool bCompress = bCompressSaves;
+
+		Save.Result = Async(EAsyncExecution::ThreadPool, [SaveData, Filename, bCompress]()
+		{
+			return SaveData->SaveToFile(Filename, bCompress);
+		});
+	}
+}
+
+void UInventorySaveSubsystem::CompleteSaves(const bool bWait)
+{
+	TArray<FInventorySave> CompletedSaves;
+
+	for (int32 I = 0; I < InFlightSaves.Num(); I++)
+	{
+		if (bWait)
+		{
+			InFlightSaves[I].Result.Wait();
+		}
+
+		if (InFlightSaves[I].Result.IsReady())
+		{
+			CompletedSaves.Add(MoveTemp(InFlightSaves[I]));
+			InFlightSaves.RemoveAt(I--);
+		}
+	}
+
+	// delegates can queue new saves, they are called once the in flight saves are up to date
+	for (FInventorySave& Save: CompletedSaves)
+	{
+		InFlightSaveBytes -= Save.EstimatedSize;
+		DEC_DWORD_STAT(STAT_InventorySavesInFlight);
+	}
+
+	for (FInventorySave& Save: CompletedSaves)
+	{
+		const bool bSucceeded = Save.Result.Get();
+
+		if (!bSucceeded)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to save the inventory to %s, the previous save was kept"), *Save.Filename);
+		}
+
+		for (const FOnInventorySaved& OnSaved: Save.OnSavedDelegates)
+		{
+			OnSaved.ExecuteIfBound(Save.Filename, bSucceeded);
+		}
+	}
+}
+
+bool UInventorySaveSubsystem::IsSaveInFlight(const FString& Filename) const
+{
+	return InFlightSaves.ContainsByPredicate([&Filename](const FInventorySave& Save) { return Save.Filename == Filename; });
+}
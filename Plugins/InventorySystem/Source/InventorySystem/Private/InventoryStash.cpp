@@ -0,0 +1,968 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryStash.h"
+#include "InventoryComponent.h"
+#include "InventoryPlacement.h"
+#include "InventorySaveData.h"
+#include "Item.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+const uint32 FInventoryStash::Magic = 0x53564E49;
+const uint32 FInventoryStash::Version = 2;
+
+FInventoryStash::FInventoryStash()
+{
+	Inventory = nullptr;
+	FMemory::Memzero(Header);
+
+	NumPagesX = 0;
+	NumPagesY = 0;
+
+	static_assert(sizeof(FHeader) == 32, "The stash header is part of the file layout");
+	static_assert(sizeof(FSlotRecord) == 12, "Stash slot records are part of the file layout");
+}
+
+FInventoryStash::~FInventoryStash()
+{
+	UnmapFile();
+}
+
+bool FInventoryStash::Open(UInventoryComponent* InInventory, const FString& InFilename, const int32 InPageSize)
+{
+	check(InInventory != nullptr);
+
+	Close();
+
+	if (InInventory->Slots.Num() > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s already has slots, a stash can only back an empty inventory"), *GetNameSafe(InInventory));
+		return false;
+	}
+
+	const FPoint2D& GridSize = InInventory->GridSize;
+
+	if (GridSize.X <= 0 || GridSize.Y <= 0 || GridSize.X > FInventorySaveData::MaxGridSize || GridSize.Y > FInventorySaveData::MaxGridSize)
+	{
+		return false;
+	}
+
+	Filename = InFilename;
+
+	if (!IFileManager::Get().FileExists(*Filename))
+	{
+		FHeader NewHeader;
+		FMemory::Memzero(NewHeader);
+
+		NewHeader.Magic = Magic;
+		NewHeader.Version = Version;
+		NewHeader.ItemRegistryHash = UAssetManager_Custom::Get().GetItemRegistryHash();
+		NewHeader.GridSizeX = GridSize.X;
+		NewHeader.GridSizeY = GridSize.Y;
+		NewHeader.PageSize = FMath::Clamp(InPageSize, 1, 256);
+
+		if (!CreateFile(NewHeader))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to create the stash %s"), *Filename);
+			return false;
+		}
+	}
+
+	if (!MapFile())
+	{
+		return false;
+	}
+
+	FMemory::Memcpy(&Header, MappedRegion->GetMappedPtr(), sizeof(FHeader));
+
+	if (Header.Magic != Magic || Header.Version < 1 || Header.Version > Version || Header.PageSize <= 0 || Header.GridSizeX != GridSize.X || Header.GridSizeY != GridSize.Y)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s isn't a stash of the grid size of %s"), *Filename, *GetNameSafe(InInventory));
+		UnmapFile();
+		return false;
+	}
+
+	NumPagesX = FMath::DivideAndRoundUp(Header.GridSizeX, Header.PageSize);
+	NumPagesY = FMath::DivideAndRoundUp(Header.GridSizeY, Header.PageSize);
+
+	if (MappedRegion->GetMappedSize() < GetItemNamesOffset())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s is truncated"), *Filename);
+		UnmapFile();
+		return false;
+	}
+
+	Inventory = InInventory;
+
+	LoadedPages.Init(false, NumPagesX * NumPagesY);
+	UnloadedOccupancy.Init(false, Header.GridSizeX * Header.GridSizeY);
+
+	const uint8* Occupancy = MappedRegion->GetMappedPtr() + GetOccupancyOffset();
+
+	for (int32 I = 0; I < UnloadedOccupancy.Num(); I++)
+	{
+		if (Occupancy[I >> 3] & (1 << (I & 7)))
+		{
+			UnloadedOccupancy[I] = true;
+		}
+	}
+
+	const bool bIsRemapped = Header.ItemRegistryHash != UAssetManager_Custom::Get().GetItemRegistryHash();
+
+	if (bIsRemapped && !RemapItemIds())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to remap the items of %s to the current item registry"), *Filename);
+		Inventory = nullptr;
+		UnmapFile();
+		return false;
+	}
+
+	// files written before the totals are counted once and upgraded, remapped ones were counted while remapping
+	if (!bIsRemapped && (Header.Version < Version || !ReadItemQuantities()))
+	{
+		CountItemQuantitiesFromPages();
+
+		if (!WriteFile(TMap<int32, TArray<uint8>>(), nullptr))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to write the item totals of %s"), *Filename);
+			Inventory = nullptr;
+			UnmapFile();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void FInventoryStash::Close()
+{
+	if (IsOpen())
+	{
+		UnloadRegion(FPoint2D(0, 0), FPoint2D(Header.GridSizeX - 1, Header.GridSizeY - 1));
+
+		// slots that couldn't be written are kept by the inventory rather than lost with the stash
+		if (Inventory->Slots.Num() > 0)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%d slots of %s couldn't be written, they stay in the inventory"), Inventory->Slots.Num(), *Filename);
+		}
+	}
+
+	UnmapFile();
+
+	Inventory = nullptr;
+	LoadedPages.Empty();
+	UnloadedOccupancy.Empty();
+	UnresolvedRecords.Empty();
+	ItemQuantities.Empty();
+}
+
+bool FInventoryStash::IsOpen() const
+{
+	return Inventory != nullptr && MappedRegion.IsValid();
+}
+
+void FInventoryStash::LoadRegion(const FPoint2D& Min, const FPoint2D& Max)
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	const int32 MinPageX = FMath::Clamp(Min.X / Header.PageSize, 0, NumPagesX - 1);
+	const int32 MinPageY = FMath::Clamp(Min.Y / Header.PageSize, 0, NumPagesY - 1);
+	const int32 MaxPageX = FMath::Clamp(Max.X / Header.PageSize, 0, NumPagesX - 1);
+	const int32 MaxPageY = FMath::Clamp(Max.Y / Header.PageSize, 0, NumPagesY - 1);
+
+	// records are trusted as long as they fit the grid and don't overlap a materialized slot
+	FInventoryGridOccupancy Occupancy(Inventory->GridSize);
+
+	for (const FSlot& Slot: Inventory->Slots)
+	{
+		Occupancy.Occupy(Slot.Instance.TopLeftCoordinates, Slot.Instance.Size);
+	}
+
+	TArray<TPair<UItem*, int32>> DisplacedItems;
+
+	Inventory->BeginNotificationBatch();
+
+	for (int32 PageY = MinPageY; PageY <= MaxPageY; PageY++)
+	{
+		for (int32 PageX = MinPageX; PageX <= MaxPageX; PageX++)
+		{
+			const int32 PageIndex = PageY * NumPagesX + PageX;
+
+			if (LoadedPages[PageIndex])
+			{
+				continue;
+			}
+
+			for (const FSlotRecord& Record: GetPageRecords(PageIndex))
+			{
+				UItem* Item = AssetManager.GetLoadedItem(Record.ItemId);
+
+				if (Item == nullptr && AssetManager.GetItemPrimaryAssetId(Record.ItemId).IsValid())
+				{
+					Item = AssetManager.ForceLoadItem(AssetManager.GetItemPrimaryAssetId(Record.ItemId));
+				}
+
+				// its cells stay occupied, the record is written back untouched
+				if (Item == nullptr || Record.Quantity <= 0)
+				{
+					UnresolvedRecords.FindOrAdd(PageIndex).Add(Record);
+					continue;
+				}
+
+				SetRecordCells(UnloadedOccupancy, Record, false);
+
+				FSavedSlot Placement;
+				Placement.PackedPlacement = Record.PackedPlacement;
+
+				FItemInstanceData Instance(Item);
+				Instance.TopLeftCoordinates = Placement.GetTopLeftCoordinates();
+
+				if (Placement.IsRotated())
+				{
+					Instance.Rotate();
+				}
+
+				if (!Occupancy.IsFree(Instance.TopLeftCoordinates, Instance.Size))
+				{
+					DisplacedItems.Add(TPair<UItem*, int32>(Item, Record.Quantity));
+					continue;
+				}
+
+				Occupancy.Occupy(Instance.TopLeftCoordinates, Instance.Size);
+				Inventory->Slots.Add(Inventory->MakeSlot(Instance, Record.Quantity));
+			}
+
+			LoadedPages[PageIndex] = true;
+		}
+	}
+
+	// written back wherever they fit once every page is loaded
+	Inventory->UpdateCells();
+
+	for (const TPair<UItem*, int32>& DisplacedItem: DisplacedItems)
+	{
+		int32 AddedQuantity = 0;
+		Inventory->AddExistingItem_Internal(DisplacedItem.Key, DisplacedItem.Value, AddedQuantity);
+
+		if (AddedQuantity < DisplacedItem.Value)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s lost %d %s, the record no longer fits"), *Filename, DisplacedItem.Value - AddedQuantity, *GetNameSafe(DisplacedItem.Key));
+		}
+	}
+
+	Inventory->NotifyInventoryUpdated();
+	Inventory->NotifyStashRegionChanged();
+
+	Inventory->EndNotificationBatch();
+}
+
+void FInventoryStash::UnloadRegion(const FPoint2D& Min, const FPoint2D& Max)
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	// nothing is removed unless it reached the file
+	TBitArray<> UnwrittenPages;
+
+	if (!WriteLoadedPages(UnwrittenPages))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to write back %s, its pages stay loaded"), *Filename);
+		return;
+	}
+
+	const int32 MinPageX = FMath::Clamp(Min.X / Header.PageSize, 0, NumPagesX - 1);
+	const int32 MinPageY = FMath::Clamp(Min.Y / Header.PageSize, 0, NumPagesY - 1);
+	const int32 MaxPageX = FMath::Clamp(Max.X / Header.PageSize, 0, NumPagesX - 1);
+	const int32 MaxPageY = FMath::Clamp(Max.Y / Header.PageSize, 0, NumPagesY - 1);
+
+	TBitArray<> UnloadedPages(false, LoadedPages.Num());
+
+	for (int32 PageY = MinPageY; PageY <= MaxPageY; PageY++)
+	{
+		for (int32 PageX = MinPageX; PageX <= MaxPageX; PageX++)
+		{
+			const int32 PageIndex = PageY * NumPagesX + PageX;
+
+			// a page holding a slot that couldn't be written stays loaded, its slot would be lost otherwise
+			if (!LoadedPages[PageIndex] || UnwrittenPages[PageIndex])
+			{
+				continue;
+			}
+
+			UnloadedPages[PageIndex] = true;
+			LoadedPages[PageIndex] = false;
+
+			UnresolvedRecords.Remove(PageIndex);
+		}
+	}
+
+	Inventory->BeginNotificationBatch();
+
+	for (int32 I = Inventory->Slots.Num() - 1; I >= 0; I--)
+	{
+		const FSlot& Slot = Inventory->Slots[I];
+
+		if (!UnloadedPages[GetPageIndex(Slot.Instance.TopLeftCoordinates)])
+		{
+			continue;
+		}
+
+		SetRecordCells(UnloadedOccupancy, MakeSlotRecord(Slot), true);
+
+		Inventory->ReleaseItemInstance(Slot);
+		Inventory->Slots.RemoveAt(I);
+	}
+
+	Inventory->NotifyInventoryUpdated();
+	Inventory->NotifyStashRegionChanged();
+
+	Inventory->EndNotificationBatch();
+}
+
+bool FInventoryStash::Flush()
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	TBitArray<> UnwrittenPages;
+	return WriteLoadedPages(UnwrittenPages) && UnwrittenPages.Find(true) == INDEX_NONE;
+}
+
+bool FInventoryStash::WriteLoadedPages(TBitArray<>& OutUnwrittenPages)
+{
+	OutUnwrittenPages.Init(false, LoadedPages.Num());
+
+	TMap<int32, TArray<FSlotRecord>> PageRecords = UnresolvedRecords;
+	TBitArray<> Occupancy = UnloadedOccupancy;
+
+	for (const FSlot& Slot: Inventory->Slots)
+	{
+		const FSlotRecord Record = MakeSlotRecord(Slot);
+		const int32 PageIndex = GetPageIndex(Slot.Instance.TopLeftCoordinates);
+
+		if (Record.ItemId == UAssetManager_Custom::InvalidItemId)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Can't write %s to %s, it isn't registered in the item registry"), *GetNameSafe(Slot.GetItem()), *Filename);
+			OutUnwrittenPages[PageIndex] = true;
+			continue;
+		}
+
+		PageRecords.FindOrAdd(PageIndex).Add(Record);
+		SetRecordCells(Occupancy, Record, true);
+	}
+
+	TMap<int32, TArray<uint8>> DirtyPages;
+	const TArray<FSlotRecord> NoRecords;
+
+	for (TConstSetBitIterator<> It(LoadedPages); It; ++It)
+	{
+		const TArray<FSlotRecord>* Records = PageRecords.Find(It.GetIndex());
+
+		TArray<uint8> Page;
+		EncodePage(Records ? *Records : NoRecords, Page);
+
+		if (FMemory::Memcmp(Page.GetData(), GetMappedPage(It.GetIndex()), Page.Num()) != 0)
+		{
+			const TArray<FSlotRecord>& NewRecords = Records ? *Records : NoRecords;
+
+			// the totals follow the page from what was written to what will be, records past the capacity aren't encoded
+			AddItemQuantities(GetPageRecords(It.GetIndex()), -1);
+			AddItemQuantities(MakeArrayView(NewRecords.GetData(), FMath::Min(NewRecords.Num(), GetPageCapacity())), 1);
+
+			DirtyPages.Add(It.GetIndex(), MoveTemp(Page));
+		}
+	}
+
+	TArray<uint8> OccupancyData;
+	GetOccupancyData(Occupancy, OccupancyData);
+
+	const bool bIsOccupancyDirty = FMemory::Memcmp(OccupancyData.GetData(), MappedRegion->GetMappedPtr() + GetOccupancyOffset(), OccupancyData.Num()) != 0;
+	const bool bAreItemNamesDirty = Header.NumItemNames != UAssetManager_Custom::Get().GetNumRegisteredItems();
+
+	if (DirtyPages.Num() == 0 && !bIsOccupancyDirty && !bAreItemNamesDirty)
+	{
+		return true;
+	}
+
+	if (!WriteFile(DirtyPages, bIsOccupancyDirty ? &OccupancyData : nullptr))
+	{
+		// whatever reached the file is what the totals have to match
+		if (MappedRegion.IsValid())
+		{
+			CountItemQuantitiesFromPages();
+		}
+
+		return false;
+	}
+
+	return true;
+}
+
+bool FInventoryStash::IsCellLoaded(const FPoint2D& Coordinates) const
+{
+	if (!IsOpen() || Coordinates.X < 0 || Coordinates.Y < 0 || Coordinates.X >= Header.GridSizeX || Coordinates.Y >= Header.GridSizeY)
+	{
+		return false;
+	}
+
+	return LoadedPages[GetPageIndex(Coordinates)];
+}
+
+bool FInventoryStash::IsCellAvailable(const FPoint2D& Coordinates) const
+{
+	return IsCellLoaded(Coordinates) && !UnloadedOccupancy[Coordinates.Y * Header.GridSizeX + Coordinates.X];
+}
+
+void FInventoryStash::GetLoadedCells(TArray<FPoint2D>& OutCells) const
+{
+	OutCells.Reset();
+
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	TArray<int32> LoadedPagesY;
+
+	for (int32 PageX = 0; PageX < NumPagesX; PageX++)
+	{
+		LoadedPagesY.Reset();
+
+		for (int32 PageY = 0; PageY < NumPagesY; PageY++)
+		{
+			if (LoadedPages[PageY * NumPagesX + PageX])
+			{
+				LoadedPagesY.Add(PageY);
+			}
+		}
+
+		const int32 MaxX = FMath::Min((PageX + 1) * Header.PageSize, Header.GridSizeX);
+
+		for (int32 X = PageX * Header.PageSize; LoadedPagesY.Num() > 0 && X < MaxX; X++)
+		{
+			for (const int32 PageY: LoadedPagesY)
+			{
+				const int32 MaxY = FMath::Min((PageY + 1) * Header.PageSize, Header.GridSizeY);
+
+				for (int32 Y = PageY * Header.PageSize; Y < MaxY; Y++)
+				{
+					OutCells.Add(FPoint2D(X, Y));
+				}
+			}
+		}
+	}
+}
+
+void FInventoryStash::GetLoadedOccupancy(FInventoryGridOccupancy& OutOccupancy) const
+{
+	OutOccupancy = FInventoryGridOccupancy();
+
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	FPoint2D MinPage(NumPagesX, NumPagesY);
+	FPoint2D MaxPage(-1, -1);
+
+	for (TConstSetBitIterator<> It(LoadedPages); It; ++It)
+	{
+		const int32 PageX = It.GetIndex() % NumPagesX;
+		const int32 PageY = It.GetIndex() / NumPagesX;
+
+		MinPage = FPoint2D(FMath::Min(MinPage.X, PageX), FMath::Min(MinPage.Y, PageY));
+		MaxPage = FPoint2D(FMath::Max(MaxPage.X, PageX), FMath::Max(MaxPage.Y, PageY));
+	}
+
+	if (MaxPage.X < 0)
+	{
+		return;
+	}
+
+	const FPoint2D Origin(MinPage.X * Header.PageSize, MinPage.Y * Header.PageSize);
+	const FPoint2D End(FMath::Min((MaxPage.X + 1) * Header.PageSize, Header.GridSizeX), FMath::Min((MaxPage.Y + 1) * Header.PageSize, Header.GridSizeY));
+
+	OutOccupancy = FInventoryGridOccupancy(Origin, FPoint2D(End.X - Origin.X, End.Y - Origin.Y));
+
+	// pages between the loaded ones are occupied whole, the loaded ones only where unloaded slots cover them
+	for (int32 PageY = MinPage.Y; PageY <= MaxPage.Y; PageY++)
+	{
+		for (int32 PageX = MinPage.X; PageX <= MaxPage.X; PageX++)
+		{
+			const FPoint2D PageOrigin(PageX * Header.PageSize, PageY * Header.PageSize);
+
+			if (!LoadedPages[PageY * NumPagesX + PageX])
+			{
+				OutOccupancy.Occupy(PageOrigin, FPoint2D(Header.PageSize, Header.PageSize));
+				continue;
+			}
+
+			const int32 MaxX = FMath::Min(PageOrigin.X + Header.PageSize, Header.GridSizeX);
+			const int32 MaxY = FMath::Min(PageOrigin.Y + Header.PageSize, Header.GridSizeY);
+
+			for (int32 Y = PageOrigin.Y; Y < MaxY; Y++)
+			{
+				for (int32 X = PageOrigin.X; X < MaxX; X++)
+				{
+					if (UnloadedOccupancy[Y * Header.GridSizeX + X])
+					{
+						OutOccupancy.Occupy(FPoint2D(X, Y), FPoint2D(1, 1));
+					}
+				}
+			}
+		}
+	}
+}
+
+int32 FInventoryStash::CountItemQuantity(const FItemId ItemId) const
+{
+	if (!IsOpen() || ItemId == UAssetManager_Custom::InvalidItemId)
+	{
+		return 0;
+	}
+
+	int64 Quantity = ItemQuantities.IsValidIndex(ItemId) ? ItemQuantities[ItemId] : 0;
+
+	// the loaded pages are counted from their slots, which may have changed since they were written
+	TMap<FItemId, int64> LoadedRecordQuantities;
+	CountLoadedRecordQuantities(LoadedRecordQuantities);
+
+	Quantity -= LoadedRecordQuantities.FindRef(ItemId);
+
+	for (const FSlot& Slot: Inventory->Slots)
+	{
+		if (Slot.Instance.ItemId == ItemId)
+		{
+			Quantity += Slot.Quantity;
+		}
+	}
+
+	return static_cast<int32>(FMath::Clamp<int64>(Quantity, 0, MAX_int32));
+}
+
+void FInventoryStash::CountUnloadedItemQuantities(TMap<FItemId, int32>& OutQuantities) const
+{
+	OutQuantities.Reset();
+
+	if (!IsOpen())
+	{
+		return;
+	}
+
+	TMap<FItemId, int64> LoadedRecordQuantities;
+	CountLoadedRecordQuantities(LoadedRecordQuantities);
+
+	for (int32 ItemId = 1; ItemId < ItemQuantities.Num(); ItemId++)
+	{
+		const int64 Quantity = ItemQuantities[ItemId] - LoadedRecordQuantities.FindRef(static_cast<FItemId>(ItemId));
+
+		if (Quantity > 0)
+		{
+			OutQuantities.Add(static_cast<FItemId>(ItemId), static_cast<int32>(FMath::Min<int64>(Quantity, MAX_int32)));
+		}
+	}
+}
+
+bool FInventoryStash::CreateFile(const FHeader& NewHeader)
+{
+	Header = NewHeader;
+
+	NumPagesX = FMath::DivideAndRoundUp(Header.GridSizeX, Header.PageSize);
+	NumPagesY = FMath::DivideAndRoundUp(Header.GridSizeY, Header.PageSize);
+
+	TArray<uint8> ItemNames;
+	FMemoryWriter ItemNamesWriter(ItemNames);
+
+	Header.NumItemNames = WriteItemNames(ItemNamesWriter);
+
+	// every total starts at zero along with the pages
+	ItemQuantities.Reset();
+	WriteItemQuantities(ItemNamesWriter);
+
+	const FString TempFilename = Filename + TEXT(".tmp");
+
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempFilename));
+	if (!Writer.IsValid())
+	{
+		return false;
+	}
+
+	Writer->Serialize(&Header, sizeof(FHeader));
+
+	// the occupancy and every page start empty
+	TArray<uint8> Zeros;
+	Zeros.SetNumZeroed(64 * 1024);
+
+	for (int64 RemainingBytes = GetItemNamesOffset() - sizeof(FHeader); RemainingBytes > 0; RemainingBytes -= Zeros.Num())
+	{
+		Writer->Serialize(Zeros.GetData(), FMath::Min<int64>(RemainingBytes, Zeros.Num()));
+	}
+
+	Writer->Serialize(ItemNames.GetData(), ItemNames.Num());
+
+	const bool bSucceeded = Writer->Close() && !Writer->IsError();
+	Writer.Reset();
+
+	return bSucceeded && IFileManager::Get().Move(*Filename, *TempFilename, true);
+}
+
+bool FInventoryStash::MapFile()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	MappedFile.Reset(PlatformFile.OpenMapped(*Filename));
+
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+	}
+
+	if (!MappedRegion.IsValid() || MappedRegion->GetMappedSize() < static_cast<int64>(sizeof(FHeader)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Failed to map the stash %s"), *Filename);
+		UnmapFile();
+		return false;
+	}
+
+	return true;
+}
+
+void FInventoryStash::UnmapFile()
+{
+	// regions must be released before their file
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FInventoryStash::RemapItemIds()
+{
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	const int64 ItemNamesOffset = GetItemNamesOffset();
+	const TArray<uint8> ItemNames(MappedRegion->GetMappedPtr() + ItemNamesOffset, MappedRegion->GetMappedSize() - ItemNamesOffset);
+
+	FMemoryReader Reader(ItemNames);
+
+	TArray<FItemId> CurrentItemIds;
+	CurrentItemIds.SetNumZeroed(Header.NumItemNames + 1);
+
+	for (int32 SavedItemId = 1; SavedItemId <= Header.NumItemNames; SavedItemId++)
+	{
+		FString ItemName;
+		Reader << ItemName;
+
+		if (Reader.IsError())
+		{
+			return false;
+		}
+
+		CurrentItemIds[SavedItemId] = AssetManager.GetItemId(FPrimaryAssetId(UAssetManager_Custom::InventoryItem, FName(*ItemName)));
+
+		if (CurrentItemIds[SavedItemId] == UAssetManager_Custom::InvalidItemId)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Stashed item %s no longer exists, its slots are removed from %s"), *ItemName, *Filename);
+		}
+	}
+
+	TMap<int32, TArray<uint8>> Pages;
+	UnloadedOccupancy.Init(false, UnloadedOccupancy.Num());
+
+	// every page is read anyway, the totals are counted from the remapped records
+	ItemQuantities.Init(0, AssetManager.GetNumRegisteredItems() + 1);
+
+	for (int32 PageIndex = 0; PageIndex < LoadedPages.Num(); PageIndex++)
+	{
+		TArray<FSlotRecord> Records;
+
+		for (FSlotRecord Record: GetPageRecords(PageIndex))
+		{
+			Record.ItemId = CurrentItemIds.IsValidIndex(Record.ItemId) ? CurrentItemIds[Record.ItemId] : UAssetManager_Custom::InvalidItemId;
+
+			if (Record.ItemId != UAssetManager_Custom::InvalidItemId)
+			{
+				SetRecordCells(UnloadedOccupancy, Record, true);
+				Records.Add(Record);
+			}
+		}
+
+		AddItemQuantities(Records, 1);
+
+		TArray<uint8> Page;
+		EncodePage(Records, Page);
+
+		if (FMemory::Memcmp(Page.GetData(), GetMappedPage(PageIndex), Page.Num()) != 0)
+		{
+			Pages.Add(PageIndex, MoveTemp(Page));
+		}
+	}
+
+	TArray<uint8> OccupancyData;
+	GetOccupancyData(UnloadedOccupancy, OccupancyData);
+
+	return WriteFile(Pages, &OccupancyData);
+}
+
+bool FInventoryStash::ReadItemQuantities()
+{
+	const int64 ItemNamesOffset = GetItemNamesOffset();
+	const TArray<uint8> ItemTable(MappedRegion->GetMappedPtr() + ItemNamesOffset, MappedRegion->GetMappedSize() - ItemNamesOffset);
+
+	FMemoryReader Reader(ItemTable);
+
+	for (int32 ItemId = 1; ItemId <= Header.NumItemNames; ItemId++)
+	{
+		FString ItemName;
+		Reader << ItemName;
+	}
+
+	ItemQuantities.Init(0, Header.NumItemNames + 1);
+
+	for (int32 ItemId = 1; ItemId <= Header.NumItemNames; ItemId++)
+	{
+		Reader << ItemQuantities[ItemId];
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("The item totals of %s are truncated, they are counted again"), *Filename);
+		ItemQuantities.Reset();
+		return false;
+	}
+
+	return true;
+}
+
+void FInventoryStash::CountItemQuantitiesFromPages()
+{
+	ItemQuantities.Init(0, Header.NumItemNames + 1);
+
+	for (int32 PageIndex = 0; PageIndex < LoadedPages.Num(); PageIndex++)
+	{
+		AddItemQuantities(GetPageRecords(PageIndex), 1);
+	}
+}
+
+void FInventoryStash::AddItemQuantities(const TArrayView<const FSlotRecord> Records, const int64 Sign)
+{
+	for (const FSlotRecord& Record: Records)
+	{
+		if (Record.ItemId == UAssetManager_Custom::InvalidItemId)
+		{
+			continue;
+		}
+
+		if (!ItemQuantities.IsValidIndex(Record.ItemId))
+		{
+			ItemQuantities.SetNumZeroed(Record.ItemId + 1);
+		}
+
+		ItemQuantities[Record.ItemId] += Sign * Record.Quantity;
+	}
+}
+
+void FInventoryStash::CountLoadedRecordQuantities(TMap<FItemId, int64>& OutQuantities) const
+{
+	OutQuantities.Reset();
+
+	for (TConstSetBitIterator<> It(LoadedPages); It; ++It)
+	{
+		for (const FSlotRecord& Record: GetPageRecords(It.GetIndex()))
+		{
+			OutQuantities.FindOrAdd(Record.ItemId) += Record.Quantity;
+		}
+
+		// records that couldn't be materialized are still in the stash
+		if (const TArray<FSlotRecord>* PageUnresolvedRecords = UnresolvedRecords.Find(It.GetIndex()))
+		{
+			for (const FSlotRecord& Record: *PageUnresolvedRecords)
+			{
+				OutQuantities.FindOrAdd(Record.ItemId) -= Record.Quantity;
+			}
+		}
+	}
+}
+
+bool FInventoryStash::WriteFile(const TMap<int32, TArray<uint8>>& Pages, const TArray<uint8>* Occupancy)
+{
+	UnmapFile();
+
+	TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*Filename, true, true));
+	bool bSucceeded = FileHandle.IsValid();
+
+	for (const TPair<int32, TArray<uint8>>& Page: Pages)
+	{
+		bSucceeded = bSucceeded && FileHandle->Seek(GetPagesOffset() + Page.Key * GetPageBytes()) && FileHandle->Write(Page.Value.GetData(), Page.Value.Num());
+	}
+
+	if (Occupancy)
+	{
+		bSucceeded = bSucceeded && FileHandle->Seek(GetOccupancyOffset()) && FileHandle->Write(Occupancy->GetData(), Occupancy->Num());
+	}
+
+	// the names and totals come last and are the only part whose size varies, the header points at them
+	if (bSucceeded)
+	{
+		TArray<uint8> ItemTable;
+		FMemoryWriter ItemTableWriter(ItemTable);
+
+		Header.NumItemNames = WriteItemNames(ItemTableWriter);
+		Header.ItemRegistryHash = UAssetManager_Custom::Get().GetItemRegistryHash();
+		Header.Version = Version;
+
+		WriteItemQuantities(ItemTableWriter);
+
+		bSucceeded = FileHandle->Seek(GetItemNamesOffset()) && FileHandle->Write(ItemTable.GetData(), ItemTable.Num())
+			&& FileHandle->Seek(0) && FileHandle->Write(reinterpret_cast<const uint8*>(&Header), sizeof(FHeader));
+	}
+
+	bSucceeded = bSucceeded && FileHandle->Flush();
+	FileHandle.Reset();
+
+	if (!MapFile())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Lost the mapping of the stash %s, it is closed"), *Filename);
+		return false;
+	}
+
+	return bSucceeded;
+}
+
+void FInventoryStash::EncodePage(const TArray<FSlotRecord>& Records, TArray<uint8>& OutPage) const
+{
+	OutPage.SetNumZeroed(GetPageBytes());
+
+	// every slot covers its top left cell, a page never has more slots than cells
+	const int32 NumRecords = FMath::Min(Records.Num(), GetPageCapacity());
+
+	FMemory::Memcpy(OutPage.GetData(), &NumRecords, sizeof(int32));
+	FMemory::Memcpy(OutPage.GetData() + sizeof(int32), Records.GetData(), NumRecords * sizeof(FSlotRecord));
+}
+
+TArrayView<const FInventoryStash::FSlotRecord> FInventoryStash::GetPageRecords(const int32 PageIndex) const
+{
+	const uint8* Page = GetMappedPage(PageIndex);
+
+	int32 NumRecords = 0;
+	FMemory::Memcpy(&NumRecords, Page, sizeof(int32));
+
+	return TArrayView<const FSlotRecord>(reinterpret_cast<const FSlotRecord*>(Page + sizeof(int32)), FMath::Clamp(NumRecords, 0, GetPageCapacity()));
+}
+
+const uint8* FInventoryStash::GetMappedPage(const int32 PageIndex) const
+{
+	return MappedRegion->GetMappedPtr() + GetPagesOffset() + PageIndex * GetPageBytes();
+}
+
+void FInventoryStash::SetRecordCells(TBitArray<>& Cells, const FSlotRecord& Record, const bool bIsOccupied) const
+{
+	FSavedSlot Placement;
+	Placement.PackedPlacement = Record.PackedPlacement;
+
+	const FPoint2D TopLeftCoordinates = Placement.GetTopLeftCoordinates();
+	const FPoint2D Size = UAssetManager_Custom::Get().GetItemDefinition(Record.ItemId).GetSize(Placement.IsRotated());
+
+	const int32 MaxX = FMath::Min(TopLeftCoordinates.X + FMath::Max(Size.X, 1), Header.GridSizeX);
+	const int32 MaxY = FMath::Min(TopLeftCoordinates.Y + FMath::Max(Size.Y, 1), Header.GridSizeY);
+
+	for (int32 Y = TopLeftCoordinates.Y; Y < MaxY; Y++)
+	{
+		for (int32 X = TopLeftCoordinates.X; X < MaxX; X++)
+		{
+			Cells[Y * Header.GridSizeX + X] = bIsOccupied;
+		}
+	}
+}
+
+void FInventoryStash::GetOccupancyData(const TBitArray<>& Cells, TArray<uint8>& OutData) const
+{
+	OutData.SetNumZeroed(GetOccupancyBytes());
+
+	for (TConstSetBitIterator<> It(Cells); It; ++It)
+	{
+		OutData[It.GetIndex() >> 3] |= 1 << (It.GetIndex() & 7);
+	}
+}
+
+int32 FInventoryStash::GetPageIndex(const FPoint2D& Coordinates) const
+{
+	return (Coordinates.Y / Header.PageSize) * NumPagesX + Coordinates.X / Header.PageSize;
+}
+
+int32 FInventoryStash::GetPageCapacity() const
+{
+	return Header.PageSize * Header.PageSize;
+}
+
+int64 FInventoryStash::GetPageBytes() const
+{
+	return Align(sizeof(int32) + GetPageCapacity() * sizeof(FSlotRecord), 16);
+}
+
+int64 FInventoryStash::GetOccupancyOffset() const
+{
+	return sizeof(FHeader);
+}
+
+int64 FInventoryStash::GetOccupancyBytes() const
+{
+	return Align(FMath::DivideAndRoundUp(static_cast<int64>(Header.GridSizeX) * Header.GridSizeY, static_cast<int64>(8)), 16);
+}
+
+int64 FInventoryStash::GetPagesOffset() const
+{
+	return GetOccupancyOffset() + GetOccupancyBytes();
+}
+
+int64 FInventoryStash::GetItemNamesOffset() const
+{
+	return GetPagesOffset() + static_cast<int64>(NumPagesX) * NumPagesY * GetPageBytes();
+}
+
+FInventoryStash::FSlotRecord FInventoryStash::MakeSlotRecord(const FSlot& Slot)
+{
+	FSavedSlot Placement;
+	Placement.SetPlacement(Slot.Instance.TopLeftCoordinates, Slot.Instance.bIsRotated);
+
+	FSlotRecord Record;
+	Record.ItemId = Slot.Instance.ItemId;
+	Record.Reserved = 0;
+	Record.Quantity = Slot.Quantity;
+	Record.PackedPlacement = Placement.PackedPlacement;
+
+	return Record;
+}
+
+int32 FInventoryStash::WriteItemNames(FArchive& Ar)
+{
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+	const int32 NumItemNames = AssetManager.GetNumRegisteredItems();
+
+	for (int32 ItemId = 1; ItemId <= NumItemNames; ItemId++)
+	{
+		FString ItemName = AssetManager.GetItemPrimaryAssetId(ItemId).PrimaryAssetName.ToString();
+		Ar << ItemName;
+	}
+
+	return NumItemNames;
+}
+
+void FInventoryStash::WriteItemQuantities(FArchive& Ar) const
+{
+	for (int32 ItemId = 1; ItemId <= Header.NumItemNames; ItemId++)
+	{
+		int64 Quantity = ItemQuantities.IsValidIndex(ItemId) ? ItemQuantities[ItemId] : 0;
+		Ar << Quantity;
+	}
+}
@@ -0,0 +1,308 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "InventoryValidationCommandlet.h"
+#include "AssetManager_Custom.h"
+#include "InventorySaveData.h"
+#include "InventoryPlacement.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+/**
+ * Inventory File Report
+ */
+struct FInventoryFileReport
+{
+	FInventoryFileReport()
+	{
+		NumBytes = 0;
+		NumSlots = 0;
+		NumMisplacedSlots = 0;
+		NumOverfullStacks = 0;
+		NumDanglingItems = 0;
+		NumLostSlots = 0;
+		LostQuantity = 0;
+		bIsInventory = false;
+		bIsReadable = false;
+		bNeedsWrite = false;
+		bIsWritten = false;
+	}
+
+	bool IsValid() const
+	{
+		return NumMisplacedSlots == 0 && NumOverfullStacks == 0 && NumDanglingItems == 0;
+	}
+
+	int64 NumBytes;
+	int32 NumSlots;
+	int32 NumMisplacedSlots;
+	int32 NumOverfullStacks;
+	int32 NumDanglingItems;
+	int32 NumLostSlots;
+	int32 LostQuantity;
+
+	uint8 bIsInventory : 1;
+	uint8 bIsReadable : 1;
+
+	/** The validated data differs from the file, because it was repaired or saved with an older format or item registry */
+	uint8 bNeedsWrite : 1;
+	uint8 bIsWritten : 1;
+};
+
+static void ValidateSaveData(FInventorySaveData& SaveData, FInventoryFileReport& Report)
+{
+	const UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	FInventoryGridOccupancy Occupancy(SaveData.GridSize);
+
+	TArray<FSavedSlot> ValidSlots;
+	TArray<FSavedSlot> DisplacedSlots;
+
+	ValidSlots.Reserve(SaveData.Slots.Num());
+
+	for (FSavedSlot& Slot: SaveData.Slots)
+	{
+		const FItemDefinition& ItemDefinition = AssetManager.GetItemDefinition(Slot.ItemId);
+
+		// removed items and items whose asset failed to load have no baked definition
+		if (!ItemDefinition.bIsBaked)
+		{
+			Report.NumDanglingItems++;
+			Report.NumLostSlots++;
+			Report.LostQuantity += Slot.Quantity;
+			continue;
+		}
+
+		const int32 MaxQuantity = ItemDefinition.GetMaxSlotQuantity();
+
+		if (Slot.Quantity > MaxQuantity)
+		{
+			Report.NumOverfullStacks++;
+
+			// the custom data stays with the original slot
+			for (int32 RemainingQuantity = Slot.Quantity - MaxQuantity; RemainingQuantity > 0; RemainingQuantity -= MaxQuantity)
+			{
+				FSavedSlot& ExcessSlot = DisplacedSlots.AddDefaulted_GetRef();
+				ExcessSlot.ItemId = Slot.ItemId;
+				ExcessSlot.Quantity = FMath::Min(RemainingQuantity, MaxQuantity);
+			}
+
+			Slot.Quantity = MaxQuantity;
+		}
+
+		const bool bIsRotationValid = !Slot.IsRotated() || ItemDefinition.bCanBeRotated;
+		const FPoint2D TopLeft = Slot.GetTopLeftCoordinates();
+		const FPoint2D Size = ItemDefinition.GetSize(Slot.IsRotated());
+
+		if (bIsRotationValid && Occupancy.IsFree(TopLeft, Size))
+		{
+			Occupancy.Occupy(TopLeft, Size);
+			ValidSlots.Add(MoveTemp(Slot));
+		}
+		else
+		{
+			Report.NumMisplacedSlots++;
+			DisplacedSlots.Add(MoveTemp(Slot));
+		}
+	}
+
+	// placed after every slot that still fits, in the order the inventory would add them
+	for (FSavedSlot& Slot: DisplacedSlots)
+	{
+		const FItemDefinition& ItemDefinition = AssetManager.GetItemDefinition(Slot.ItemId);
+
+		FPoint2D TopLeft;
+		bool bIsRotated = false;
+
+		if (!Occupancy.FindFree(ItemDefinition.GetSize(false), TopLeft))
+		{
+			bIsRotated = ItemDefinition.bCanBeRotated && Occupancy.FindFree(ItemDefinition.GetSize(true), TopLeft);
+
+			if (!bIsRotated)
+			{
+				Report.NumLostSlots++;
+				Report.LostQuantity += Slot.Quantity;
+				continue;
+			}
+		}
+
+		Occupancy.Occupy(TopLeft, ItemDefinition.GetSize(bIsRotated));
+
+		Slot.SetPlacement(TopLeft, bIsRotated);
+		ValidSlots.Add(MoveTemp(Slot));
+	}
+
+	SaveData.Slots = MoveTemp(ValidSlots);
+
+	for (int32 I = SaveData.EquipmentSlots.Num() - 1; I >= 0; I--)
+	{
+		FSavedSlot& Slot = SaveData.EquipmentSlots[I].Slot;
+		const FItemDefinition& ItemDefinition = AssetManager.GetItemDefinition(Slot.ItemId);
+
+		if (!ItemDefinition.bIsBaked)
+		{
+			Report.NumDanglingItems++;
+			Report.NumLostSlots++;
+			Report.LostQuantity += Slot.Quantity;
+
+			SaveData.EquipmentSlots.RemoveAt(I);
+			continue;
+		}
+
+		// equipment slots hold a single stack
+		if (Slot.Quantity > ItemDefinition.GetMaxSlotQuantity())
+		{
+			Report.NumOverfullStacks++;
+			Report.LostQuantity += Slot.Quantity - ItemDefinition.GetMaxSlotQuantity();
+
+			Slot.Quantity = ItemDefinition.GetMaxSlotQuantity();
+		}
+	}
+}
+
+static void ValidateInventoryFile(const FString& Filename, const bool bRepair, FInventoryFileReport& Report)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *Filename, FILEREAD_Silent))
+	{
+		return;
+	}
+
+	Report.NumBytes = FileData.Num();
+
+	uint32 HeaderMagic = 0;
+	int32 CompressedSize = 0;
+
+	// magic, uncompressed size then compressed size, see FInventorySaveData::SaveToCompressedBytes
+	if (FileData.Num() >= 12)
+	{
+		FMemory::Memcpy(&HeaderMagic, FileData.GetData(), sizeof(uint32));
+		FMemory::Memcpy(&CompressedSize, FileData.GetData() + 8, sizeof(int32));
+	}
+
+	Report.bIsInventory = HeaderMagic == FInventorySaveData::FileMagic;
+
+	FInventorySaveData SaveData;
+	if (!Report.bIsInventory || !SaveData.LoadFromCompressedBytes(FileData))
+	{
+		return;
+	}
+
+	Report.bIsReadable = true;
+	Report.NumSlots = SaveData.Slots.Num() + SaveData.RemovedSlots.Num();
+
+	// slots of removed items are already dropped by loading when the item registry changed
+	for (const FSavedSlot& Slot: SaveData.RemovedSlots)
+	{
+		Report.NumDanglingItems++;
+		Report.NumLostSlots++;
+		Report.LostQuantity += Slot.Quantity;
+	}
+
+	ValidateSaveData(SaveData, Report);
+
+	TArray<uint8> ValidatedData;
+	Report.bNeedsWrite = !SaveData.SaveToCompressedBytes(ValidatedData, CompressedSize != 0) || ValidatedData != FileData;
+
+	if (bRepair && Report.bNeedsWrite)
+	{
+		Report.bIsWritten = SaveData.SaveToFile(Filename, CompressedSize != 0);
+	}
+}
+
+UInventoryValidationCommandlet::UInventoryValidationCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UInventoryValidationCommandlet::Main(const FString& Params)
+{
+	FString Directory = FPaths::ProjectSavedDir() / TEXT("Inventories");
+	FParse::Value(*Params, TEXT("Directory="), Directory);
+
+	const bool bRepair = FParse::Param(*Params, TEXT("Repair"));
+
+	UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	// definitions are baked when the items load, the workers then only read the definition table
+	for (int32 ItemId = 1; ItemId <= AssetManager.GetNumRegisteredItems(); ItemId++)
+	{
+		AssetManager.ForceLoadItem(AssetManager.GetItemPrimaryAssetId(static_cast<FItemId>(ItemId)));
+	}
+
+	TArray<FString> Filenames;
+	IFileManager::Get().FindFilesRecursive(Filenames, *Directory, TEXT("*"), true, false);
+
+	// leftovers of interrupted saves
+	Filenames.RemoveAll([](const FString& Filename) { return Filename.EndsWith(TEXT(".tmp")); });
+
+	TArray<FInventoryFileReport> Reports;
+	Reports.SetNum(Filenames.Num());
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// each task reads, validates and writes a single file, only the files being processed are held in memory
+	ParallelFor(Filenames.Num(), [&Filenames, &Reports, bRepair](const int32 I)
+	{
+		ValidateInventoryFile(Filenames[I], bRepair, Reports[I]);
+	});
+
+	const double ElapsedSeconds = FMath::Max(FPlatformTime::Seconds() - StartTime, 0.000001);
+
+	int32 NumInventories = 0;
+	int32 NumUnreadable = 0;
+	int32 NumInvalid = 0;
+	int32 NumOutdated = 0;
+	int32 NumWritten = 0;
+	int64 NumBytes = 0;
+	int64 NumSlots = 0;
+
+	for (int32 I = 0; I < Filenames.Num(); I++)
+	{
+		const FInventoryFileReport& Report = Reports[I];
+		if (!Report.bIsInventory)
+		{
+			continue;
+		}
+
+		NumInventories++;
+		NumBytes += Report.NumBytes;
+		NumSlots += Report.NumSlots;
+		NumWritten += Report.bIsWritten ? 1 : 0;
+
+		if (!Report.bIsReadable)
+		{
+			NumUnreadable++;
+			UE_LOG(LogTemp, Error, TEXT("%s can't be read"), *Filenames[I]);
+			continue;
+		}
+
+		if (!Report.IsValid())
+		{
+			NumInvalid++;
+			UE_LOG(LogTemp, Warning, TEXT("%s: %d misplaced slots, %d stacks over their maximum, %d removed items, %d slots and %d items lost%s"),
+				*Filenames[I], Report.NumMisplacedSlots, Report.NumOverfullStacks, Report.NumDanglingItems, Report.NumLostSlots, Report.LostQuantity, Report.bIsWritten ? TEXT(", repaired") : TEXT(""));
+		}
+		else if (Report.bNeedsWrite)
+		{
+			NumOutdated++;
+		}
+
+		if (bRepair && Report.bNeedsWrite && !Report.bIsWritten)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to write back %s"), *Filenames[I]);
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Validated %d inventories (%lld slots, %.2f MB) in %.2f s, %.0f inventories/s, %.2f MB/s"),
+		NumInventories, NumSlots, NumBytes / (1024.0 * 1024.0), ElapsedSeconds, NumInventories / ElapsedSeconds, NumBytes / (1024.0 * 1024.0) / ElapsedSeconds);
+
+	UE_LOG(LogTemp, Display, TEXT("%d invalid, %d unreadable, %d saved with an older format or item registry, %d written back%s"),
+		NumInvalid, NumUnreadable, NumOutdated, NumWritten, bRepair ? TEXT("") : TEXT(", run with -Repair to fix them"));
+
+	return NumUnreadable > 0 || (!bRepair && NumInvalid > 0) ? 1 : 0;
+}
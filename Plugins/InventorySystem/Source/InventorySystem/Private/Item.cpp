@@ -3,7 +3,6 @@
 #include "Item.h"
 #include "Pickup.h"
 #include "ItemInstance.h"
-#include "AssetManager_Custom.h"
 
 UItem::UItem()
 {
@@ -25,6 +24,9 @@ UItem::UItem()
 	ConsumedQuantityPerUsage = 1;
 
 	PickupStaticMeshScale = FVector(0.25f);
+	LootPriority = 0;
+
+	CachedItemId = UAssetManager_Custom::InvalidItemId;
 }
 
 FPrimaryAssetId UItem::GetPrimaryAssetId() const
@@ -32,6 +34,79 @@ FPrimaryAssetId UItem::GetPrimaryAssetId() const
 	return FPrimaryAssetId(AssetType, GetFName());
 }
 
+void UItem::PostLoad()
+{
+#if WITH_EDITORONLY_DATA
+	MigrateImageResource();
+#endif
+
+	Super::PostLoad();
+
+	if (!HasAnyFlags(RF_ClassDefaultObject) && GEngine && GEngine->AssetManager)
+	{
+		UAssetManager_Custom::Get().UpdateItemDefinition(this);
+	}
+}
+
+#if WITH_EDITOR
+void UItem::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	if (GEngine && GEngine->AssetManager)
+	{
+		UAssetManager_Custom::Get().UpdateItemDefinition(this);
+	}
+}
+#endif
+
+#if WITH_EDITORONLY_DATA
+void UItem::PreSave(const ITargetPlatform* TargetPlatform)
+{
+	// the icon may have been assigned to the brush while playing in editor
+	MigrateImageResource();
+
+	Super::PreSave(TargetPlatform);
+}
+
+void UItem::MigrateImageResource()
+{
+	UObject* ResourceObject = Image.GetResourceObject();
+	if (ResourceObject == nullptr)
+	{
+		return;
+	}
+
+	if (ImageResource.IsNull())
+	{
+		ImageResource = ResourceObject;
+	}
+
+	Image.SetResourceObject(nullptr);
+}
+#endif
+
+bool UItem::UpdateImageResource()
+{
+	if (ImageResource.IsNull())
+	{
+		return true;
+	}
+
+	UObject* LoadedResource = ImageResource.Get();
+	if (LoadedResource == nullptr)
+	{
+		return false;
+	}
+
+	if (Image.GetResourceObject() != LoadedResource)
+	{
+		Image.SetResourceObject(LoadedResource);
+	}
+
+	return true;
+}
+
 FString UItem::GetIdentifierString() const
 {
 	return GetPrimaryAssetId().ToString();
@@ -42,6 +117,51 @@ FString UItem::GetAssetName() const
 	return GetPrimaryAssetId().PrimaryAssetName.ToString();
 }
 
+FItemId UItem::GetItemId() const
+{
+	if (CachedItemId != UAssetManager_Custom::InvalidItemId)
+	{
+		return CachedItemId;
+	}
+
+	return UAssetManager_Custom::Get().GetItemId(GetPrimaryAssetId());
+}
+
+FItemDefinition UItem::GetDefinition() const
+{
+	if (CachedItemId != UAssetManager_Custom::InvalidItemId)
+	{
+		return UAssetManager_Custom::GetItemDefinition(CachedItemId);
+	}
+
+	// before the initial asset scan or for items that aren't registered, such as another primary asset type
+	return BakeDefinition();
+}
+
+FItemDefinition UItem::BakeDefinition() const
+{
+	FItemDefinition Definition;
+
+	Definition.MaxStackSize = MaxStackSize;
+	Definition.Weight = bUseScaledWeight ? GetScaledWeight() : Weight;
+	Definition.SizeX = Size.X;
+	Definition.SizeY = Size.Y;
+	Definition.ConsumedQuantityPerUsage = ConsumedQuantityPerUsage;
+	Definition.LootPriority = LootPriority;
+	Definition.Type = Type;
+	Definition.PrimaryEquipmentSlot = PrimaryEquipmentSlot;
+	Definition.SecondaryEquipmentSlot = SecondaryEquipmentSlot;
+	Definition.bCanBeStacked = bCanBeStacked;
+	Definition.bCanBeRotated = CanBeRotated();
+	Definition.bCanBeDropped = bCanBeDropped;
+	Definition.bCanBeEquipped = bCanBeEquipped;
+	Definition.bCanBeConsumed = bCanBeConsumed;
+	Definition.bHasItemInstanceBehavior = UItemInstance::HasBlueprintBehavior(ItemInstanceClass);
+	Definition.bIsBaked = true;
+
+	return Definition;
+}
+
 TArray<FPoint2D> UItem::GetSizeInCells() const
 {
 	TArray<FPoint2D> SizeInCells;
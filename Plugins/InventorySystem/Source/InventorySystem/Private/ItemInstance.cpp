@@ -2,10 +2,12 @@
 
 #include "ItemInstance.h"
 #include "Item.h"
+#include "ItemInstanceSubsystem.h"
+#include "UObject/UObjectArray.h"
 
 UItemInstance::UItemInstance()
 {
-
+	bCanBeClustered = true;
 }
 
 void UItemInstance::NativeOnConstruct()
@@ -61,3 +63,96 @@ void UItemInstance::NotifyItemRotated()
 	OnRotated();
 	OnItemRotated.Broadcast();
 }
+
+
+void UItemInstance::SetInstanceData(const FItemInstanceData& InstanceData)
+{
+	// the cluster only knows the item the instance had when it was clustered, another item could be unloaded under it
+	const FUObjectItem* ObjectItem = GUObjectArray.ObjectToObjectItem(this);
+
+	if (InstanceData.Item != Item && ObjectItem && ObjectItem->GetOwnerIndex() != 0)
+	{
+		bCanBeClustered = false;
+
+		if (UItemInstanceSubsystem* ItemInstanceSubsystem = Cast<UItemInstanceSubsystem>(GetOuter()))
+		{
+			ItemInstanceSubsystem->RemoveFromItemInstanceCluster(this);
+		}
+	}
+
+	Item = InstanceData.Item;
+	TopLeftCoordinates = InstanceData.TopLeftCoordinates;
+	Size = InstanceData.Size;
+	bIsRotated = InstanceData.bIsRotated;
+	SizeInCells = InstanceData.GetSizeInCells();
+}
+
+void UItemInstance::OnReleasedToPool()
+{
+	const UItemInstance* DefaultItemInstance = GetClass()->GetDefaultObject<UItemInstance>();
+
+	// variables of subclasses, blueprint ones included, would otherwise show up on the next slot reusing the instance
+	for (TFieldIterator<FProperty> It(GetClass()); It; ++It)
+	{
+		const bool bIsSubclassProperty = It->GetOwnerClass() != UItemInstance::StaticClass();
+
+		// instanced subobjects belong to the default object, they can't be shared with it
+		if (bIsSubclassProperty && !It->HasAnyPropertyFlags(CPF_InstancedReference | CPF_ContainsInstancedReference))
+		{
+			It->CopyCompleteValue_InContainer(this, DefaultItemInstance);
+		}
+	}
+
+	OnReset();
+
+	// the item of a pooled instance is the one of its class, NativeOnConstruct reads it when reused
+	Item = DefaultItemInstance->Item;
+
+	TopLeftCoordinates = FPoint2D();
+	Size = FPoint2D();
+	bIsRotated = false;
+	SizeInCells.Reset();
+	OwnerInventory = nullptr;
+
+	OnItemRotated.Clear();
+}
+
+void UItemInstance::SerializeCustomData(FArchive& Ar)
+{
+
+}
+
+bool UItemInstance::CanBeInCluster() const
+{
+	return bCanBeClustered && Super::CanBeInCluster();
+}
+
+bool UItemInstance::HasBlueprintBehavior(const UClass* ItemInstanceClass)
+{
+	if (ItemInstanceClass == nullptr)
+	{
+		return false;
+	}
+
+	return ItemInstanceClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UItemInstance, OnConstruct))
+		|| ItemInstanceClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UItemInstance, OnUsed))
+		|| ItemInstanceClass->IsFunctionImplementedInScript(GET_FUNCTION_NAME_CHECKED(UItemInstance, OnRotated));
+}
+
+bool UItemInstance::HasBlueprintState(const UClass* ItemInstanceClass)
+{
+	if (ItemInstanceClass == nullptr)
+	{
+		return false;
+	}
+
+	for (TFieldIterator<FProperty> It(ItemInstanceClass); It; ++It)
+	{
+		if (!It->GetOwnerClass()->HasAnyClassFlags(CLASS_Native))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ItemInstanceSubsystem.h"
+#include "InventoryStats.h"
+#include "ItemInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectArray.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Instances Created"), STAT_ItemInstancesCreated, STATGROUP_Inventory);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Instances Reused"), STAT_ItemInstancesReused, STATGROUP_Inventory);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Instances Released"), STAT_ItemInstancesReleased, STATGROUP_Inventory);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Item Instances"), STAT_PooledItemInstances, STATGROUP_Inventory);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Clustered Item Instances"), STAT_ClusteredItemInstances, STATGROUP_Inventory);
+
+#if !UE_BUILD_SHIPPING
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkItemInstanceGCCommand(
+	TEXT("Inventory.BenchmarkItemInstanceGC"),
+	TEXT("Times garbage collections against the number of live item instances. Usage: Inventory.BenchmarkItemInstanceGC <ItemInstanceClassName> [MaxCount=16384] [NumPasses=5]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UItemInstanceSubsystem* ItemInstanceSubsystem = World ? World->GetSubsystem<UItemInstanceSubsystem>() : nullptr;
+		if (ItemInstanceSubsystem == nullptr || Args.Num() == 0)
+		{
+			return;
+		}
+
+		UClass* ItemInstanceClass = FindObject<UClass>(ANY_PACKAGE, *Args[0]);
+		const int32 MaxCount = Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 16384;
+		const int32 NumPasses = Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : 5;
+
+		ItemInstanceSubsystem->BenchmarkGarbageCollection(ItemInstanceClass, MaxCount, NumPasses);
+	}));
+#endif
+
+
+UItemInstanceSubsystem::UItemInstanceSubsystem()
+{
+	bUseItemInstancePool = true;
+	MaxPooledItemInstancesPerClass = 128;
+	bClusterItemInstances = false;
+}
+
+void UItemInstanceSubsystem::Deinitialize()
+{
+	for (const TPair<UClass*, FItemInstancePool>& Pool: Pools)
+	{
+		DEC_DWORD_STAT_BY(STAT_PooledItemInstances, Pool.Value.AvailableItemInstances.Num());
+	}
+
+	Pools.Empty();
+
+	DEC_DWORD_STAT_BY(STAT_ClusteredItemInstances, ClusteredItemInstances.Num());
+	ClusteredItemInstances.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UItemInstanceSubsystem::CanBeClusterRoot() const
+{
+	return IsClusteringItemInstances();
+}
+
+UItemInstance* UItemInstanceSubsystem::AcquireItemInstance(const TSubclassOf<UItemInstance> ItemInstanceClass)
+{
+	if (!ItemInstanceClass)
+	{
+		return nullptr;
+	}
+
+	FItemInstancePool* Pool = Pools.Find(ItemInstanceClass);
+
+	while (Pool && Pool->AvailableItemInstances.Num() > 0)
+	{
+		UItemInstance* PooledItemInstance = Pool->AvailableItemInstances.Pop(false);
+		DEC_DWORD_STAT(STAT_PooledItemInstances);
+
+		// pooled instances can still be marked pending kill by gameplay code
+		if (IsValid(PooledItemInstance))
+		{
+			INC_DWORD_STAT(STAT_ItemInstancesReused);
+			return PooledItemInstance;
+		}
+	}
+
+	return NewItemInstance(ItemInstanceClass);
+}
+
+void UItemInstanceSubsystem::ReleaseItemInstance(UItemInstance* ItemInstance)
+{
+	if (!IsValid(ItemInstance))
+	{
+		return;
+	}
+
+	ItemInstance->OnReleasedToPool();
+	INC_DWORD_STAT(STAT_ItemInstancesReleased);
+
+	if (!bUseItemInstancePool)
+	{
+		return;
+	}
+
+	FItemInstancePool& Pool = Pools.FindOrAdd(ItemInstance->GetClass());
+
+	// a clustered instance can't be collected on its own, dropping it would only leak it until the world is destroyed
+	const FUObjectItem* ObjectItem = GUObjectArray.ObjectToObjectItem(ItemInstance);
+	const bool bIsClustered = ObjectItem && ObjectItem->GetOwnerIndex() != 0;
+
+	if (Pool.AvailableItemInstances.Num() >= MaxPooledItemInstancesPerClass && !bIsClustered)
+	{
+		return;
+	}
+
+	Pool.AvailableItemInstances.Add(ItemInstance);
+	INC_DWORD_STAT(STAT_PooledItemInstances);
+}
+
+void UItemInstanceSubsystem::PrewarmPool(const TSubclassOf<UItemInstance> ItemInstanceClass, const int32 Count)
+{
+	if (!ItemInstanceClass || !bUseItemInstancePool)
+	{
+		return;
+	}
+
+	FItemInstancePool& Pool = Pools.FindOrAdd(ItemInstanceClass);
+	const int32 TargetCount = FMath::Min(Count, MaxPooledItemInstancesPerClass);
+
+	while (Pool.AvailableItemInstances.Num() < TargetCount)
+	{
+		Pool.AvailableItemInstances.Add(NewItemInstance(ItemInstanceClass));
+		INC_DWORD_STAT(STAT_PooledItemInstances);
+	}
+}
+
+int32 UItemInstanceSubsystem::GetNumPooledItemInstances(const TSubclassOf<UItemInstance> ItemInstanceClass) const
+{
+	const FItemInstancePool* Pool = Pools.Find(ItemInstanceClass);
+	return Pool ? Pool->AvailableItemInstances.Num() : 0;
+}
+
+UItemInstance* UItemInstanceSubsystem::NewItemInstance(const TSubclassOf<UItemInstance> ItemInstanceClass)
+{
+	INC_DWORD_STAT(STAT_ItemInstancesCreated);
+
+	// outered to the subsystem so a pooled instance can move between inventories of the same world
+	UItemInstance* ItemInstance = NewObject<UItemInstance>(this, ItemInstanceClass);
+
+	// an instance class shared by several items changes its item with every slot, the cluster wouldn't follow it
+	if (IsClusteringItemInstances() && ItemInstance->Item != nullptr)
+	{
+		AddToItemInstanceCluster(ItemInstance);
+	}
+
+	return ItemInstance;
+}
+
+void UItemInstanceSubsystem::AddToItemInstanceCluster(UItemInstance* ItemInstance)
+{
+	ClusteredItemInstances.Add(ItemInstance);
+	INC_DWORD_STAT(STAT_ClusteredItemInstances);
+
+	const FUObjectItem* RootItem = GUObjectArray.ObjectToObjectItem(this);
+
+	if (RootItem && RootItem->HasAnyFlags(EInternalObjectFlags::ClusterRoot))
+	{
+		ItemInstance->AddToCluster(this);
+	}
+	else
+	{
+		// the cluster is made of the objects referenced by the subsystem, there is none to create it from before the first instance
+		CreateCluster();
+	}
+}
+
+void UItemInstanceSubsystem::RemoveFromItemInstanceCluster(UItemInstance* ItemInstance)
+{
+	if (ClusteredItemInstances.Remove(ItemInstance) == 0)
+	{
+		return;
+	}
+
+	DEC_DWORD_STAT(STAT_ClusteredItemInstances);
+
+	// a single object can't leave a cluster, the instance no longer accepts being clustered when it is created again
+	GUObjectClusters.DissolveCluster(this);
+
+	if (ClusteredItemInstances.Num() > 0)
+	{
+		CreateCluster();
+	}
+}
+
+bool UItemInstanceSubsystem::IsClusteringItemInstances() const
+{
+	// released instances must stay pooled to be clustered
+	if (!bUseItemInstancePool || !bClusterItemInstances)
+	{
+		return false;
+	}
+
+	static const IConsoleVariable* CreateGCClustersVariable = IConsoleManager::Get().FindConsoleVariable(TEXT("gc.CreateGCClusters"));
+	return CreateGCClustersVariable == nullptr || CreateGCClustersVariable->GetInt() != 0;
+}
+
+void UItemInstanceSubsystem::BenchmarkGarbageCollection(const TSubclassOf<UItemInstance> ItemInstanceClass, const int32 MaxCount, const int32 NumPasses)
+{
+	if (!ItemInstanceClass || ItemInstanceClass->HasAnyClassFlags(CLASS_Abstract) || MaxCount <= 0 || NumPasses <= 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Item instance garbage collection benchmark needs a non abstract item instance class, a count and a number of passes"));
+		return;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Item instance garbage collection benchmark with %s, clustering %s"), *ItemInstanceClass->GetName(), IsClusteringItemInstances() ? TEXT("enabled") : TEXT("disabled"));
+
+	int32 Count = FMath::Min(256, MaxCount);
+
+	while (true)
+	{
+		while (BenchmarkItemInstances.Num() < Count)
+		{
+			BenchmarkItemInstances.Add(AcquireItemInstance(ItemInstanceClass));
+		}
+
+		// purges whatever was unreachable before timing, the timed passes only mark and sweep the live instances
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		for (int32 Pass = 0; Pass < NumPasses; Pass++)
+		{
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		}
+
+		const double AverageTimeMs = (FPlatformTime::Seconds() - StartTime) * 1000.0 / NumPasses;
+		UE_LOG(LogTemp, Log, TEXT("%6d item instances: %.3f ms per collection"), Count, AverageTimeMs);
+
+		if (Count >= MaxCount)
+		{
+			break;
+		}
+
+		Count = FMath::Min(Count * 2, MaxCount);
+	}
+
+	for (UItemInstance* ItemInstance: BenchmarkItemInstances)
+	{
+		ReleaseItemInstance(ItemInstance);
+	}
+
+	BenchmarkItemInstances.Reset();
+}
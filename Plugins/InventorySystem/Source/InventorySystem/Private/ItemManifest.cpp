@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ItemManifest.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+const uint32 FItemManifest::Magic = 0x464D5449;
+const int32 FItemManifest::Version = 2;
+
+static void SerializeSoftObjectPath(FArchive& Ar, FSoftObjectPath& Path)
+{
+	FString PathString = Path.ToString();
+	Ar << PathString;
+
+	if (Ar.IsLoading())
+	{
+		Path.SetPath(PathString);
+	}
+}
+
+static void SerializeItemDefinition(FArchive& Ar, FItemDefinition& Definition)
+{
+	Ar << Definition.MaxStackSize;
+	Ar << Definition.Weight;
+	Ar << Definition.SizeX;
+	Ar << Definition.SizeY;
+	Ar << Definition.ConsumedQuantityPerUsage;
+	Ar << Definition.LootPriority;
+	Ar << Definition.Type;
+	Ar << Definition.PrimaryEquipmentSlot;
+	Ar << Definition.SecondaryEquipmentSlot;
+
+	uint8 Flags = 0;
+
+	if (Ar.IsSaving())
+	{
+		Flags |= Definition.bCanBeStacked ? 1 << 0 : 0;
+		Flags |= Definition.bCanBeRotated ? 1 << 1 : 0;
+		Flags |= Definition.bCanBeDropped ? 1 << 2 : 0;
+		Flags |= Definition.bCanBeEquipped ? 1 << 3 : 0;
+		Flags |= Definition.bCanBeConsumed ? 1 << 4 : 0;
+		Flags |= Definition.bHasItemInstanceBehavior ? 1 << 5 : 0;
+	}
+
+	Ar << Flags;
+
+	if (Ar.IsLoading())
+	{
+		Definition.bCanBeStacked = (Flags & (1 << 0)) != 0;
+		Definition.bCanBeRotated = (Flags & (1 << 1)) != 0;
+		Definition.bCanBeDropped = (Flags & (1 << 2)) != 0;
+		Definition.bCanBeEquipped = (Flags & (1 << 3)) != 0;
+		Definition.bCanBeConsumed = (Flags & (1 << 4)) != 0;
+		Definition.bHasItemInstanceBehavior = (Flags & (1 << 5)) != 0;
+		Definition.bIsBaked = true;
+	}
+}
+
+void FItemManifest::Serialize(FArchive& Ar)
+{
+	uint32 FileMagic = Magic;
+	int32 FileVersion = Version;
+
+	Ar << FileMagic;
+	Ar << FileVersion;
+
+	if (Ar.IsLoading() && (FileMagic != Magic || FileVersion != Version))
+	{
+		Ar.SetError();
+		return;
+	}
+
+	Ar << RegistryHash;
+
+	int32 NumItems = Items.Num();
+	Ar << NumItems;
+
+	if (Ar.IsLoading())
+	{
+		if (NumItems < 0 || NumItems > MAX_uint16)
+		{
+			Ar.SetError();
+			return;
+		}
+
+		Items.SetNum(NumItems);
+	}
+
+	for (FItemManifestEntry& Entry: Items)
+	{
+		Ar << Entry.AssetName;
+		SerializeSoftObjectPath(Ar, Entry.AssetPath);
+
+		int32 NumBundles = Entry.BundleData.Bundles.Num();
+		Ar << NumBundles;
+
+		if (Ar.IsLoading())
+		{
+			Entry.BundleData.Bundles.SetNum(FMath::Max(NumBundles, 0));
+		}
+
+		for (FAssetBundleEntry& Bundle: Entry.BundleData.Bundles)
+		{
+			Ar << Bundle.BundleName;
+
+			int32 NumBundleAssets = Bundle.BundleAssets.Num();
+			Ar << NumBundleAssets;
+
+			if (Ar.IsLoading())
+			{
+				Bundle.BundleAssets.SetNum(FMath::Max(NumBundleAssets, 0));
+			}
+
+			for (FSoftObjectPath& BundleAsset: Bundle.BundleAssets)
+			{
+				SerializeSoftObjectPath(Ar, BundleAsset);
+			}
+		}
+
+		SerializeItemDefinition(Ar, Entry.Definition);
+
+		if (Ar.IsError())
+		{
+			return;
+		}
+	}
+}
+
+bool FItemManifest::SaveToFile(const FString& Filename) const
+{
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	const_cast<FItemManifest*>(this)->Serialize(Writer);
+
+	return !Writer.IsError() && FFileHelper::SaveArrayToFile(Data, *Filename);
+}
+
+bool FItemManifest::LoadFromFile(const FString& Filename)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *Filename, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+	Serialize(Reader);
+
+	if (Reader.IsError())
+	{
+		Items.Empty();
+		RegistryHash = 0;
+		return false;
+	}
+
+	return true;
+}
+
+FString FItemManifest::GetDefaultFilename()
+{
+	return FPaths::ProjectContentDir() / TEXT("InventorySystem/ItemManifest.bin");
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "ItemManifestCommandlet.h"
+#include "AssetManager_Custom.h"
+#include "ItemManifest.h"
+#include "Item.h"
+
+UItemManifestCommandlet::UItemManifestCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UItemManifestCommandlet::Main(const FString& Params)
+{
+	FString Filename = FItemManifest::GetDefaultFilename();
+	FParse::Value(*Params, TEXT("Output="), Filename);
+
+	UAssetManager_Custom& AssetManager = UAssetManager_Custom::Get();
+
+	FItemManifest Manifest;
+	Manifest.RegistryHash = AssetManager.GetItemRegistryHash();
+
+	const int32 NumItems = AssetManager.GetNumRegisteredItems();
+	Manifest.Items.Reserve(NumItems);
+
+	// identifiers are dense, iterating them keeps the manifest in registry order
+	for (int32 ItemId = 1; ItemId <= NumItems; ItemId++)
+	{
+		const FPrimaryAssetId PrimaryAssetId = AssetManager.GetItemPrimaryAssetId(static_cast<FItemId>(ItemId));
+
+		const UItem* Item = AssetManager.ForceLoadItem(PrimaryAssetId);
+		if (Item == nullptr)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to write the item manifest, %s could not be loaded!"), *PrimaryAssetId.ToString());
+			return 1;
+		}
+
+		FItemManifestEntry Entry;
+		Entry.AssetName = PrimaryAssetId.PrimaryAssetName;
+		Entry.AssetPath = AssetManager.GetPrimaryAssetPath(PrimaryAssetId);
+		Entry.Definition = Item->BakeDefinition();
+		AssetManager.GetAssetBundleEntries(PrimaryAssetId, Entry.BundleData.Bundles);
+
+		Manifest.Items.Add(Entry);
+	}
+
+	if (!Manifest.SaveToFile(Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write the item manifest to %s!"), *Filename);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Wrote %d items to the item manifest %s, registry hash %08x"), Manifest.Items.Num(), *Filename, Manifest.RegistryHash);
+	return 0;
+}
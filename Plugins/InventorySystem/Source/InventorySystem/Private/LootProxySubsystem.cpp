@@ -0,0 +1,353 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LootProxySubsystem.h"
+#include "PickupSubsystem.h"
+#include "Pickup.h"
+#include "Item.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+
+ULootProxySubsystem::ULootProxySubsystem()
+{
+	bUseLootProxies = false;
+
+	ActivationRadius = 3000.0f;
+	DeactivationRadius = 3500.0f;
+	GridCellSize = 2000.0f;
+
+	UpdateInterval = 0.25f;
+	MaxActivationsPerUpdate = 32;
+
+	TimeSinceLastUpdate = 0.0f;
+}
+
+void ULootProxySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UPickupSubsystem* PickupSubsystem = Collection.InitializeDependency<UPickupSubsystem>();
+	check(PickupSubsystem != nullptr);
+
+	PickupReleasedHandle = PickupSubsystem->OnPickupReleased.AddUObject(this, &ThisClass::OnPickupReleased);
+}
+
+void ULootProxySubsystem::Deinitialize()
+{
+	if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+	{
+		PickupSubsystem->OnPickupReleased.Remove(PickupReleasedHandle);
+	}
+
+	Proxies.Empty();
+	FreeProxyIndices.Empty();
+	ActiveProxyIndices.Empty();
+	Grid.Empty();
+
+	Super::Deinitialize();
+}
+
+void ULootProxySubsystem::Tick(const float DeltaTime)
+{
+	TimeSinceLastUpdate += DeltaTime;
+
+	if (TimeSinceLastUpdate >= UpdateInterval)
+	{
+		TimeSinceLastUpdate = 0.0f;
+		UpdateProxies();
+	}
+}
+
+bool ULootProxySubsystem::IsTickable() const
+{
+	return GetNumLootProxies() > 0;
+}
+
+ETickableTickType ULootProxySubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* ULootProxySubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId ULootProxySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULootProxySubsystem, STATGROUP_Tickables);
+}
+
+bool ULootProxySubsystem::AddLoot(UItem* Item, const int32 Quantity, const FTransform& Transform)
+{
+	if (Item == nullptr || Quantity <= 0)
+	{
+		return false;
+	}
+
+	const UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>();
+	check(PickupSubsystem != nullptr);
+
+	int32 RemainingQuantity = Quantity;
+
+	// same merge rules as the pickup subsystem, applied to the records instead of the actors
+	const FItemDefinition& ItemDefinition = Item->GetDefinition();
+
+	if (PickupSubsystem->bMergeNearbyPickups && ItemDefinition.bCanBeStacked)
+	{
+		const int32 MaxMergedQuantity = ItemDefinition.MaxStackSize * PickupSubsystem->MaxMergedStacks;
+		const float MergeRadiusSquared = FMath::Square(PickupSubsystem->MergeRadius);
+
+		const FIntPoint MinCell = GetGridCell(Transform.GetLocation() - FVector(PickupSubsystem->MergeRadius));
+		const FIntPoint MaxCell = GetGridCell(Transform.GetLocation() + FVector(PickupSubsystem->MergeRadius));
+
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+			{
+				const TArray<int32>* CellProxies = Grid.Find(FIntPoint(X, Y));
+				if (CellProxies == nullptr)
+				{
+					continue;
+				}
+
+				for (const int32 ProxyIndex: *CellProxies)
+				{
+					FLootProxy& Proxy = Proxies[ProxyIndex];
+
+					// the record of an active proxy is only synced when it is deactivated, its pickup holds the live quantity
+					const int32 ProxyQuantity = Proxy.IsActive() ? Proxy.ActivePickup->Quantity : Proxy.Quantity;
+
+					const bool bCanMerge = Proxy.Item == Item && ProxyQuantity < MaxMergedQuantity && FVector::DistSquared(Proxy.Transform.GetLocation(), Transform.GetLocation()) <= MergeRadiusSquared;
+					if (bCanMerge)
+					{
+						const int32 MergedQuantity = FMath::Min(MaxMergedQuantity - ProxyQuantity, RemainingQuantity);
+
+						Proxy.Quantity = ProxyQuantity + MergedQuantity;
+						RemainingQuantity -= MergedQuantity;
+
+						if (Proxy.IsActive())
+						{
+							Proxy.ActivePickup->SetPickupData(Proxy.Item, Proxy.Quantity);
+						}
+
+						if (RemainingQuantity <= 0)
+						{
+							return true;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	FLootProxy NewProxy;
+	NewProxy.Item = Item;
+	NewProxy.Quantity = RemainingQuantity;
+	NewProxy.Transform = Transform;
+
+	int32 ProxyIndex;
+	if (FreeProxyIndices.Num() > 0)
+	{
+		ProxyIndex = FreeProxyIndices.Pop(false);
+		Proxies[ProxyIndex] = NewProxy;
+	}
+	else
+	{
+		ProxyIndex = Proxies.Add(NewProxy);
+	}
+
+	AddProxyToGrid(ProxyIndex);
+
+	// loot dropped right next to a player should show up on the next frame, without updating once per added record
+	TimeSinceLastUpdate = UpdateInterval;
+
+	return true;
+}
+
+int32 ULootProxySubsystem::GetNumLootProxies() const
+{
+	return Proxies.Num() - FreeProxyIndices.Num();
+}
+
+int32 ULootProxySubsystem::GetNumActiveLootProxies() const
+{
+	return ActiveProxyIndices.Num();
+}
+
+void ULootProxySubsystem::UpdateProxies()
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return;
+	}
+
+	TArray<FVector> PlayerLocations;
+
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->GetPawn())
+		{
+			PlayerLocations.Add(PlayerController->GetPawn()->GetActorLocation());
+		}
+	}
+
+	const float DeactivationRadiusSquared = FMath::Square(DeactivationRadius);
+
+	for (int32 I = ActiveProxyIndices.Num() - 1; I >= 0; I--)
+	{
+		const int32 ProxyIndex = ActiveProxyIndices[I];
+		const FLootProxy& Proxy = Proxies[ProxyIndex];
+
+		// the pickup was destroyed by something else than the pool
+		if (!IsValid(Proxy.ActivePickup) || Proxy.ActivePickup->bIsPooled)
+		{
+			RemoveProxy(ProxyIndex);
+			continue;
+		}
+
+		const FVector PickupLocation = Proxy.ActivePickup->GetActorLocation();
+		bool bIsNearPlayer = false;
+
+		for (const FVector& PlayerLocation: PlayerLocations)
+		{
+			if (FVector::DistSquared(PlayerLocation, PickupLocation) <= DeactivationRadiusSquared)
+			{
+				bIsNearPlayer = true;
+				break;
+			}
+		}
+
+		if (!bIsNearPlayer)
+		{
+			DeactivateProxy(ProxyIndex);
+		}
+	}
+
+	const float ActivationRadiusSquared = FMath::Square(ActivationRadius);
+	int32 NumActivations = 0;
+
+	for (const FVector& PlayerLocation: PlayerLocations)
+	{
+		const FIntPoint MinCell = GetGridCell(PlayerLocation - FVector(ActivationRadius));
+		const FIntPoint MaxCell = GetGridCell(PlayerLocation + FVector(ActivationRadius));
+
+		for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+			{
+				const TArray<int32>* CellProxies = Grid.Find(FIntPoint(X, Y));
+				if (CellProxies == nullptr)
+				{
+					continue;
+				}
+
+				for (const int32 ProxyIndex: *CellProxies)
+				{
+					const FLootProxy& Proxy = Proxies[ProxyIndex];
+
+					if (Proxy.IsValid() && !Proxy.IsActive() && FVector::DistSquared(Proxy.Transform.GetLocation(), PlayerLocation) <= ActivationRadiusSquared)
+					{
+						ActivateProxy(ProxyIndex);
+
+						if (++NumActivations >= MaxActivationsPerUpdate)
+						{
+							return;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void ULootProxySubsystem::ActivateProxy(const int32 ProxyIndex)
+{
+	FLootProxy& Proxy = Proxies[ProxyIndex];
+
+	UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>();
+	check(PickupSubsystem != nullptr);
+
+	APickup* Pickup = PickupSubsystem->AcquirePickup(Proxy.Item->PickupClass, Proxy.Transform, Proxy.Item, Proxy.Quantity);
+	if (Pickup == nullptr)
+	{
+		return;
+	}
+
+	Pickup->LootProxyIndex = ProxyIndex;
+	Proxy.ActivePickup = Pickup;
+	ActiveProxyIndices.Add(ProxyIndex);
+}
+
+void ULootProxySubsystem::DeactivateProxy(const int32 ProxyIndex)
+{
+	FLootProxy& Proxy = Proxies[ProxyIndex];
+	APickup* Pickup = Proxy.ActivePickup;
+
+	// the pickup may have been partially looted, merged into or moved by physics
+	Proxy.Quantity = Pickup->Quantity;
+	Proxy.Transform = Pickup->GetActorTransform();
+	Proxy.ActivePickup = nullptr;
+	ActiveProxyIndices.RemoveSwap(ProxyIndex);
+
+	Pickup->LootProxyIndex = INDEX_NONE;
+
+	UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>();
+	check(PickupSubsystem != nullptr);
+
+	PickupSubsystem->ReleasePickup(Pickup);
+
+	RemoveProxyFromGrid(ProxyIndex);
+	AddProxyToGrid(ProxyIndex);
+}
+
+void ULootProxySubsystem::RemoveProxy(const int32 ProxyIndex)
+{
+	RemoveProxyFromGrid(ProxyIndex);
+	ActiveProxyIndices.RemoveSwap(ProxyIndex);
+
+	Proxies[ProxyIndex] = FLootProxy();
+	FreeProxyIndices.Add(ProxyIndex);
+}
+
+void ULootProxySubsystem::AddProxyToGrid(const int32 ProxyIndex)
+{
+	FLootProxy& Proxy = Proxies[ProxyIndex];
+
+	Proxy.Cell = GetGridCell(Proxy.Transform.GetLocation());
+	Grid.FindOrAdd(Proxy.Cell).Add(ProxyIndex);
+}
+
+void ULootProxySubsystem::RemoveProxyFromGrid(const int32 ProxyIndex)
+{
+	const FLootProxy& Proxy = Proxies[ProxyIndex];
+
+	TArray<int32>* CellProxies = Grid.Find(Proxy.Cell);
+	if (CellProxies)
+	{
+		CellProxies->RemoveSwap(ProxyIndex);
+
+		if (CellProxies->Num() == 0)
+		{
+			Grid.Remove(Proxy.Cell);
+		}
+	}
+}
+
+void ULootProxySubsystem::OnPickupReleased(APickup* Pickup)
+{
+	// a proxied pickup released by gameplay (fully looted) means the loot is gone
+	if (Pickup->LootProxyIndex != INDEX_NONE && Proxies.IsValidIndex(Pickup->LootProxyIndex))
+	{
+		const int32 ProxyIndex = Pickup->LootProxyIndex;
+		Pickup->LootProxyIndex = INDEX_NONE;
+
+		RemoveProxy(ProxyIndex);
+	}
+}
+
+FIntPoint ULootProxySubsystem::GetGridCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / GridCellSize), FMath::FloorToInt(Location.Y / GridCellSize));
+}
@@ -1,8 +1,10 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Pickup.h"
-#include "ItemInstance.h"
 #include "Item.h"
+#include "PickupSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StaticMesh.h"
 
 APickup::APickup()
 {
@@ -21,26 +23,144 @@ APickup::APickup()
 	PickupMesh->SetCollisionResponseToAllChannels(ECR_Ignore);
 	PickupMesh->SetCollisionResponseToChannel(ECC_WorldStatic, ECR_Block);
 	PickupMesh->SetCollisionResponseToChannel(ECC_Visibility, ECR_Block);
+	PickupMesh->BodyInstance.bGenerateWakeEvents = true;
 
+	bIsPooled = false;
+	bWasSimulatingPhysics = true;
+
+	SpatialHashCell = FIntPoint::ZeroValue;
+	bIsInSpatialHash = false;
+
+	LootProxyIndex = INDEX_NONE;
 }
 
 void APickup::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	PickupMesh->OnComponentSleep.AddDynamic(this, &ThisClass::OnPickupMeshSleep);
+
+	if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+	{
+		PickupSubsystem->RegisterPickup(this);
+	}
+}
+
+void APickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (PickupMeshHandle.IsValid())
+	{
+		PickupMeshHandle->CancelHandle();
+		PickupMeshHandle.Reset();
+	}
+
+	if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+	{
+		PickupSubsystem->UnregisterPickup(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void APickup::OnPickupDataReceived()
+{
+	if (PickupMeshHandle.IsValid())
+	{
+		PickupMeshHandle->CancelHandle();
+		PickupMeshHandle.Reset();
+	}
+
+	if (Item == nullptr || Item->PickupStaticMesh.IsNull())
+	{
+		return;
+	}
+
+	UStaticMesh* LoadedMesh = Item->PickupStaticMesh.Get();
+	if (LoadedMesh)
+	{
+		PickupMesh->SetStaticMesh(LoadedMesh);
+		return;
+	}
+
+	// a pooled pickup must not keep showing the mesh of the item it represented before
+	PickupMesh->SetStaticMesh(nullptr);
+
+	PickupMeshHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Item->PickupStaticMesh.ToSoftObjectPath(), FStreamableDelegate::CreateUObject(this, &ThisClass::OnPickupMeshLoaded));
+}
+
+void APickup::OnPickupMeshLoaded()
+{
+	PickupMeshHandle.Reset();
+
+	if (bIsPooled || Item == nullptr)
+	{
+		return;
+	}
+
+	UStaticMesh* LoadedMesh = Item->PickupStaticMesh.Get();
+	if (LoadedMesh)
+	{
+		// the physics body is created along with the mesh, dedicated servers need it as well
+		PickupMesh->SetStaticMesh(LoadedMesh);
+	}
+}
+
+void APickup::OnAcquiredFromPool(const FTransform& Transform)
+{
+	bIsPooled = false;
+
+	SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(PrimaryActorTick.bStartWithTickEnabled);
+
+	PickupMesh->SetSimulatePhysics(bWasSimulatingPhysics);
+
+	if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+	{
+		PickupSubsystem->RegisterPickup(this);
+	}
+}
+
+void APickup::OnReleasedToPool()
+{
+	bIsPooled = true;
+	bWasSimulatingPhysics = PickupMesh->IsSimulatingPhysics();
+
+	PickupMesh->SetSimulatePhysics(false);
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+
+	Item = nullptr;
+	Quantity = 0;
+	LootProxyIndex = INDEX_NONE;
+
+	if (PickupMeshHandle.IsValid())
+	{
+		PickupMeshHandle->CancelHandle();
+		PickupMeshHandle.Reset();
+	}
+
+	if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+	{
+		PickupSubsystem->UnregisterPickup(this);
+	}
 }
 
-void APickup::OnPickupDataReceived() const
+void APickup::OnPickupMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName)
 {
-	if (ItemInstance->Item->PickupStaticMesh)
+	// pickups roll after being dropped, keep the spatial hash in sync once they come to rest
+	if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
 	{
-		PickupMesh->SetStaticMesh(ItemInstance->Item->PickupStaticMesh);
+		PickupSubsystem->RegisterPickup(this);
 	}
 }
 
-void APickup::SetPickupData(UItemInstance* InItemInstance, const int32 InQuantity)
+void APickup::SetPickupData(UItem* InItem, const int32 InQuantity)
 {
-	ItemInstance = InItemInstance;
+	Item = InItem;
 	Quantity = InQuantity;
 
 	OnPickupDataReceived();
@@ -0,0 +1,363 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PickupSubsystem.h"
+#include "Pickup.h"
+#include "Item.h"
+
+UPickupSubsystem::UPickupSubsystem()
+{
+	PrewarmCount = 8;
+	MaxPooledPickupsPerClass = 64;
+
+	bMergeNearbyPickups = true;
+	MergeRadius = 150.0f;
+	MaxMergedStacks = 10;
+	SpatialHashCellSize = 500.0f;
+
+	SpawnBudgetMs = 1.0f;
+}
+
+void UPickupSubsystem::Deinitialize()
+{
+	Pools.Empty();
+	SpatialHash.Empty();
+	PendingSpawns.Empty();
+	PendingPrewarmClasses.Empty();
+
+	Super::Deinitialize();
+}
+
+void UPickupSubsystem::Tick(const float DeltaTime)
+{
+	const double StartTime = FPlatformTime::Seconds();
+	const double Budget = SpawnBudgetMs / 1000.0;
+
+	int32 NumProcessedSpawns = 0;
+
+	while (NumProcessedSpawns < PendingSpawns.Num())
+	{
+		const FPendingPickupSpawn PendingSpawn = PendingSpawns[NumProcessedSpawns++];
+		SpawnPickup(PendingSpawn.Item, PendingSpawn.Quantity, PendingSpawn.Transform);
+
+		if (FPlatformTime::Seconds() - StartTime >= Budget)
+		{
+			break;
+		}
+	}
+
+	PendingSpawns.RemoveAt(0, NumProcessedSpawns, false);
+
+	while (PendingPrewarmClasses.Num() > 0 && FPlatformTime::Seconds() - StartTime < Budget)
+	{
+		UClass* PickupClass = PendingPrewarmClasses[0];
+		FPickupPool& Pool = Pools.FindOrAdd(PickupClass);
+
+		if (Pool.AvailablePickups.Num() >= FMath::Min(PrewarmCount, MaxPooledPickupsPerClass))
+		{
+			PendingPrewarmClasses.RemoveAt(0);
+			continue;
+		}
+
+		APickup* Pickup = SpawnPooledPickup(PickupClass);
+		if (Pickup == nullptr)
+		{
+			PendingPrewarmClasses.RemoveAt(0);
+			continue;
+		}
+
+		Pickup->OnReleasedToPool();
+		Pool.AvailablePickups.Add(Pickup);
+	}
+}
+
+bool UPickupSubsystem::IsTickable() const
+{
+	return PendingSpawns.Num() > 0 || PendingPrewarmClasses.Num() > 0;
+}
+
+ETickableTickType UPickupSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UPickupSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UPickupSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPickupSubsystem, STATGROUP_Tickables);
+}
+
+APickup* UPickupSubsystem::AcquirePickup(const TSubclassOf<APickup> PickupClass, const FTransform& Transform, UItem* Item, const int32 Quantity)
+{
+	if (!PickupClass)
+	{
+		return nullptr;
+	}
+
+	if (!Pools.Contains(PickupClass))
+	{
+		Pools.Add(PickupClass);
+		PendingPrewarmClasses.AddUnique(PickupClass);
+	}
+
+	FPickupPool& Pool = Pools.FindChecked(PickupClass);
+	APickup* Pickup = nullptr;
+
+	while (Pickup == nullptr && Pool.AvailablePickups.Num() > 0)
+	{
+		APickup* PooledPickup = Pool.AvailablePickups.Pop(false);
+
+		// pooled actors can still be destroyed by level streaming or gameplay code
+		if (IsValid(PooledPickup))
+		{
+			Pickup = PooledPickup;
+		}
+	}
+
+	if (Pickup == nullptr)
+	{
+		return SpawnPickupDeferred(PickupClass, Transform, Item, Quantity);
+	}
+
+	Pickup->OnAcquiredFromPool(Transform);
+	Pickup->SetPickupData(Item, Quantity);
+
+	return Pickup;
+}
+
+void UPickupSubsystem::ReleasePickup(APickup* Pickup)
+{
+	if (!IsValid(Pickup) || Pickup->bIsPooled)
+	{
+		return;
+	}
+
+	OnPickupReleased.Broadcast(Pickup);
+
+	FPickupPool& Pool = Pools.FindOrAdd(Pickup->GetClass());
+
+	if (Pool.AvailablePickups.Num() >= MaxPooledPickupsPerClass)
+	{
+		Pickup->Destroy();
+		return;
+	}
+
+	Pickup->OnReleasedToPool();
+	Pool.AvailablePickups.Add(Pickup);
+}
+
+void UPickupSubsystem::PrewarmPool(const TSubclassOf<APickup> PickupClass, const int32 Count)
+{
+	if (!PickupClass)
+	{
+		return;
+	}
+
+	FPickupPool& Pool = Pools.FindOrAdd(PickupClass);
+	const int32 TargetCount = FMath::Min(Count, MaxPooledPickupsPerClass);
+
+	while (Pool.AvailablePickups.Num() < TargetCount)
+	{
+		APickup* Pickup = SpawnPooledPickup(PickupClass);
+		if (Pickup == nullptr)
+		{
+			return;
+		}
+
+		Pickup->OnReleasedToPool();
+		Pool.AvailablePickups.Add(Pickup);
+	}
+}
+
+int32 UPickupSubsystem::GetNumPooledPickups(const TSubclassOf<APickup> PickupClass) const
+{
+	const FPickupPool* Pool = Pools.Find(PickupClass);
+	return Pool ? Pool->AvailablePickups.Num() : 0;
+}
+
+APickup* UPickupSubsystem::SpawnPickup(UItem* Item, const int32 Quantity, const FTransform& Transform)
+{
+	if (Item == nullptr || Quantity <= 0)
+	{
+		return nullptr;
+	}
+
+	int32 RemainingQuantity = Quantity;
+	APickup* LastPickup = nullptr;
+
+	// merging only makes sense for stackable items, other instances keep their own actor
+	const FItemDefinition& ItemDefinition = Item->GetDefinition();
+
+	if (bMergeNearbyPickups && ItemDefinition.bCanBeStacked)
+	{
+		const int32 MaxMergedQuantity = ItemDefinition.MaxStackSize * MaxMergedStacks;
+
+		TArray<APickup*> NearbyPickups;
+		GetPickupsInRadius(Transform.GetLocation(), MergeRadius, NearbyPickups);
+
+		for (APickup* NearbyPickup: NearbyPickups)
+		{
+			const bool bCanMerge = NearbyPickup->Item == Item && NearbyPickup->Quantity < MaxMergedQuantity;
+			if (bCanMerge)
+			{
+				const int32 MergedQuantity = FMath::Min(MaxMergedQuantity - NearbyPickup->Quantity, RemainingQuantity);
+
+				NearbyPickup->SetPickupData(NearbyPickup->Item, NearbyPickup->Quantity + MergedQuantity);
+				RemainingQuantity -= MergedQuantity;
+				LastPickup = NearbyPickup;
+
+				if (RemainingQuantity <= 0)
+				{
+					return LastPickup;
+				}
+			}
+		}
+	}
+
+	APickup* SpawnedPickup = AcquirePickup(Item->PickupClass, Transform, Item, RemainingQuantity);
+	return SpawnedPickup ? SpawnedPickup : LastPickup;
+}
+
+void UPickupSubsystem::QueuePickupSpawn(UItem* Item, const int32 Quantity, const FTransform& Transform)
+{
+	if (Item == nullptr || Quantity <= 0)
+	{
+		return;
+	}
+
+	FPendingPickupSpawn PendingSpawn;
+	PendingSpawn.Item = Item;
+	PendingSpawn.Quantity = Quantity;
+	PendingSpawn.Transform = Transform;
+
+	PendingSpawns.Add(PendingSpawn);
+}
+
+int32 UPickupSubsystem::GetNumPendingPickupSpawns() const
+{
+	return PendingSpawns.Num();
+}
+
+void UPickupSubsystem::GetPickupsInRadius(const FVector& Center, const float Radius, TArray<APickup*>& OutPickups) const
+{
+	OutPickups.Reset();
+
+	const FIntPoint MinCell = GetSpatialHashCell(Center - FVector(Radius));
+	const FIntPoint MaxCell = GetSpatialHashCell(Center + FVector(Radius));
+	const float RadiusSquared = FMath::Square(Radius);
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+		{
+			const TArray<TWeakObjectPtr<APickup>>* CellPickups = SpatialHash.Find(FIntPoint(X, Y));
+			if (CellPickups == nullptr)
+			{
+				continue;
+			}
+
+			for (const TWeakObjectPtr<APickup>& CellPickup: *CellPickups)
+			{
+				APickup* Pickup = CellPickup.Get();
+				if (Pickup && !Pickup->bIsPooled && FVector::DistSquared(Pickup->GetActorLocation(), Center) <= RadiusSquared)
+				{
+					OutPickups.Add(Pickup);
+				}
+			}
+		}
+	}
+}
+
+void UPickupSubsystem::RegisterPickup(APickup* Pickup)
+{
+	if (!IsValid(Pickup) || Pickup->bIsPooled)
+	{
+		return;
+	}
+
+	const FIntPoint Cell = GetSpatialHashCell(Pickup->GetActorLocation());
+
+	if (Pickup->bIsInSpatialHash)
+	{
+		if (Pickup->SpatialHashCell == Cell)
+		{
+			return;
+		}
+
+		UnregisterPickup(Pickup);
+	}
+
+	SpatialHash.FindOrAdd(Cell).Add(Pickup);
+	Pickup->SpatialHashCell = Cell;
+	Pickup->bIsInSpatialHash = true;
+}
+
+void UPickupSubsystem::UnregisterPickup(APickup* Pickup)
+{
+	if (Pickup == nullptr || !Pickup->bIsInSpatialHash)
+	{
+		return;
+	}
+
+	TArray<TWeakObjectPtr<APickup>>* CellPickups = SpatialHash.Find(Pickup->SpatialHashCell);
+	if (CellPickups)
+	{
+		CellPickups->RemoveSwap(Pickup);
+
+		if (CellPickups->Num() == 0)
+		{
+			SpatialHash.Remove(Pickup->SpatialHashCell);
+		}
+	}
+
+	Pickup->bIsInSpatialHash = false;
+}
+
+APickup* UPickupSubsystem::SpawnPooledPickup(const TSubclassOf<APickup> PickupClass) const
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	return World->SpawnActor<APickup>(PickupClass, FTransform::Identity, SpawnParams);
+}
+
+APickup* UPickupSubsystem::SpawnPickupDeferred(const TSubclassOf<APickup> PickupClass, const FTransform& Transform, UItem* Item, const int32 Quantity) const
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr)
+	{
+		return nullptr;
+	}
+
+	APickup* Pickup = World->SpawnActorDeferred<APickup>(PickupClass, Transform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (Pickup == nullptr)
+	{
+		return nullptr;
+	}
+
+	// the mesh is assigned before the components are registered, so they are only registered once
+	Pickup->Item = Item;
+	Pickup->Quantity = Quantity;
+	Pickup->OnPickupDataReceived();
+
+	Pickup->FinishSpawning(Transform);
+
+	// blueprint components only exist once the construction script ran
+	Pickup->K2_OnPickupDataReceived();
+
+	return Pickup;
+}
+
+FIntPoint UPickupSubsystem::GetSpatialHashCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / SpatialHashCellSize), FMath::FloorToInt(Location.Y / SpatialHashCellSize));
+}
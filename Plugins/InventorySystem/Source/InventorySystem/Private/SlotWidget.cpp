@@ -5,7 +5,8 @@
 #include "CellWidget.h"
 #include "DraggedSlotWidget.h"
 #include "GridWidget.h"
-#include "ItemInstance.h"
+#include "Item.h"
+#include "Engine/AssetManager.h"
 #include "Blueprint/DragDropOperation.h"
 #include "Blueprint/WidgetLayoutLibrary.h"
 #include "Components/GridSlot.h"
@@ -19,10 +20,56 @@ void USlotWidget::SetSlotData(const FSlot& InInventorySlot, UGridWidget* InParen
 {
 	InventorySlot = InInventorySlot;
 	ParentWidget = InParentWidget;
-	
+
+	RequestSlotImage();
 	OnSlotDataReceived();
 }
 
+void USlotWidget::OnSlotImageLoaded_Implementation()
+{
+	OnSlotDataReceived();
+}
+
+void USlotWidget::NativeDestruct()
+{
+	CancelSlotImageRequest();
+	Super::NativeDestruct();
+}
+
+void USlotWidget::RequestSlotImage()
+{
+	CancelSlotImageRequest();
+
+	UItem* Item = InventorySlot.GetItem();
+	if (Item == nullptr || Item->UpdateImageResource())
+	{
+		return;
+	}
+
+	SlotImageHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Item->ImageResource.ToSoftObjectPath(), FStreamableDelegate::CreateUObject(this, &ThisClass::OnSlotImageStreamed));
+}
+
+void USlotWidget::OnSlotImageStreamed()
+{
+	SlotImageHandle.Reset();
+
+	// the slot may have received another item while the icon was loading
+	UItem* Item = InventorySlot.GetItem();
+	if (Item && Item->UpdateImageResource())
+	{
+		OnSlotImageLoaded();
+	}
+}
+
+void USlotWidget::CancelSlotImageRequest()
+{
+	if (SlotImageHandle.IsValid())
+	{
+		SlotImageHandle->CancelHandle();
+		SlotImageHandle.Reset();
+	}
+}
+
 FReply USlotWidget::NativeOnMouseButtonDown(const FGeometry& InGeometry, const FPointerEvent& InMouseEvent)
 {
 	if (InMouseEvent.GetEffectingButton() == EKeys::LeftMouseButton)
@@ -93,6 +140,7 @@ void USlotWidget::NativeOnDragCancelled(const FDragDropEvent& InDragDropEvent, U
 
 	const UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
 	ParentWidget->Inventory->Slots.Add(DraggedSlotWidget->InventorySlot);
+	ParentWidget->Inventory->MarkSlotsChanged();
 
 	OnDragCompleted(true);
 }
@@ -127,6 +175,7 @@ void USlotWidget::NativeOnDragDetected(const FGeometry& InGeometry, const FPoint
 	DragDropOperation->Pivot = EDragPivot::TopLeft;
 
 	ParentWidget->Inventory->Slots.Remove(InventorySlot);
+	ParentWidget->Inventory->MarkSlotsChanged();
 	OutOperation = DragDropOperation;
 }
 
@@ -151,7 +200,7 @@ bool USlotWidget::NativeOnDrop(const FGeometry& InGeometry, const FDragDropEvent
 	const UDraggedSlotWidget* DraggedSlotWidget = Cast<UDraggedSlotWidget>(InOperation->DefaultDragVisual);
 	//ParentWidget->Inventory->Slots.Add(DraggedSlotWidget->InventorySlot);
 
-	ParentWidget->Inventory->StackItemStackOnSlot(DraggedSlotWidget->InventorySlot, InventorySlot.ItemInstance->TopLeftCoordinates, DraggedSlotWidget->InventorySlot.Quantity);
+	ParentWidget->Inventory->StackItemStackOnSlot(DraggedSlotWidget->InventorySlot, InventorySlot.Instance.TopLeftCoordinates, DraggedSlotWidget->InventorySlot.Quantity);
 
 	OnDragCompleted(false);
 	return true;
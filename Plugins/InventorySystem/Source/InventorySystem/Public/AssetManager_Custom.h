@@ -4,8 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "Engine/AssetManager.h"
+#include "ItemDefinition.h"
+#include "ItemManifest.h"
 #include "AssetManager_Custom.generated.h"
 
+class UItem;
+
+DECLARE_DELEGATE_OneParam(FOnItemsLoaded, const TArray<UItem*>& /* LoadedItems */);
+
 /**
  * UAssetManager_Custom
  */
@@ -19,9 +25,19 @@ public:
 	UAssetManager_Custom();
 	
 	static const FPrimaryAssetType InventoryItem;
+	static const FItemId InvalidItemId;
 
 	static UAssetManager_Custom& Get();
 	virtual void StartInitialLoading() override;
+	virtual void PostInitialAssetScan() override;
+	virtual void ScanPrimaryAssetTypesFromConfig() override;
+	virtual bool ShouldScanPrimaryAssetType(FPrimaryAssetTypeInfo& TypeInfo) const override;
+
+	/** True if the items were registered from the cooked item manifest instead of a directory scan */
+	bool IsUsingItemManifest() const
+	{
+		return bUseItemManifest;
+	}
 
 	/**
 	 * Synchronously loads an Item subclass, this can hitch but is useful when you cannot wait for an async load
@@ -30,5 +46,99 @@ public:
 	 * @param PrimaryAssetId The asset identifier to load
 	 * @param bLogWarning If true, this will log a warning if the item failed to load
 	 */
-	UAssetManager_Custom* ForceLoadItem(const FPrimaryAssetId& PrimaryAssetId, bool bLogWarning = true) const;
+	UItem* ForceLoadItem(const FPrimaryAssetId& PrimaryAssetId, bool bLogWarning = true) const;
+
+	/**
+	 * Asynchronously loads a set of items in a single streamable handle, the items stay loaded until UnloadPrimaryAssets is called
+	 * The delegate is called once every item is loaded, or right away if they already were
+	 *
+	 * @param ItemIds The items to load, identifiers that are not registered InventoryItem assets are skipped
+	 * @param Bundles Asset bundles to load along with the items, such as "UI" or "World"
+	 * @param OnItemsLoaded Called with the items that could be loaded
+	 * @param Priority Async loading priority of the request
+	 */
+	TSharedPtr<FStreamableHandle> LoadItems(const TArray<FPrimaryAssetId>& ItemIds, const TArray<FName>& Bundles, FOnItemsLoaded OnItemsLoaded, TAsyncLoadPriority Priority = FStreamableManager::DefaultAsyncLoadPriority);
+
+	/** Asynchronously loads every registered InventoryItem asset, see LoadItems */
+	TSharedPtr<FStreamableHandle> LoadAllItems(const TArray<FName>& Bundles, FOnItemsLoaded OnItemsLoaded, TAsyncLoadPriority Priority = FStreamableManager::DefaultAsyncLoadPriority);
+
+	/** Returns the compact identifier of an item, InvalidItemId if the item isn't registered */
+	FItemId GetItemId(const FPrimaryAssetId& PrimaryAssetId) const;
+
+	/** Returns the primary asset identifier of a compact item identifier, an invalid identifier if it isn't registered */
+	FPrimaryAssetId GetItemPrimaryAssetId(FItemId ItemId) const;
+
+	/** Returns the item of a compact item identifier if it is loaded, this never loads the item */
+	UItem* GetLoadedItem(FItemId ItemId) const;
+
+	/**
+	 * Registers an item that wasn't part of the initial asset scan, such as an item created in the editor
+	 * Identifiers assigned this way come after the scanned items and are only valid for the current session
+	 * Does nothing before the initial asset scan completed
+	 */
+	FItemId RegisterItem(const FPrimaryAssetId& PrimaryAssetId);
+
+	int32 GetNumRegisteredItems() const;
+
+	/** Bakes the hot fields of a loaded item into the definition table, registering the item first if needed, only called when an item loads or is edited */
+	void UpdateItemDefinition(const UItem* Item);
+
+	/**
+	 * Returns the baked definition of an item, identifiers that aren't registered return an empty definition
+	 * Static so hot paths index the table without going through the engine, the reference stays valid while other items are registered
+	 */
+	static const FItemDefinition& GetItemDefinition(const FItemId ItemId)
+	{
+		const int32 BlockIndex = ItemId / ItemDefinitionsPerBlock;
+		const int32 DefinitionIndex = ItemId % ItemDefinitionsPerBlock;
+
+		if (ItemDefinitionBlocks.IsValidIndex(BlockIndex) && ItemDefinitionBlocks[BlockIndex].IsValidIndex(DefinitionIndex))
+		{
+			return ItemDefinitionBlocks[BlockIndex][DefinitionIndex];
+		}
+
+		return EmptyItemDefinition;
+	}
+
+	/** Hash of the registered item order, two builds assign the same identifiers if their hashes match */
+	uint32 GetItemRegistryHash() const
+	{
+		return ItemRegistryHash;
+	}
+
+private:
+
+	/** Assigns identifiers to the scanned items, sorted by primary asset identifier so they don't depend on the scan order */
+	void BuildItemRegistry();
+
+	/** Registers the manifest items as primary assets, replacing the InventoryItem directory scan */
+	void RegisterManifestItems();
+
+	/** Appends the definition of a newly registered item, starting a new block when the last one is full */
+	static void AddItemDefinition();
+
+	/** Only loaded in cooked builds, emptied once the registry is built */
+	FItemManifest ItemManifest;
+
+	uint8 bUseItemManifest : 1;
+
+	/** Primary asset identifiers indexed by compact item identifier, index 0 is the invalid identifier */
+	TArray<FPrimaryAssetId> RegisteredItems;
+
+	TMap<FPrimaryAssetId, FItemId> ItemIds;
+
+	static const int32 ItemDefinitionsPerBlock = 256;
+
+	/**
+	 * Baked item definitions indexed by compact item identifier, in contiguous cache line aligned blocks
+	 * Blocks are allocated at full size and never grow, and the block array is reserved for every identifier, so registering never moves a definition
+	 */
+	static TArray<TArray<FItemDefinition, TAlignedHeapAllocator<PLATFORM_CACHE_LINE_SIZE>>> ItemDefinitionBlocks;
+
+	static const FItemDefinition EmptyItemDefinition;
+
+	uint32 ItemRegistryHash;
+
+	uint8 bIsItemRegistryBuilt : 1;
+	
 };
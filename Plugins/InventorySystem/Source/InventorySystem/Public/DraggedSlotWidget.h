@@ -9,6 +9,8 @@
 
 class UGridWidget;
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FDraggedSlotEvent);
+
 /**
  * UDraggedSlotWidget
  */
@@ -50,6 +52,10 @@ public:
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "DraggedSlot")
 	FSlateBrush InvalidPlacementColor;
+
+	/** Called when the dragged slot was rotated, the slot isn't in the inventory while it is dragged */
+	UPROPERTY(BlueprintAssignable)
+	FDraggedSlotEvent OnSlotRotated;
 	
 	UFUNCTION()
 	void OnRotateItem();
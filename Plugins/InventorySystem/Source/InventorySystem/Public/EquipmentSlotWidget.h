@@ -7,6 +7,8 @@
 #include "Blueprint/UserWidget.h"
 #include "EquipmentSlotWidget.generated.h"
 
+struct FStreamableHandle;
+
 /**
  * UEquipmentSlotWidget
  */
@@ -26,6 +28,12 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "EquipmentSlot")
 	void OnEquipmentSlotDataReceived();
 
+	/** Called once the item icon streamed in, by default this calls OnEquipmentSlotDataReceived again to refresh the slot */
+	UFUNCTION(BlueprintNativeEvent, Category = "EquipmentSlot")
+	void OnSlotImageLoaded();
+
+	virtual void NativeDestruct() override;
+
 	UFUNCTION(BlueprintImplementableEvent, BlueprintCallable, Category = "Slot")
 	void SetSlotColor(const FSlateBrush& NewColor);
 
@@ -36,6 +44,11 @@ public:
 
 	void NativeOnSlotLeftClick();
 	void NativeOnSlotRightClick();
+
+	/** Streams in the icon of the slot item if it isn't loaded yet */
+	void RequestSlotImage();
+	void OnSlotImageStreamed();
+	void CancelSlotImageRequest();
 	
 
 	UFUNCTION(BlueprintImplementableEvent, Category = "Slot")
@@ -65,5 +78,7 @@ public:
 
 	UPROPERTY(Transient, BlueprintReadOnly, Category = "EquipmentSlot")
 	uint8 bMouseWasDragging : 1;
+
+	TSharedPtr<FStreamableHandle> SlotImageHandle;
 	
 };
@@ -41,6 +41,9 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "Grid")
 	void OnCellWidgetCreated(UCellWidget* Widget);
 
+	UFUNCTION(BlueprintImplementableEvent, Category = "Grid")
+	void OnCellWidgetRemoved(UCellWidget* Widget);
+
 	UFUNCTION(BlueprintImplementableEvent, Category = "Grid")
 	void OnSlotWidgetCreated(USlotWidget* Widget);
 
@@ -71,5 +74,9 @@ public:
 	
 	UFUNCTION()
 	void OnInventoryWeightChanged();
+
+	/** Only the cells of the loaded regions of a stash get a widget */
+	UFUNCTION()
+	void OnStashRegionChanged();
 	
 };
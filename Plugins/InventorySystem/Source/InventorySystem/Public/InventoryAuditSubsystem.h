@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "InventoryComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InventoryAuditSubsystem.generated.h"
+
+class UItem;
+class UItemInstance;
+
+/**
+ * Inventory Violation Type
+ */
+UENUM(BlueprintType)
+enum class EInventoryViolationType : uint8
+{
+	None								UMETA(DisplayName = "None"),
+	DuplicatedItemInstance				UMETA(DisplayName = "DuplicatedItemInstance"),
+	OverlappingSlots					UMETA(DisplayName = "OverlappingSlots"),
+	OutOfBoundsSlot						UMETA(DisplayName = "OutOfBoundsSlot"),
+	OverfullStack						UMETA(DisplayName = "OverfullStack"),
+	Overweight							UMETA(DisplayName = "Overweight"),
+};
+
+/**
+ * Inventory Violation
+ */
+USTRUCT(BlueprintType)
+struct INVENTORYSYSTEM_API FInventoryViolation
+{
+	GENERATED_BODY()
+
+	FInventoryViolation()
+	{
+		Inventory = nullptr;
+		Type = EInventoryViolationType::None;
+		Item = nullptr;
+		Quantity = 0;
+	}
+
+	UPROPERTY(BlueprintReadOnly)
+	UInventoryComponent* Inventory;
+
+	UPROPERTY(BlueprintReadOnly)
+	EInventoryViolationType Type;
+
+	/** Item of the slot at fault, none for an overweight inventory */
+	UPROPERTY(BlueprintReadOnly)
+	UItem* Item;
+
+	UPROPERTY(BlueprintReadOnly)
+	FPoint2D Coordinates;
+
+	/** Quantity of the slot, or the current weight rounded up for an overweight inventory */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Quantity;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FInventoryAuditEvent, const TArray<FInventoryViolation>&, Violations);
+
+/**
+ * UInventoryAuditSubsystem
+ * Checks every inventory of the world for item instances held by several slots, overlapping or out of bounds slots, stacks over their maximum and overweight inventories
+ * Inventories are copied on the game thread within SnapshotBudgetMs per frame, then validated in parallel on the thread pool
+ * Hibernating inventories are skipped, only the loaded regions of stash backed inventories are checked
+ * Only slots with an item instance object can be found duplicated, inline slots have nothing to tell a copy from an equal stack
+ */
+UCLASS(Config = Game)
+class INVENTORYSYSTEM_API UInventoryAuditSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UInventoryAuditSubsystem();
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Starts auditing every inventory of the world, OnAuditCompleted is called once they were all checked, fails if an audit is running */
+	UFUNCTION(BlueprintCallable, Category = "InventoryAudit")
+	bool StartAudit();
+
+	UFUNCTION(BlueprintPure, Category = "InventoryAudit")
+	bool IsAuditRunning() const;
+
+
+	/** Seconds between the audits started by the server itself, 0 only audits on StartAudit */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0.0f, UIMin = 0.0f), Category = "InventoryAudit")
+	float AuditInterval;
+
+	/** Time in milliseconds spent each frame copying inventories, at least one inventory is copied per frame */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0.0f, UIMin = 0.0f), Category = "InventoryAudit")
+	float SnapshotBudgetMs;
+
+	/** Called on the game thread with the violations found, duplicated item instances are confirmed again first */
+	UPROPERTY(BlueprintAssignable)
+	FInventoryAuditEvent OnAuditCompleted;
+
+private:
+
+	/**
+	 * Audit Slot
+	 */
+	struct FAuditSlot
+	{
+		TWeakObjectPtr<UItem> Item;
+		TWeakObjectPtr<UItemInstance> ItemInstance;
+
+		FPoint2D TopLeftCoordinates;
+		FPoint2D Size;
+		int32 Quantity;
+		int32 MaxSlotQuantity;
+	};
+
+	/**
+	 * Inventory Audit Snapshot
+	 */
+	struct FInventoryAuditSnapshot
+	{
+		TWeakObjectPtr<UInventoryComponent> Inventory;
+
+		FPoint2D GridSize;
+		float CurrentWeight;
+		float MaxWeight;
+
+		/** Grid slots followed by the occupied equipment slots, which aren't placed in the grid */
+		TArray<FAuditSlot> Slots;
+		int32 NumGridSlots;
+	};
+
+	/**
+	 * Audit Violation
+	 */
+	struct FAuditViolation
+	{
+		EInventoryViolationType Type;
+		int32 SnapshotIndex;
+
+		/** INDEX_NONE for an overweight inventory */
+		int32 SlotIndex;
+	};
+
+	typedef TArray<FInventoryAuditSnapshot> FAuditSnapshots;
+
+	/** Copies the pending inventories until the snapshot budget is spent */
+	void SnapshotInventories();
+
+	/** Validates the snapshots on the thread pool */
+	void StartValidation();
+
+	/** Turns the violations into their blueprint form and calls OnAuditCompleted */
+	void ReportViolations(const TArray<FAuditViolation>& Violations);
+
+	static void ValidateSnapshot(const FInventoryAuditSnapshot& Snapshot, int32 SnapshotIndex, TArray<FAuditViolation>& OutViolations);
+
+	/** Item instances found in more than one slot, in any inventory, inline slots aren't checked */
+	static void FindDuplicatedItemInstances(const FAuditSnapshots& Snapshots, TArray<FAuditViolation>& OutViolations);
+
+	/** True if a slot of the inventory still holds the item instance */
+	static bool HoldsItemInstance(const UInventoryComponent* Inventory, const UItemInstance* ItemInstance);
+
+	TArray<TWeakObjectPtr<UInventoryComponent>> PendingInventories;
+
+	/** Shared with the validation task once every inventory was copied */
+	TSharedPtr<FAuditSnapshots, ESPMode::ThreadSafe> Snapshots;
+
+	TFuture<TArray<FAuditViolation>> Result;
+
+	float TimeSinceLastAudit;
+	double AuditStartTime;
+	int32 NumSkippedInventories;
+
+	uint8 bIsAuditRunning : 1;
+
+};
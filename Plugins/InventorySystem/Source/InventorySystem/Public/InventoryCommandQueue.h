@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+#include "Containers/Queue.h"
+
+class UInventoryComponent;
+class UItem;
+
+/**
+ * Inventory Command Type
+ */
+enum class EInventoryCommandType : uint8
+{
+	AddItem,
+	RemoveItem,
+	AddMoney,
+	RemoveMoney,
+};
+
+/**
+ * Inventory Command Result
+ */
+struct FInventoryCommandResult
+{
+	FInventoryCommandResult()
+	{
+		Quantity = 0;
+		bSucceeded = false;
+	}
+
+	/** Quantity of the item added or removed, or money added or removed */
+	int32 Quantity;
+
+	/** True if the whole quantity was added or removed */
+	uint8 bSucceeded : 1;
+};
+
+/**
+ * Inventory Command Queue
+ * Lets any thread add and remove items or money, the commands are applied in order on the game thread
+ * Producers never lock, the game thread drains the whole queue at once and each inventory notifies once per drain
+ */
+class INVENTORYSYSTEM_API FInventoryCommandQueue
+{
+public:
+
+	FInventoryCommandQueue();
+	~FInventoryCommandQueue();
+
+	/** Any thread, the inventory and item must stay referenced by the caller until the command is applied */
+	TFuture<FInventoryCommandResult> AddItem(UInventoryComponent* Inventory, UItem* Item, int32 Quantity);
+	TFuture<FInventoryCommandResult> RemoveItem(UInventoryComponent* Inventory, UItem* Item, int32 Quantity);
+	TFuture<FInventoryCommandResult> AddMoney(UInventoryComponent* Inventory, int32 Value);
+	TFuture<FInventoryCommandResult> RemoveMoney(UInventoryComponent* Inventory, int32 Value);
+
+	/** Game thread only, applies every queued command and fulfills their futures, returns the number of commands applied */
+	int32 ApplyCommands();
+
+	/** Game thread only, fails the queued commands, commands queued afterwards fail right away */
+	void Close();
+
+	/** Game thread only */
+	bool IsEmpty() const;
+
+private:
+
+	/**
+	 * Command
+	 */
+	struct FCommand
+	{
+		FCommand()
+		{
+			Type = EInventoryCommandType::AddItem;
+			Quantity = 0;
+		}
+
+		EInventoryCommandType Type;
+
+		TWeakObjectPtr<UInventoryComponent> Inventory;
+		TWeakObjectPtr<UItem> Item;
+		int32 Quantity;
+
+		TPromise<FInventoryCommandResult> Promise;
+	};
+
+	TFuture<FInventoryCommandResult> Enqueue(EInventoryCommandType Type, UInventoryComponent* Inventory, UItem* Item, int32 Quantity);
+
+	static FInventoryCommandResult ApplyCommand(UInventoryComponent* Inventory, const FCommand& Command);
+
+	TQueue<TUniquePtr<FCommand>, EQueueMode::Mpsc> Commands;
+
+	/** Producers between their closed check and their enqueue, closing waits for them so no command is left behind */
+	TAtomic<int32> NumEnqueuing;
+	TAtomic<bool> bIsClosed;
+
+};
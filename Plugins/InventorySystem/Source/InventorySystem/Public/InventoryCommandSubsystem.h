@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InventoryCommandSubsystem.generated.h"
+
+class FInventoryCommandQueue;
+
+/**
+ * UInventoryCommandSubsystem
+ * Owns the command queue through which worker threads change the inventories of the world
+ * Queued commands are applied once per frame, after the actors ticked, see FInventoryCommandQueue
+ */
+UCLASS()
+class INVENTORYSYSTEM_API UInventoryCommandSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Get the queue on the game thread and hand it to the workers, it stays valid as long as they hold it
+	 * Commands queued once the world is torn down fail right away
+	 */
+	TSharedRef<FInventoryCommandQueue, ESPMode::ThreadSafe> GetCommandQueue() const;
+
+private:
+
+	TSharedPtr<FInventoryCommandQueue, ESPMode::ThreadSafe> CommandQueue;
+
+};
@@ -4,11 +4,24 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "HAL/CriticalSection.h"
 #include "InventoryComponent.generated.h"
 
 class UItem;
 class UItemInstance;
 class UInventoryComponent;
+struct FStreamableHandle;
+struct FInventorySaveData;
+struct FSavedSlot;
+struct FInventoryPlacementSnapshot;
+struct FInventoryPlacementPlan;
+struct FInventoryQuerySnapshot;
+struct FItemDefinition;
+class FInventoryJournal;
+class FInventoryStash;
+
+/** Compact identifier of an item, dense and stable for a given build, 0 is never assigned to an item */
+typedef uint16 FItemId;
 
 /**
  * Point2D 
@@ -67,6 +80,60 @@ struct INVENTORYSYSTEM_API FPoint2D
 	}
 };
 
+/**
+ * Item Instance Data
+ * Placement of an item stack in the grid, stored inline in its slot
+ * The compact identifier of the item is kept next to it, records, totals and definitions are keyed on it without reading the item
+ */
+USTRUCT(BlueprintType)
+struct INVENTORYSYSTEM_API FItemInstanceData
+{
+	GENERATED_BODY()
+
+	FItemInstanceData()
+	{
+		Item = nullptr;
+		ItemId = 0;
+		bIsRotated = false;
+	}
+
+	explicit FItemInstanceData(UItem* InItem);
+
+	UPROPERTY(BlueprintReadOnly)
+	UItem* Item;
+
+	/** Compact identifier of Item, InvalidItemId for an item that isn't registered */
+	FItemId ItemId;
+
+	UPROPERTY(BlueprintReadOnly)
+	FPoint2D TopLeftCoordinates;
+
+	UPROPERTY(BlueprintReadOnly)
+	FPoint2D Size;
+
+	UPROPERTY(BlueprintReadOnly)
+	uint8 bIsRotated : 1;
+
+	bool operator == (const FItemInstanceData& Other) const
+	{
+		return Other.Item == Item && Other.TopLeftCoordinates == TopLeftCoordinates && Other.bIsRotated == bIsRotated;
+	}
+
+	/** Baked definition of the item, read from the definition table by ItemId without touching the item */
+	const FItemDefinition& GetDefinition() const;
+
+	/** Swaps the size of the item, does nothing if the item can't be rotated */
+	bool Rotate();
+	void ResetRotation();
+
+	/** True if the item covers the cell, items always cover a full rectangle of cells */
+	bool ContainsCell(const FPoint2D& Coordinates) const;
+
+	/** Cells covered by the item relative to its top left coordinates */
+	TArray<FPoint2D> GetSizeInCells() const;
+	
+};
+
 /**
  * Slot
  */
@@ -82,13 +149,18 @@ struct INVENTORYSYSTEM_API FSlot
 		Quantity = 0;
 	}
 
-	FSlot(UItemInstance* InItemInstance, const int32 InQuantity, UInventoryComponent* InOwnerInventory)
+	FSlot(const FItemInstanceData& InInstance, const int32 InQuantity, UInventoryComponent* InOwnerInventory)
 	{
 		OwnerInventory = InOwnerInventory;
-		ItemInstance = InItemInstance;
+		Instance = InInstance;
+		ItemInstance = nullptr;
 		Quantity = InQuantity;
 	}
 
+	UPROPERTY(BlueprintReadOnly)
+	FItemInstanceData Instance;
+
+	/** Only created for item instance classes with blueprint behavior, mirrors Instance */
 	UPROPERTY(BlueprintReadOnly)
 	UItemInstance* ItemInstance;
 
@@ -101,13 +173,25 @@ struct INVENTORYSYSTEM_API FSlot
 
 	bool operator == (const FSlot& Other) const
 	{
-		return Other.ItemInstance == ItemInstance && Other.Quantity == Quantity;
+		return Other.Instance == Instance && Other.ItemInstance == ItemInstance && Other.Quantity == Quantity;
 	}
 
 	bool operator != (const FSlot& Other) const
 	{
-		return Other.ItemInstance != ItemInstance && Other.Quantity != Quantity;
+		return !(*this == Other);
+	}
+
+	UItem* GetItem() const
+	{
+		return Instance.Item;
 	}
+
+	/** Rotates the instance data, and notifies the item instance object if there is one */
+	bool Rotate();
+	void ResetRotation();
+
+	/** Copies the instance data to the item instance object if there is one */
+	void SyncItemInstance() const;
 	
 	bool IsOnMaxStackSize() const;
 	int32 GetMissingStackQuantity() const;
@@ -131,12 +215,12 @@ struct INVENTORYSYSTEM_API FStartupItem
 
 	FStartupItem()
 	{
-		Item = nullptr;
 		Quantity = 0;
 	}
 
+	/** Loaded asynchronously when the inventory begins play */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly)
-	UItem* Item;
+	TSoftObjectPtr<UItem> Item;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (ClampMin = 0, UIMin = 0))
 	int32 Quantity;
@@ -203,17 +287,125 @@ struct INVENTORYSYSTEM_API FEquipmentSlot
 	}
 };
 
+/**
+ * Loot Filter
+ */
+USTRUCT(BlueprintType)
+struct INVENTORYSYSTEM_API FLootFilter
+{
+	GENERATED_BODY()
+
+	FLootFilter()
+	{
+		MaxPickups = 0;
+	}
+
+	/** Only loot items of these types, any type if empty */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<EItemType> ItemTypes;
+
+	/** Only loot these items, any item if empty */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<UItem*> Items;
+
+	/** Maximum number of pickups looted at once, no limit if 0 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, UIMin = 0))
+	int32 MaxPickups;
+
+	bool Matches(const UItem* Item) const;
+};
+
+/**
+ * Looted Item
+ */
+USTRUCT(BlueprintType)
+struct INVENTORYSYSTEM_API FLootedItem
+{
+	GENERATED_BODY()
+
+	FLootedItem()
+	{
+		Item = nullptr;
+		Quantity = 0;
+	}
+
+	FLootedItem(UItem* InItem, const int32 InQuantity)
+	{
+		Item = InItem;
+		Quantity = InQuantity;
+	}
+
+	UPROPERTY(BlueprintReadOnly)
+	UItem* Item;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 Quantity;
+};
+
+/**
+ * Item Spawn Request
+ */
+USTRUCT(BlueprintType)
+struct INVENTORYSYSTEM_API FItemSpawnRequest
+{
+	GENERATED_BODY()
+
+	FItemSpawnRequest()
+	{
+		Item = nullptr;
+		Quantity = 0;
+	}
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UItem* Item;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, UIMin = 0))
+	int32 Quantity;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FTransform Transform;
+};
+
+/**
+ * Pending Item
+ */
+USTRUCT(BlueprintType)
+struct INVENTORYSYSTEM_API FPendingItem
+{
+	GENERATED_BODY()
+
+	FPendingItem()
+	{
+		Item = nullptr;
+		Quantity = 0;
+	}
+
+	FPendingItem(UItem* InItem, const int32 InQuantity)
+	{
+		Item = InItem;
+		Quantity = InQuantity;
+	}
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	UItem* Item;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0, UIMin = 0))
+	int32 Quantity;
+};
+
 /**
  * Delegates
  */
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FInventoryEvent);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FInventoryItemEvent, UItem*, Item, int32, Quantity);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FInventoryEquipmentEvent, UItem*, Item, int32, Quantity);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FInventoryLootEvent, const TArray<FLootedItem>&, LootedItems);
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnItemsPlaced, bool, bSucceeded, const TArray<FPendingItem>&, AddedItems);
 
 /**
  * UInventoryComponent
  */
-UCLASS(Abstract, Blueprintable, BlueprintType, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
+UCLASS(Abstract, Blueprintable, BlueprintType, Config = Game, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent))
 class INVENTORYSYSTEM_API UInventoryComponent : public UActorComponent
 {
 	GENERATED_BODY()
@@ -223,10 +415,15 @@ public:
 	UInventoryComponent();
 	
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	UItemInstance* CreateItemInstance(TSubclassOf<UItemInstance> ItemInstanceClass) const;
 
+	/** True if slots of this item get an item instance object, see bAlwaysCreateItemInstanceObjects */
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool ShouldCreateItemInstance(const UItem* Item) const;
+
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	bool IsWithinBoundaries(const FPoint2D& Coordinates) const;
 
@@ -236,12 +433,18 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	bool DoesItemFit(const TArray<FPoint2D>& SizeInCells, const FPoint2D& Coordinates);
 
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool DoesSizeFit(const FPoint2D& Size, const FPoint2D& Coordinates);
+
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	FPoint2D GetFreeCell();
 	
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	FPoint2D GetFreeCellWhereItemCanFit(const TArray<FPoint2D>& SizeInCells);
 
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	FPoint2D GetFreeCellWhereSizeCanFit(const FPoint2D& Size);
+
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	bool IsFull() const;
 	
@@ -263,8 +466,13 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	void Initialize();
 
+	/** Adds the startup items, any of them that isn't loaded yet is loaded synchronously */
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	void AddStartupItems();
+
+	/** True once the grid is built and the startup items were added */
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool IsInitialized() const;
 	
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	bool AddNewItem(UItem* Item, int32 Quantity, int32& AddedQuantity);
@@ -296,8 +504,34 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	bool LootItem(class APickup* Pickup, int32& LootedQuantity);
 
+	/**
+	 * Loots every pickup within a radius as a single batch, in order of item loot priority then distance
+	 * Inventory events fire once for the whole batch, followed by OnItemsLooted
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
-	void SpawnItem(const UItem* Item, int32 Quantity, const FTransform& Transform);
+	bool LootAllInRadius(const FVector& Center, float Radius, const FLootFilter& Filter, TArray<FLootedItem>& LootedItems);
+
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void SpawnItem(UItem* Item, int32 Quantity, const FTransform& Transform);
+
+	/** Queues many item spawns at once, the pickups are spawned over the next frames within the pickup subsystem spawn budget */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void SpawnItems(const TArray<FItemSpawnRequest>& Requests);
+
+	/**
+	 * Adds many items at once, such as a loot drop, planning where they go on the thread pool
+	 * The plan is applied on the game thread if the slots didn't change meanwhile and made again otherwise, the delegate gets the quantities added
+	 * Requests are planned one at a time in order, see FInventoryPlacementSolver
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool AddItemsAsync(const TArray<FPendingItem>& Items, const FOnItemsPlaced& OnPlaced);
+
+	/** Packs the slots largest first from the top left, planned on the thread pool as AddItemsAsync, the layout is kept if the slots don't all fit */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool SortItemsAsync(const FOnItemsPlaced& OnSorted);
+
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	int32 GetNumPendingPlacements() const;
 
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	void UseItemOnSlot(const FSlot& Slot);
@@ -320,10 +554,103 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	int32 GetEquipmentSlotIndexByType(EEquipmentSlotType SlotType);
 
+	/** Writes the grid size, slots, equipment, money and item instance custom data in the compact versioned format of FInventorySaveData */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool SaveInventory(TArray<uint8>& OutData) const;
+
+	/**
+	 * Replaces the content of the inventory with data written by SaveInventory
+	 * Fails without changing the inventory if the data is invalid or a saved item isn't loaded, see FInventorySaveData::GetItemPrimaryAssetIds
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool LoadInventory(const TArray<uint8>& Data);
+
+	/**
+	 * Restores the inventory from a snapshot and journal written by a previous session, then journals every change made to it
+	 * Relative filenames are resolved in Saved/Inventories, the files are named Filename.snapshot and Filename.journal
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool OpenJournal(const FString& Filename);
+
+	/** Folds the journal into a new snapshot and stops journaling, called when the inventory ends play */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void CloseJournal();
+
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool IsJournalOpen() const;
+
+	/**
+	 * Packs the inventory into a compressed buffer and releases its slots, cells and item instance objects
+	 * Every function reading or changing the slots wakes it up first, fails while a journal or a stash is open
+	 * Also fails while an item instance has blueprint variables, only SerializeCustomData survives hibernation
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool Hibernate();
+
+	/** Rebuilds the slots of a hibernating inventory, notifying as a load does */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void WakeUp();
+
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool IsHibernating() const;
+
+	/**
+	 * Backs this inventory with a memory mapped stash file, only the slots of the loaded regions are materialized
+	 * Relative filenames are resolved in Saved/Inventories, fails if the inventory already has slots, see FInventoryStash
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool OpenStash(const FString& Filename);
+
+	/** Writes back the stash and removes its slots from the inventory, called when the inventory ends play */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void CloseStash();
+
+	/** Materializes the stash slots of the pages overlapping the cells from Min to Max included, such as a visible stash tab */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void LoadStashRegion(const FPoint2D& Min, const FPoint2D& Max);
+
+	/** Writes back the stash pages overlapping the cells from Min to Max included and removes their slots */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void UnloadStashRegion(const FPoint2D& Min, const FPoint2D& Max);
+
+	/** Writes the stash pages that changed back to the file */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	bool FlushStash();
+
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool IsStashOpen() const;
+
+	/** True if the cell is part of the inventory or of a loaded stash region */
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	bool IsCellLoaded(const FPoint2D& Coordinates) const;
+
 
 	/** Internal functions used in native code (c++ only) */
-	bool AddExistingItem_Internal(const UItemInstance* ItemInstance, int32 Quantity, int32& AddedQuantity);
-	// void RemoveItemOnSlot_Internal();
+	bool AddExistingItem_Internal(UItem* Item, int32 Quantity, int32& AddedQuantity);
+
+	/** Tops up the existing stacks, then adds whole stacks and the remainder, only the add paths of the public API notify the added item */
+	bool AddItem_Internal(UItem* Item, int32 Quantity, int32& AddedQuantity, bool bNotifyAdded);
+
+	/** Same as RemoveItemOnSlot, but the item instance of a fully removed slot is left for the caller to release */
+	bool RemoveItemOnSlot_Internal(const FSlot& Slot, int32 Quantity, int32& RemovedQuantity);
+	bool SpawnPickup_Internal(UItem* Item, int32 Quantity, const FTransform& Transform) const;
+
+	/** Defers parameterless inventory events until the outermost batch ends, so each fires at most once */
+	void BeginNotificationBatch();
+	void EndNotificationBatch();
+
+	/** Call after changing Slots directly without notifying, such as while a slot is dragged, queued placements are planned again */
+	void MarkSlotsChanged();
+
+	/**
+	 * Item totals and occupancy as of the last committed batch of changes, safe to call and to query from any thread
+	 * A new snapshot replaces the previous one, hold on to a snapshot for consistent answers across several queries
+	 */
+	TSharedRef<const FInventoryQuerySnapshot, ESPMode::ThreadSafe> GetQuerySnapshot() const;
+
+	/** Fills the save data without serializing it, fails if an item isn't registered in the item registry */
+	bool MakeSaveData(FInventorySaveData& OutSaveData) const;
+	bool ApplySaveData(const FInventorySaveData& SaveData);
 	// void RemoveItem_Internal();
 	
 	
@@ -357,6 +684,9 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, meta = (DisplayName = "On Inventory Item Used"), Category = "Inventory")
 	void K2_OnInventoryItemUsed(UItem* Item, int32 Quantity);
 
+	UFUNCTION(BlueprintImplementableEvent, meta = (DisplayName = "On Inventory Items Looted"), Category = "Inventory")
+	void K2_OnInventoryItemsLooted(const TArray<FLootedItem>& LootedItems);
+
 	
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
 	FPoint2D GridSize;
@@ -364,6 +694,7 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1.0f, UIMin = 1.0f), Category = "Inventory")
 	float CellSize;
 
+	/** Every cell of the grid column by column, only the cells of the loaded pages while a stash is open */
 	UPROPERTY(BlueprintReadOnly, Category = "Inventory")
 	TArray<FPoint2D> Cells;
 
@@ -394,6 +725,25 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
 	TArray<FEquipmentSlot> EquipmentSlots;
 
+	/**
+	 * Creates an item instance object for every slot, even if its class doesn't override OnConstruct, OnUsed or OnRotated
+	 * Only needed by blueprints reading the item instance of a slot instead of its instance data
+	 */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
+	uint8 bAlwaysCreateItemInstanceObjects : 1;
+
+	/** Size the journal may reach before it is folded into a new snapshot */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 64, UIMin = 64), Category = "Inventory")
+	int32 MaxJournalBytes;
+
+	/** Width and height in cells of the pages of new stash files */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1, UIMin = 1, ClampMax = 256, UIMax = 256), Category = "Inventory")
+	int32 StashPageSize;
+
+	/** Seconds without access after which the inventory hibernates, checked once per timeout so up to twice as long in practice, 0 never hibernates */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0.0f, UIMin = 0.0f), Category = "Inventory")
+	float HibernateIdleTimeout;
+
 	UPROPERTY(BlueprintAssignable)	
 	FInventoryEvent OnInventoryInitialized;
 
@@ -424,6 +774,13 @@ public:
 	UPROPERTY(BlueprintAssignable)
 	FInventoryItemEvent OnItemUsed;
 
+	UPROPERTY(BlueprintAssignable)
+	FInventoryLootEvent OnItemsLooted;
+
+	/** Called when stash regions are loaded or unloaded, the loaded cells changed */
+	UPROPERTY(BlueprintAssignable)
+	FInventoryEvent OnStashRegionChanged;
+
 
 	void NotifyInventoryInitialized();
 	void NotifyInventoryUpdated();
@@ -435,5 +792,150 @@ public:
 	void NotifyInventoryItemEquipped(UItem* InItem, int32 InQuantity);
 	void NotifyInventoryItemUnequipped(UItem* InItem, int32 InQuantity);
 	void NotifyInventoryItemUsed(UItem* InItem, int32 InQuantity);
+	void NotifyInventoryItemsLooted(const TArray<FLootedItem>& InLootedItems);
+	void NotifyStashRegionChanged();
+
+private:
+
+	friend class FInventoryJournal;
+	friend class FInventoryStash;
+
+	/** Builds the grid and resets the equipment slots without notifying */
+	void InitializeGrid();
+
+	/** Lists the cells of the grid, or of the loaded stash pages, so walks over the cells never cover the whole stash */
+	void UpdateCells();
+
+	/**
+	 * Plans where an item instance goes from its shape alone, rotating it when it only fits rotated
+	 * Nothing is created until the placement succeeded, a full inventory makes no slot nor item instance object
+	 */
+	bool FindItemPlacement(FItemInstanceData& Instance);
+
+	/** Makes a slot owned by this inventory, with an item instance object if the item needs one */
+	FSlot MakeSlot(const FItemInstanceData& Instance, int32 Quantity);
+
+	/** Makes a slot from saved data, restoring the custom data of its item instance object */
+	FSlot MakeSavedSlot(const FItemInstanceData& Instance, const FSavedSlot& SavedSlot);
+
+	/**
+	 * Adds again through the add path the slots out of the grid or overlapping an earlier slot, such as restored slots whose item grew since they were saved
+	 * Slots that no longer fit anywhere are lost, returns the number of slots moved
+	 */
+	int32 RelocateMisplacedSlots();
+
+	/**
+	 * Returns the item instance of a slot that left the inventory to the item instance pool
+	 * Copies of the slot still held by widgets or blueprints must not use the instance afterwards
+	 */
+	void ReleaseItemInstance(const FSlot& Slot) const;
+
+	/** Releases the item instances of every slot and equipment slot */
+	void ReleaseItemInstances();
+
+	/** Wakes the inventory up if it hibernates and marks it as accessed for the idle timeout */
+	void NoteAccess()
+	{
+		if (bIsHibernating)
+		{
+			WakeUp();
+		}
+
+		bWasAccessed = true;
+	}
+
+	void OnHibernateTimer();
+
+	/** Drops the hibernated data without applying it */
+	void DiscardHibernatedData();
+
+	/**
+	 * Placement Request
+	 */
+	struct FPlacementRequest
+	{
+		FPlacementRequest()
+		{
+			NumPlans = 0;
+			bIsSort = false;
+		}
+
+		/** Empty for a sort */
+		TArray<FPendingItem> Items;
+
+		FOnItemsPlaced OnPlaced;
+
+		int32 NumPlans;
+		uint8 bIsSort : 1;
+	};
+
+	/** Plans the first queued request on the thread pool, or on the game thread once it was planned too many times */
+	void StartPlacement();
+	void OnPlacementPlanned(uint32 Serial, const FInventoryPlacementPlan& Plan);
+
+	/** Copies the slots and definitions the solver reads */
+	void MakePlacementSnapshot(const FPlacementRequest& Request, FInventoryPlacementSnapshot& OutSnapshot) const;
+
+	/** Applies a plan made for the current inventory version, calls the delegate of the request and starts the next one */
+	void ApplyPlacementPlan(const FInventoryPlacementPlan& Plan);
+
+	/** Drops the queued requests without calling their delegates */
+	void CancelPlacements();
+
+	/** Replaces the query snapshot, called once a batch of changes is committed */
+	void PublishQuerySnapshot();
+
+	/** Approximate memory of the slots, cells and item instance objects */
+	int64 GetLiveStateSize() const;
+
+	/** Streams in the startup items, the inventory finishes initializing once they are loaded */
+	void LoadStartupItems();
+	void OnStartupItemsLoaded();
+
+	TSharedPtr<FStreamableHandle> StartupItemsHandle;
+
+	TSharedPtr<FInventoryJournal> Journal;
+	TSharedPtr<FInventoryStash> Stash;
+
+	FTimerHandle HibernateTimerHandle;
+
+	TArray<uint8> HibernatedData;
+
+	/** Keeps the items of the hibernated slots loaded, waking up needs them */
+	UPROPERTY(Transient)
+	TArray<UItem*> HibernatedItems;
+
+	int64 HibernationBytesSaved;
+
+	TArray<FPlacementRequest> PlacementRequests;
+
+	/** Keeps the items of the queued placements loaded */
+	UPROPERTY(Transient)
+	TArray<UItem*> PlacementItems;
+
+	/** Changes whenever the slots change, a plan only applies to the version it was made for */
+	uint32 InventoryVersion;
+
+	/** Identifies the plan in flight, plans of cancelled requests are ignored */
+	uint32 PlacementSerial;
+	uint8 bIsPlacementInFlight : 1;
+
+	TSharedPtr<const FInventoryQuerySnapshot, ESPMode::ThreadSafe> QuerySnapshot;
+
+	/** Only held to copy or swap QuerySnapshot, never while a snapshot is built */
+	mutable FRWLock QuerySnapshotLock;
+
+	/** Occupancy and item totals of the stash records that aren't materialized, reset when the loaded regions change */
+	TSharedPtr<const FInventoryQuerySnapshot, ESPMode::ThreadSafe> StashQuerySnapshot;
+
+	uint8 bIsHibernating : 1;
+	uint8 bWasAccessed : 1;
+
+	uint8 bIsInitialized : 1;
+
+	int32 NotificationBatchDepth;
+	uint8 bPendingInventoryUpdated : 1;
+	uint8 bPendingInventoryInsufficientSpace : 1;
+	uint8 bPendingInventoryWeightChanged : 1;
 	
 };
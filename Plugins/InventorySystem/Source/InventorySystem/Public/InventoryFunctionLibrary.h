@@ -32,10 +32,22 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	static int32 GetSlotMissingStackQuantity(const FSlot& Slot);
 
+	/** Cells covered by the item of a slot relative to its top left coordinates */
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	static TArray<FPoint2D> GetSlotSizeInCells(const FSlot& Slot);
+
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	static bool IsValidEquipmentSlot(const FEquipmentSlot& EquipmentSlot);
 
 	UFUNCTION(BlueprintPure, Category = "Inventory")
 	static bool DoesItemHaveValidEquipmentSlot(const UItem* Item);
+
+	/** Returns the compact identifier of an item, 0 if the item is invalid */
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	static int32 GetItemId(const UItem* Item);
+
+	/** Returns the item of a compact identifier if it is loaded */
+	UFUNCTION(BlueprintPure, Category = "Inventory")
+	static UItem* GetLoadedItemFromId(int32 ItemId);
 	
 };
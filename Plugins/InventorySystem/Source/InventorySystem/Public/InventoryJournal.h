@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InventorySaveData.h"
+
+class IFileHandle;
+class UInventoryComponent;
+
+/**
+ * Inventory Journal Record Type
+ */
+enum class EInventoryJournalRecordType : uint8
+{
+	Money,
+	SlotAdded,
+	SlotRemoved,
+	SlotQuantity,
+	SlotMoved,
+	EquipmentSet,
+	EquipmentCleared,
+};
+
+/**
+ * Inventory Journal
+ * Append only log of the changes made to an inventory since its last snapshot, both kept in files next to each other
+ * Changes are found by comparing the slots with the ones recorded last, every mutation path is journaled without being aware of it
+ * The changes of a frame are compared, appended and flushed once at the end of the frame
+ * Slots are identified by their top left coordinates, no two slots of a grid share them
+ */
+class INVENTORYSYSTEM_API FInventoryJournal
+{
+public:
+
+	FInventoryJournal();
+	~FInventoryJournal();
+
+	/**
+	 * Restores the inventory from the snapshot and the journal if they exist, then starts recording its changes
+	 * The restored state is folded into a new snapshot right away, fails without changing the inventory if a saved item isn't loaded
+	 */
+	bool Open(UInventoryComponent* InInventory, const FString& InFilename, int32 InMaxJournalBytes);
+
+	/** Folds the journal into a new snapshot and stops recording */
+	void Close();
+
+	bool IsOpen() const;
+
+	/** Records the changes at the end of the frame, or right away outside of a world */
+	void RecordChanges();
+
+	/** Writes a snapshot of the inventory and empties the journal */
+	bool Compact();
+
+	int64 GetJournalSize() const;
+
+	static const uint32 Magic;
+
+private:
+
+	/**
+	 * Slot Record
+	 */
+	struct FSlotRecord
+	{
+		FItemId ItemId;
+		int32 Quantity;
+		uint32 PackedPlacement;
+
+		/** Index in the slots of the inventory, only valid while the changes are written */
+		int32 SlotIndex;
+	};
+
+	/** Applies the snapshot then every complete record of the journal written for it */
+	bool Restore(const TArray<uint8>& SnapshotData);
+
+	/** Reads a whole record before applying it, a record cut short by a crash is never applied */
+	bool ApplyRecord(FArchive& Ar);
+
+	/** Appends records for the changes since the last write, folds the journal into a new snapshot once it is larger than MaxJournalBytes */
+	void WriteChanges();
+
+	/** Remembers the current state of the inventory, the next records are relative to it */
+	void CaptureState();
+
+	void WriteSlotChanges(FArchive& Ar);
+	void WriteEquipmentChanges(FArchive& Ar);
+
+	int32 FindSlotIndex(uint32 SlotKey) const;
+
+	static FSlotRecord MakeSlotRecord(const FSlot& Slot);
+
+	/** Placement without the rotation */
+	static uint32 GetSlotKey(uint32 PackedPlacement);
+
+	UInventoryComponent* Inventory;
+
+	FString SnapshotFilename;
+	FString JournalFilename;
+
+	TUniquePtr<IFileHandle> JournalHandle;
+
+	int32 MaxJournalBytes;
+	int64 JournalSize;
+
+	/** Incremented by every snapshot, a journal is only replayed on top of the snapshot it was written for */
+	uint32 Generation;
+
+	TMap<uint32, FSlotRecord> RecordedSlots;
+	TMap<uint32, FSlotRecord> CurrentSlots;
+	TMap<EEquipmentSlotType, FSlotRecord> RecordedEquipmentSlots;
+	int32 RecordedMoney;
+
+	/** The slots are only compared if the inventory version changed since they were recorded */
+	uint32 RecordedInventoryVersion;
+
+	uint8 bIsWritePending : 1;
+
+};
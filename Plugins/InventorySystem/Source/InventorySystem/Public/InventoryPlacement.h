@@ -0,0 +1,220 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InventoryComponent.h"
+
+class UItem;
+
+/**
+ * Inventory Grid Occupancy
+ * One bit per cell in rows of 64 bit words, a rectangle is checked and occupied a whole word of cells at a time
+ * Covers the whole grid or a window of it, such as the loaded regions of a stash, cells outside of the window are never free
+ */
+struct INVENTORYSYSTEM_API FInventoryGridOccupancy
+{
+	FInventoryGridOccupancy()
+	{
+		WordsPerRow = 0;
+	}
+
+	explicit FInventoryGridOccupancy(const FPoint2D& InGridSize)
+		: FInventoryGridOccupancy(FPoint2D(0, 0), InGridSize)
+	{
+	}
+
+	FInventoryGridOccupancy(const FPoint2D& InOrigin, const FPoint2D& InSize)
+	{
+		Origin = InOrigin;
+		Size = FPoint2D(FMath::Max(InSize.X, 0), FMath::Max(InSize.Y, 0));
+		WordsPerRow = FMath::DivideAndRoundUp(Size.X, 64);
+		Words.SetNumZeroed(WordsPerRow * Size.Y);
+	}
+
+	bool IsFree(const FPoint2D& TopLeft, const FPoint2D& RectSize) const
+	{
+		const int32 X = TopLeft.X - Origin.X;
+		const int32 Y = TopLeft.Y - Origin.Y;
+
+		if (X < 0 || Y < 0 || RectSize.X <= 0 || RectSize.Y <= 0 || X + RectSize.X > Size.X || Y + RectSize.Y > Size.Y)
+		{
+			return false;
+		}
+
+		for (int32 Row = Y; Row < Y + RectSize.Y; Row++)
+		{
+			for (int32 Word = X / 64; Word <= (X + RectSize.X - 1) / 64; Word++)
+			{
+				if (Words[Row * WordsPerRow + Word] & GetWordMask(Word, X, RectSize.X))
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	/** The part of the rectangle outside of the window is ignored */
+	void Occupy(const FPoint2D& TopLeft, const FPoint2D& RectSize)
+	{
+		const int32 MinX = FMath::Max(TopLeft.X - Origin.X, 0);
+		const int32 MinY = FMath::Max(TopLeft.Y - Origin.Y, 0);
+		const int32 MaxX = FMath::Min(TopLeft.X - Origin.X + RectSize.X, Size.X);
+		const int32 MaxY = FMath::Min(TopLeft.Y - Origin.Y + RectSize.Y, Size.Y);
+
+		for (int32 Row = MinY; Row < MaxY; Row++)
+		{
+			for (int32 Word = MinX / 64; MinX < MaxX && Word <= (MaxX - 1) / 64; Word++)
+			{
+				Words[Row * WordsPerRow + Word] |= GetWordMask(Word, MinX, MaxX - MinX);
+			}
+		}
+	}
+
+	/** Finds the first free cell where the size fits, in the order of UInventoryComponent::Cells */
+	bool FindFree(const FPoint2D& RectSize, FPoint2D& OutTopLeft) const
+	{
+		for (int32 X = Origin.X; X + RectSize.X <= Origin.X + Size.X; X++)
+		{
+			for (int32 Y = Origin.Y; Y + RectSize.Y <= Origin.Y + Size.Y; Y++)
+			{
+				if (IsFree(FPoint2D(X, Y), RectSize))
+				{
+					OutTopLeft = FPoint2D(X, Y);
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+private:
+
+	/** Bits of a word covered by the cells from X to X + Width excluded, relative to the window */
+	static uint64 GetWordMask(const int32 Word, const int32 X, const int32 Width)
+	{
+		const int32 Start = FMath::Max(X, Word * 64) - Word * 64;
+		const int32 End = FMath::Min(X + Width, Word * 64 + 64) - Word * 64;
+
+		return End - Start == 64 ? ~0ull : ((1ull << (End - Start)) - 1) << Start;
+	}
+
+	FPoint2D Origin;
+	FPoint2D Size;
+	int32 WordsPerRow;
+	TArray<uint64> Words;
+};
+
+/**
+ * Placement Item
+ * Item to place with the parts of its definition the solver reads, the item itself is never read off the game thread
+ */
+struct FPlacementItem
+{
+	FPlacementItem()
+	{
+		Item = nullptr;
+		Quantity = 0;
+		MaxSlotQuantity = 1;
+		SlotIndex = INDEX_NONE;
+		bCanBeRotated = false;
+	}
+
+	UItem* Item;
+	int32 Quantity;
+	int32 MaxSlotQuantity;
+	FPoint2D Size;
+
+	/** Slot moved by a sort, INDEX_NONE for an item being added */
+	int32 SlotIndex;
+
+	uint8 bCanBeRotated : 1;
+};
+
+/**
+ * Placement Stack
+ * Slot of the inventory that still has room for more of its item
+ */
+struct FPlacementStack
+{
+	int32 SlotIndex;
+	UItem* Item;
+	int32 MissingQuantity;
+};
+
+/**
+ * Inventory Placement Snapshot
+ * Copy of everything a placement reads from the inventory, made on the game thread and never changed afterwards
+ */
+struct INVENTORYSYSTEM_API FInventoryPlacementSnapshot
+{
+	FInventoryPlacementSnapshot()
+	{
+		InventoryVersion = 0;
+	}
+
+	/** Version of the inventory slots the snapshot was made from */
+	uint32 InventoryVersion;
+
+	/** Cells of the slots staying in place and of the stash regions that aren't loaded */
+	FInventoryGridOccupancy Occupancy;
+
+	TArray<FPlacementStack> Stacks;
+	TArray<FPlacementItem> Items;
+};
+
+/**
+ * Planned Stack
+ */
+struct FPlannedStack
+{
+	int32 SlotIndex;
+	int32 ItemIndex;
+	int32 Quantity;
+};
+
+/**
+ * Planned Slot
+ */
+struct FPlannedSlot
+{
+	int32 ItemIndex;
+	int32 Quantity;
+	FPoint2D TopLeftCoordinates;
+	uint8 bIsRotated : 1;
+};
+
+/**
+ * Inventory Placement Plan
+ * Where each snapshot item goes, only valid for the inventory version of its snapshot
+ */
+struct INVENTORYSYSTEM_API FInventoryPlacementPlan
+{
+	FInventoryPlacementPlan()
+	{
+		InventoryVersion = 0;
+	}
+
+	uint32 InventoryVersion;
+
+	TArray<FPlannedStack> Stacks;
+	TArray<FPlannedSlot> Slots;
+
+	/** Quantity of each snapshot item that found no room */
+	TArray<int32> UnplacedQuantities;
+};
+
+/**
+ * Inventory Placement Solver
+ * Plans where items go from a snapshot alone, so it runs on any thread
+ * Items first top up the existing stacks in slot order, then the new slots are placed largest first on the first free cells, rotated if they only fit rotated
+ */
+class INVENTORYSYSTEM_API FInventoryPlacementSolver
+{
+public:
+
+	static void Solve(const FInventoryPlacementSnapshot& Snapshot, FInventoryPlacementPlan& OutPlan);
+};
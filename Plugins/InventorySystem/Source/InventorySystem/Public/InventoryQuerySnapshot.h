@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InventoryPlacement.h"
+
+class UItem;
+
+/**
+ * Inventory Query Snapshot
+ * Immutable item totals and occupancy of an inventory, published by the inventory each time a batch of changes is committed
+ * Any thread can hold and query it without locking, items are only compared by address and never read
+ * Stash records whose item isn't loaded aren't counted, no caller can reference such an item
+ */
+struct INVENTORYSYSTEM_API FInventoryQuerySnapshot
+{
+	FInventoryQuerySnapshot();
+
+	bool DoesItemExist(const UItem* Item) const;
+	int32 CountItemQuantity(const UItem* Item) const;
+
+	bool IsFreeCell(const FPoint2D& Coordinates) const;
+	bool DoesSizeFit(const FPoint2D& Size, const FPoint2D& Coordinates) const;
+
+	/** True if a free area of the size exists, or of the rotated size if bCanBeRotated is true */
+	bool HasRoomFor(const FPoint2D& Size, bool bCanBeRotated) const;
+
+	/** Version of the inventory slots the snapshot was made from */
+	uint32 InventoryVersion;
+
+	int32 Money;
+
+	/** Quantities of the materialized slots */
+	TMap<const UItem*, int32> ItemQuantities;
+
+	/** Cells of the slots and of the stash regions that aren't loaded */
+	FInventoryGridOccupancy Occupancy;
+
+	/** Totals and occupancy of the stash records that aren't materialized, shared by the snapshots published until the loaded regions change */
+	TSharedPtr<const FInventoryQuerySnapshot, ESPMode::ThreadSafe> StashSnapshot;
+};
@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetManager_Custom.h"
+#include "InventoryComponent.h"
+
+/**
+ * Inventory Save Version
+ * Add a version before VersionPlusOne for every change of the format, FInventorySaveData::Serialize keeps reading the older ones
+ */
+enum class EInventorySaveVersion : int32
+{
+	Initial = 1,
+
+	VersionPlusOne,
+	Latest = VersionPlusOne - 1
+};
+
+/**
+ * Saved Slot
+ */
+struct INVENTORYSYSTEM_API FSavedSlot
+{
+	FSavedSlot()
+	{
+		ItemId = UAssetManager_Custom::InvalidItemId;
+		Quantity = 0;
+		PackedPlacement = 0;
+	}
+
+	FItemId ItemId;
+	int32 Quantity;
+
+	/** Top left coordinates and rotation, the rotation in the first bit then 15 bits for each coordinate */
+	uint32 PackedPlacement;
+
+	/** Written by UItemInstance::SerializeCustomData, empty for slots without an item instance object */
+	TArray<uint8> CustomData;
+
+	/** Saves the item, quantity, placement and item instance custom data of a slot, fails if the item isn't registered */
+	bool SetFromSlot(const FSlot& Slot);
+
+	void SetPlacement(const FPoint2D& TopLeftCoordinates, bool bIsRotated);
+	FPoint2D GetTopLeftCoordinates() const;
+	bool IsRotated() const;
+
+	/** Writes the slot without changing it */
+	void Save(FArchive& Ar) const;
+
+	/** Reads the slot from a loading archive, saving archives are passed to Save */
+	void Serialize(FArchive& Ar);
+};
+
+/**
+ * Saved Equipment Slot
+ */
+struct INVENTORYSYSTEM_API FSavedEquipmentSlot
+{
+	FSavedEquipmentSlot()
+	{
+		Type = EEquipmentSlotType::None;
+	}
+
+	EEquipmentSlotType Type;
+	FSavedSlot Slot;
+};
+
+/**
+ * Inventory Save Data
+ * Compact binary snapshot of an inventory, written and applied by UInventoryComponent::MakeSaveData and ApplySaveData
+ * Items are saved by compact item identifier, their names follow the slots and are only read if the item registry changed since the data was saved
+ */
+struct INVENTORYSYSTEM_API FInventorySaveData
+{
+	FInventorySaveData();
+
+	/** Version the data was read with, saving always writes the latest one */
+	int32 Version;
+
+	/** Item registry hash of the build the data was saved with */
+	uint32 ItemRegistryHash;
+
+	FPoint2D GridSize;
+	int32 Money;
+
+	TArray<FSavedSlot> Slots;
+	TArray<FSavedEquipmentSlot> EquipmentSlots;
+
+	/** Grid and equipment slots of items that no longer exist, removed when data saved with another item registry was loaded, never saved */
+	TArray<FSavedSlot> RemovedSlots;
+
+	bool SaveToBytes(TArray<uint8>& OutData) const;
+	bool LoadFromBytes(const TArray<uint8>& Data);
+
+	/** Same as SaveToBytes with a small header, the data is zlib compressed unless bCompress is false */
+	bool SaveToCompressedBytes(TArray<uint8>& OutData, bool bCompress = true) const;
+	bool LoadFromCompressedBytes(const TArray<uint8>& Data);
+
+	/**
+	 * Writes the data to a temporary file moved over the previous one, the previous file stays intact if anything fails
+	 * Safe to call on any thread once the item names are resolved, data made by UInventoryComponent::MakeSaveData already is
+	 */
+	bool SaveToFile(const FString& Filename, bool bCompress) const;
+	bool LoadFromFile(const FString& Filename);
+
+	/** Resolves the names of the saved items from the item registry, saving resolves them itself if this wasn't called */
+	void ResolveItemNames();
+
+	/** Approximate memory used by the data and its encoding, used to bound the saves in flight */
+	int64 GetEstimatedSize() const;
+
+	/** Writes the data with the latest version without changing it, safe while a worker thread saves the same data */
+	void Save(FArchive& Ar) const;
+
+	/** Reads the data from a loading archive, saving archives are passed to Save */
+	void Serialize(FArchive& Ar);
+
+	/** Primary asset identifiers of the saved items, they must be loaded before the data is applied to an inventory */
+	void GetItemPrimaryAssetIds(TArray<FPrimaryAssetId>& OutItemIds) const;
+
+	static const uint32 Magic;
+	static const uint32 FileMagic;
+
+	/** Resolves relative filenames in Saved/Inventories */
+	static FString GetSavePath(const FString& Filename);
+
+	/** Grid sizes are limited by the 15 bits of each packed coordinate */
+	static const int32 MaxGridSize;
+
+	/** Largest uncompressed data saved or loaded, a corrupted size can't make loading allocate more */
+	static const int32 MaxDataSize;
+
+private:
+
+	/** Maps the identifiers of data saved with another item registry by item name, slots of items that no longer exist are moved to RemovedSlots */
+	void RemapItemIds(const TMap<FItemId, FName>& SavedItemNames);
+
+	/** Compact identifiers and names of the items of the slots, read from the item registry */
+	void GetItemNames(TArray<TPair<FItemId, FString>>& OutItemNames) const;
+
+	/** Compact identifiers and names of the saved items, written after the slots */
+	TArray<TPair<FItemId, FString>> ItemNames;
+	uint8 bHasItemNames : 1;
+
+};
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InventorySaveSubsystem.generated.h"
+
+class UInventoryComponent;
+struct FInventorySaveData;
+
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnInventorySaved, const FString&, Filename, bool, bSucceeded);
+
+/**
+ * UInventorySaveSubsystem
+ * Saves inventories to files without stalling the game thread
+ * The game thread only copies the state of the inventory, encoding, compressing and writing happen on the thread pool
+ */
+UCLASS(Config = Game)
+class INVENTORYSYSTEM_API UInventorySaveSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UInventorySaveSubsystem();
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Snapshots the inventory and queues the snapshot to be written in the background, relative filenames are resolved in Saved/Inventories
+	 * A file has at most one save in flight and one queued, a newer snapshot replaces the queued one and its delegate is called with the newer save
+	 * The delegate is called on the game thread, the previous file is kept if the save fails
+	 */
+	UFUNCTION(BlueprintCallable, Category = "InventorySave")
+	bool SaveInventoryAsync(UInventoryComponent* Inventory, const FString& Filename, const FOnInventorySaved& OnSaved);
+
+	/** Loads an inventory saved by SaveInventoryAsync, waits for the pending saves of the file first */
+	UFUNCTION(BlueprintCallable, Category = "InventorySave")
+	bool LoadInventory(UInventoryComponent* Inventory, const FString& Filename);
+
+	/** Blocks until every queued and in flight save completed, then calls their delegates */
+	UFUNCTION(BlueprintCallable, Category = "InventorySave")
+	void FlushSaves();
+
+	UFUNCTION(BlueprintPure, Category = "InventorySave")
+	int32 GetNumPendingSaves() const;
+
+
+	/** Estimated memory of the snapshots being encoded and written, further saves wait in the queue, a single save is always allowed */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0, UIMin = 0), Category = "InventorySave")
+	int32 MaxInFlightSaveBytes;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "InventorySave")
+	uint8 bCompressSaves : 1;
+
+private:
+
+	/**
+	 * Inventory Save
+	 */
+	struct FInventorySave
+	{
+		FInventorySave()
+		{
+			EstimatedSize = 0;
+		}
+
+		FString Filename;
+
+		/** Never changed once queued, shared with the worker */
+		TSharedPtr<const FInventorySaveData, ESPMode::ThreadSafe> SaveData;
+
+		int64 EstimatedSize;
+
+		/** Delegates of this save and of the saves it replaced */
+		TArray<FOnInventorySaved> OnSavedDelegates;
+
+		TFuture<bool> Result;
+	};
+
+	/** Starts the queued saves in order while the in flight memory allows it, skipping files that are still being written */
+	void StartQueuedSaves();
+
+	/** Calls the delegates of the saves that completed, or waits for every save if bWait is true */
+	void CompleteSaves(bool bWait);
+
+	bool IsSaveInFlight(const FString& Filename) const;
+
+	TArray<FInventorySave> QueuedSaves;
+	TArray<FInventorySave> InFlightSaves;
+
+	int64 InFlightSaveBytes;
+
+};
@@ -0,0 +1,179 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetManager_Custom.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class UInventoryComponent;
+struct FInventoryGridOccupancy;
+struct FPoint2D;
+struct FSlot;
+
+/**
+ * Inventory Stash
+ * Fixed layout backing file of a very large inventory grid, memory mapped so only the pages that are read get paged in
+ * The grid is split in square pages, a page holds the records of the slots whose top left cell is in it
+ * Only the slots of the loaded pages are materialized in the inventory, cells of the other pages are never free
+ * Quantities by item are kept after the item names and updated along with the pages, counting never reads a page that isn't loaded
+ * Item instance custom data isn't kept, the records are fixed size
+ */
+class INVENTORYSYSTEM_API FInventoryStash
+{
+public:
+
+	FInventoryStash();
+	~FInventoryStash();
+
+	/**
+	 * Opens the stash file of the inventory, creating an empty one of the inventory grid size if it doesn't exist
+	 * No page is loaded yet, fails if the inventory already has slots or the file was created for another grid size
+	 * The page size of an existing file is kept
+	 */
+	bool Open(UInventoryComponent* InInventory, const FString& InFilename, int32 InPageSize);
+
+	/** Writes back and unloads every loaded page */
+	void Close();
+
+	bool IsOpen() const;
+
+	/** Materializes the slots of the pages overlapping the region, items that aren't loaded yet are loaded synchronously */
+	void LoadRegion(const FPoint2D& Min, const FPoint2D& Max);
+
+	/** Writes back the pages overlapping the region, then removes their slots from the inventory, pages holding a slot that can't be written stay loaded */
+	void UnloadRegion(const FPoint2D& Min, const FPoint2D& Max);
+
+	/** Writes back in place the loaded pages that changed since they were read, untouched pages are never written, fails if a slot can't be written */
+	bool Flush();
+
+	bool IsCellLoaded(const FPoint2D& Coordinates) const;
+
+	/** True if the page of the cell is loaded and no slot of a page that isn't loaded covers it */
+	bool IsCellAvailable(const FPoint2D& Coordinates) const;
+
+	/** Cells of the loaded pages in the order of UInventoryComponent::Cells, column by column */
+	void GetLoadedCells(TArray<FPoint2D>& OutCells) const;
+
+	/** Window over the loaded pages where the cells that aren't available are occupied, the slots of the inventory aren't in it */
+	void GetLoadedOccupancy(FInventoryGridOccupancy& OutOccupancy) const;
+
+	/** Quantity of an item in the whole stash, from the totals of the file and the loaded pages, the other pages are never read */
+	int32 CountItemQuantity(FItemId ItemId) const;
+
+	/** Quantities by item of the records that aren't materialized as slots, from the totals of the file and the loaded pages, the other pages are never read */
+	void CountUnloadedItemQuantities(TMap<FItemId, int32>& OutQuantities) const;
+
+	static const uint32 Magic;
+
+	/** Version 2 writes the item totals after the item names, version 1 files are counted once and upgraded */
+	static const uint32 Version;
+
+private:
+
+	/**
+	 * Header
+	 */
+	struct FHeader
+	{
+		uint32 Magic;
+		uint32 Version;
+		uint32 ItemRegistryHash;
+		int32 GridSizeX;
+		int32 GridSizeY;
+		int32 PageSize;
+
+		/** Number of item names written after the pages, indexed by compact item identifier, followed by as many item totals */
+		int32 NumItemNames;
+		uint32 Reserved;
+	};
+
+	/**
+	 * Slot Record
+	 */
+	struct FSlotRecord
+	{
+		FItemId ItemId;
+		uint16 Reserved;
+		int32 Quantity;
+		uint32 PackedPlacement;
+	};
+
+	bool CreateFile(const FHeader& NewHeader);
+
+	bool MapFile();
+	void UnmapFile();
+
+	/** Maps the items of a file written with another item registry by name and rewrites every page */
+	bool RemapItemIds();
+
+	/** Writes the loaded pages that changed, fails if the file can't be written, pages holding a slot without a compact item identifier are flagged */
+	bool WriteLoadedPages(TBitArray<>& OutUnwrittenPages);
+
+	/** Writes pages, the occupancy, then the item names and totals, the file is unmapped meanwhile since mapped files are read only */
+	bool WriteFile(const TMap<int32, TArray<uint8>>& Pages, const TArray<uint8>* Occupancy);
+
+	/** Reads the item totals written after the item names */
+	bool ReadItemQuantities();
+
+	/** Counts the item totals from every page, only for files that don't have them or whose pages were partially written */
+	void CountItemQuantitiesFromPages();
+
+	/** Adds the quantities of records to the item totals, or removes them with a negative sign */
+	void AddItemQuantities(TArrayView<const FSlotRecord> Records, int64 Sign);
+
+	/** Quantities by item of the records of the loaded pages that are materialized as slots, as they were last written */
+	void CountLoadedRecordQuantities(TMap<FItemId, int64>& OutQuantities) const;
+
+	void EncodePage(const TArray<FSlotRecord>& Records, TArray<uint8>& OutPage) const;
+
+	/** Records of a mapped page, the file stays the owner of the memory */
+	TArrayView<const FSlotRecord> GetPageRecords(int32 PageIndex) const;
+
+	const uint8* GetMappedPage(int32 PageIndex) const;
+
+	/** Sets the cells covered by a record, sized by the baked definition of its item */
+	void SetRecordCells(TBitArray<>& Cells, const FSlotRecord& Record, bool bIsOccupied) const;
+
+	void GetOccupancyData(const TBitArray<>& Cells, TArray<uint8>& OutData) const;
+
+	int32 GetPageIndex(const FPoint2D& Coordinates) const;
+	int32 GetPageCapacity() const;
+	int64 GetPageBytes() const;
+	int64 GetOccupancyOffset() const;
+	int64 GetOccupancyBytes() const;
+	int64 GetPagesOffset() const;
+	int64 GetItemNamesOffset() const;
+
+	static FSlotRecord MakeSlotRecord(const FSlot& Slot);
+
+	/** Writes the names of every registered item in compact item identifier order */
+	static int32 WriteItemNames(FArchive& Ar);
+
+	/** Writes the item totals of the item names of the header */
+	void WriteItemQuantities(FArchive& Ar) const;
+
+	UInventoryComponent* Inventory;
+	FString Filename;
+
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	FHeader Header;
+
+	int32 NumPagesX;
+	int32 NumPagesY;
+
+	TBitArray<> LoadedPages;
+
+	/** Cells covered by the slots of the pages that aren't loaded, the loaded slots are checked by the inventory itself */
+	TBitArray<> UnloadedOccupancy;
+
+	/** Records of loaded pages whose item couldn't be loaded, they are written back as they were read */
+	TMap<int32, TArray<FSlotRecord>> UnresolvedRecords;
+
+	/** Quantities by compact item identifier of the records written in every page, updated along with the pages */
+	TArray<int64> ItemQuantities;
+
+};
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "InventoryValidationCommandlet.generated.h"
+
+/**
+ * UInventoryValidationCommandlet
+ * Validates every inventory saved by UInventorySaveSubsystem against the current item definitions, files are processed in parallel:
+ * UE4Editor-Cmd.exe Project.uproject -run=InventoryValidation [-Directory=Path] [-Repair]
+ * Overlapping or out of bounds slots are moved to free cells, stacks over the maximum are split and slots of removed items are dropped
+ * With -Repair the fixed inventories, and the ones saved with an older format or item registry, are written back
+ */
+UCLASS()
+class INVENTORYSYSTEM_API UInventoryValidationCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UInventoryValidationCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+	
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "InventoryComponent.h"
+#include "AssetManager_Custom.h"
 #include "Engine/DataAsset.h"
 #include "Item.generated.h"
 
@@ -23,6 +24,18 @@ public:
 	UItem();
 
 	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+	virtual void PostLoad() override;
+
+#if WITH_EDITORONLY_DATA
+	virtual void PreSave(const class ITargetPlatform* TargetPlatform) override;
+#endif
+
+	/**
+	 * Assigns the streamed ImageResource to the Image brush
+	 * @return True if the brush is ready to be drawn, false if ImageResource still has to be loaded
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Item")
+	bool UpdateImageResource();
 
 	UFUNCTION(BlueprintPure, Category = "Item")
 	FString GetIdentifierString() const;
@@ -30,6 +43,18 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Item")
 	FString GetAssetName() const;
 
+	/** Returns the compact identifier of this item, InvalidItemId until it is registered when it loads, this never registers it */
+	FItemId GetItemId() const;
+
+	/** Returns a copy of the baked hot fields of this item, baked from the item itself if it isn't registered, slots read the table by identifier instead */
+	FItemDefinition GetDefinition() const;
+
+	FItemDefinition BakeDefinition() const;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
 	UFUNCTION(BlueprintPure, Category = "Item")
 	const FPrimaryAssetType& GetAssetType() const
 	{
@@ -55,9 +80,13 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true), Category = "Item")
 	FText Description;
 
+	/** Brush settings of the item icon, its resource object is only assigned at runtime from ImageResource */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true), Category = "Item")
 	FSlateBrush Image;
 
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true, AssetBundles = "UI", AllowedClasses = "Texture2D,MaterialInterface"), Category = "Item")
+	TSoftObjectPtr<UObject> ImageResource;
+
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true), Category = "Item")
 	EItemType Type;
 
@@ -109,10 +138,26 @@ public:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true, EditCondition = "bCanBeConsumed", ClampMin = 1, UIMin = 1), Category = "Item")
 	int32 ConsumedQuantityPerUsage;
 
-	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true), Category = "Item")
-	UStaticMesh* PickupStaticMesh;
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true, AssetBundles = "World"), Category = "Item")
+	TSoftObjectPtr<UStaticMesh> PickupStaticMesh;
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true), Category = "Item")
 	FVector PickupStaticMeshScale;
+
+	/** Pickups of items with a higher priority are looted first when looting an area */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true), Category = "Item")
+	int32 LootPriority;
+
+private:
+
+	friend class UAssetManager_Custom;
+
+	/** Set by the asset manager once the definition of this item is baked */
+	mutable FItemId CachedItemId;
+
+#if WITH_EDITORONLY_DATA
+	/** Moves a hard referenced brush resource to ImageResource, so loading the item doesn't load its icon */
+	void MigrateImageResource();
+#endif
 	
 };
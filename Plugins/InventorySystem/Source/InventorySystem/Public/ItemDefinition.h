@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InventoryComponent.h"
+
+/**
+ * Item Definition
+ * Fields of an item read by the stack, fit and weight code, baked from the item asset into the asset manager table
+ * Kept to a single cache line, presentation and text data stay on the item asset
+ */
+struct alignas(PLATFORM_CACHE_LINE_SIZE) INVENTORYSYSTEM_API FItemDefinition
+{
+	FItemDefinition()
+	{
+		MaxStackSize = 1;
+		Weight = 0.0f;
+		SizeX = 1;
+		SizeY = 1;
+		ConsumedQuantityPerUsage = 1;
+		LootPriority = 0;
+		Type = EItemType::None;
+		PrimaryEquipmentSlot = EEquipmentSlotType::None;
+		SecondaryEquipmentSlot = EEquipmentSlotType::None;
+		bCanBeStacked = false;
+		bCanBeRotated = false;
+		bCanBeDropped = false;
+		bCanBeEquipped = false;
+		bCanBeConsumed = false;
+		bHasItemInstanceBehavior = false;
+		bIsBaked = false;
+	}
+
+	/** Largest quantity a single slot of this item can hold */
+	int32 GetMaxSlotQuantity() const
+	{
+		return bCanBeStacked ? MaxStackSize : 1;
+	}
+
+	FPoint2D GetSize(const bool bIsRotated) const
+	{
+		return bIsRotated ? FPoint2D(SizeY, SizeX) : FPoint2D(SizeX, SizeY);
+	}
+
+	int32 MaxStackSize;
+
+	/** Weight of a single unit, the scaled weight is resolved when baking */
+	float Weight;
+
+	int32 SizeX;
+	int32 SizeY;
+
+	int32 ConsumedQuantityPerUsage;
+	int32 LootPriority;
+
+	EItemType Type;
+	EEquipmentSlotType PrimaryEquipmentSlot;
+	EEquipmentSlotType SecondaryEquipmentSlot;
+
+	uint8 bCanBeStacked : 1;
+
+	/** Resolved from UItem::CanBeRotated, non square items can always be rotated */
+	uint8 bCanBeRotated : 1;
+
+	uint8 bCanBeDropped : 1;
+	uint8 bCanBeEquipped : 1;
+	uint8 bCanBeConsumed : 1;
+
+	/** True if the item instance class overrides blueprint events, slots of this item then get an item instance object */
+	uint8 bHasItemInstanceBehavior : 1;
+
+	/** False until the item asset was loaded, or read from a baked manifest */
+	uint8 bIsBaked : 1;
+};
+
+static_assert(sizeof(FItemDefinition) == PLATFORM_CACHE_LINE_SIZE, "FItemDefinition should fit in a single cache line");
+static_assert(TIsTriviallyDestructible<FItemDefinition>::Value, "FItemDefinition should stay a plain data struct");
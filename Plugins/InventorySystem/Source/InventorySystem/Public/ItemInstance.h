@@ -34,6 +34,10 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "ItemInstance")
 	void OnUsed();
 
+	/** Called when the instance is returned to its pool, after its variables were reset to the class defaults, reset any other state here */
+	UFUNCTION(BlueprintImplementableEvent, Category = "ItemInstance")
+	void OnReset();
+
 	UFUNCTION(BlueprintCallable, Category = "ItemInstance")
 	void Rotate();
 
@@ -45,6 +49,26 @@ public:
 	
 
 	void NotifyItemRotated();
+
+	/** Copies the instance data of the slot owning this object */
+	void SetInstanceData(const FItemInstanceData& InstanceData);
+
+	/** Resets the variables of subclasses to their class defaults, the placement, owner and bound delegates before the instance is returned to its pool */
+	void OnReleasedToPool();
+
+	/**
+	 * Saved along with the slot of the instance, after it was constructed when loading
+	 * Override to save state that isn't part of the item, the data is versioned by the override itself
+	 */
+	virtual void SerializeCustomData(FArchive& Ar);
+
+	virtual bool CanBeInCluster() const override;
+
+	/** True if the class overrides OnConstruct, OnUsed or OnRotated in blueprint */
+	static bool HasBlueprintBehavior(const UClass* ItemInstanceClass);
+
+	/** True if the class declares variables in blueprint, SerializeCustomData doesn't save them */
+	static bool HasBlueprintState(const UClass* ItemInstanceClass);
 	
 	
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = true), Category = "ItemInstance")
@@ -67,5 +91,10 @@ public:
 
 	UPROPERTY(BlueprintAssignable)
 	FItemEvent OnItemRotated;
+
+private:
+
+	/** Cleared once the item changes after the instance was clustered, clusters don't follow changed references */
+	uint8 bCanBeClustered : 1;
 	
 };
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemInstanceSubsystem.generated.h"
+
+class UItemInstance;
+
+/**
+ * Item Instance Pool
+ */
+USTRUCT()
+struct INVENTORYSYSTEM_API FItemInstancePool
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<UItemInstance*> AvailableItemInstances;
+};
+
+/**
+ * UItemInstanceSubsystem
+ * Recycles the item instance objects of slots, per item instance class
+ */
+UCLASS(Config = Game)
+class INVENTORYSYSTEM_API UItemInstanceSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UItemInstanceSubsystem();
+
+	virtual void Deinitialize() override;
+
+	virtual bool CanBeClusterRoot() const override;
+
+	/**
+	 * Returns an item instance of the given class, reusing a pooled one when possible
+	 * The instance isn't constructed yet, see UInventoryComponent::CreateItemInstance
+	 */
+	UFUNCTION(BlueprintCallable, Category = "ItemInstance")
+	UItemInstance* AcquireItemInstance(TSubclassOf<UItemInstance> ItemInstanceClass);
+
+	/** Resets the instance then returns it to its pool, the instance is left to the garbage collector if the pool is full */
+	UFUNCTION(BlueprintCallable, Category = "ItemInstance")
+	void ReleaseItemInstance(UItemInstance* ItemInstance);
+
+	UFUNCTION(BlueprintCallable, Category = "ItemInstance")
+	void PrewarmPool(TSubclassOf<UItemInstance> ItemInstanceClass, int32 Count);
+
+	UFUNCTION(BlueprintPure, Category = "ItemInstance")
+	int32 GetNumPooledItemInstances(TSubclassOf<UItemInstance> ItemInstanceClass) const;
+
+	/** Takes an instance whose references changed out of the cluster, the cluster is dissolved and created again from the other instances */
+	void RemoveFromItemInstanceCluster(UItemInstance* ItemInstance);
+
+	/**
+	 * Times full garbage collections while holding an increasing number of item instances, doubling up to MaxCount
+	 * The instances stay reachable so the time is mostly spent marking, run it with and without bClusterItemInstances
+	 */
+	void BenchmarkGarbageCollection(TSubclassOf<UItemInstance> ItemInstanceClass, int32 MaxCount, int32 NumPasses);
+
+
+	/** Disabling the pool creates a new object for every slot, compare "stat Inventory" with and without it */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "ItemInstance")
+	uint8 bUseItemInstancePool : 1;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0, UIMin = 0, EditCondition = "bUseItemInstancePool"), Category = "ItemInstance")
+	int32 MaxPooledItemInstancesPerClass;
+
+	/**
+	 * Adds every item instance to a garbage collection cluster rooted in this subsystem, marked at once instead of one instance at a time
+	 * Clustered instances are only destroyed along with the world, released ones are always pooled
+	 * Their references are assumed not to change, item instance blueprints must not reference objects that could be destroyed before the world
+	 * Only instances of classes bound to an item are clustered, an instance is taken out of the cluster if a slot of another item uses it
+	 */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (EditCondition = "bUseItemInstancePool"), Category = "ItemInstance")
+	uint8 bClusterItemInstances : 1;
+
+private:
+
+	UItemInstance* NewItemInstance(TSubclassOf<UItemInstance> ItemInstanceClass);
+
+	/** Adds the instance to the cluster of this subsystem, creating the cluster with the first instance */
+	void AddToItemInstanceCluster(UItemInstance* ItemInstance);
+
+	bool IsClusteringItemInstances() const;
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FItemInstancePool> Pools;
+
+	/** Every clustered instance, pooled or not, the cluster is built from the references of its root */
+	UPROPERTY(Transient)
+	TArray<UItemInstance*> ClusteredItemInstances;
+
+	UPROPERTY(Transient)
+	TArray<UItemInstance*> BenchmarkItemInstances;
+
+};
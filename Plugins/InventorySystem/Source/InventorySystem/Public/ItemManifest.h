@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetManager.h"
+#include "ItemDefinition.h"
+
+/**
+ * Item Manifest Entry
+ */
+struct INVENTORYSYSTEM_API FItemManifestEntry
+{
+	FName AssetName;
+	FSoftObjectPath AssetPath;
+	FAssetBundleData BundleData;
+	FItemDefinition Definition;
+};
+
+/**
+ * Item Manifest
+ * Every InventoryItem primary asset with its path, bundles and baked definition, written at cook time by the ItemManifest commandlet
+ * Cooked builds read it in one go instead of scanning the item directories
+ */
+struct INVENTORYSYSTEM_API FItemManifest
+{
+	FItemManifest()
+	{
+		RegistryHash = 0;
+	}
+
+	/** Entries sorted the same way as the item registry, the entry at index I has the identifier I + 1 */
+	TArray<FItemManifestEntry> Items;
+
+	/** Item registry hash of the build the manifest was written for */
+	uint32 RegistryHash;
+
+	bool SaveToFile(const FString& Filename) const;
+	bool LoadFromFile(const FString& Filename);
+
+	void Serialize(FArchive& Ar);
+
+	/** Staged with the cooked content, see DirectoriesToAlwaysStageAsUFS */
+	static FString GetDefaultFilename();
+
+	static const uint32 Magic;
+	static const int32 Version;
+};
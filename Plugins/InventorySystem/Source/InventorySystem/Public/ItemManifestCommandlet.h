@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ItemManifestCommandlet.generated.h"
+
+/**
+ * UItemManifestCommandlet
+ * Writes the item manifest read by cooked builds at startup, run it before staging:
+ * UE4Editor-Cmd.exe Project.uproject -run=ItemManifest [-Output=Path]
+ */
+UCLASS()
+class INVENTORYSYSTEM_API UItemManifestCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UItemManifestCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+	
+};
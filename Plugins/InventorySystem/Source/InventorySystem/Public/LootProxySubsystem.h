@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LootProxySubsystem.generated.h"
+
+class APickup;
+class UItem;
+
+/**
+ * Loot Proxy
+ */
+USTRUCT()
+struct INVENTORYSYSTEM_API FLootProxy
+{
+	GENERATED_BODY()
+
+	FLootProxy()
+	{
+		Item = nullptr;
+		Quantity = 0;
+		ActivePickup = nullptr;
+		Cell = FIntPoint::ZeroValue;
+	}
+
+	UPROPERTY()
+	UItem* Item;
+
+	UPROPERTY()
+	int32 Quantity;
+
+	UPROPERTY()
+	FTransform Transform;
+
+	UPROPERTY(Transient)
+	APickup* ActivePickup;
+
+	FIntPoint Cell;
+
+	bool IsValid() const
+	{
+		return Item != nullptr && Quantity > 0;
+	}
+
+	bool IsActive() const
+	{
+		return ActivePickup != nullptr;
+	}
+};
+
+/**
+ * ULootProxySubsystem
+ * Stores dropped loot as records in a grid, and only keeps pickup actors alive around players
+ */
+UCLASS(Config = Game)
+class INVENTORYSYSTEM_API ULootProxySubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	ULootProxySubsystem();
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Stores a quantity of an item on the ground, merging it into a nearby record of the same item when possible
+	 * A pickup actor is only spawned once a player is within ActivationRadius
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LootProxy")
+	bool AddLoot(UItem* Item, int32 Quantity, const FTransform& Transform);
+
+	UFUNCTION(BlueprintPure, Category = "LootProxy")
+	int32 GetNumLootProxies() const;
+
+	UFUNCTION(BlueprintPure, Category = "LootProxy")
+	int32 GetNumActiveLootProxies() const;
+
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "LootProxy")
+	uint8 bUseLootProxies : 1;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1.0f, UIMin = 1.0f), Category = "LootProxy")
+	float ActivationRadius;
+
+	/** Should be larger than ActivationRadius so pickups don't flicker at the boundary */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1.0f, UIMin = 1.0f), Category = "LootProxy")
+	float DeactivationRadius;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1.0f, UIMin = 1.0f), Category = "LootProxy")
+	float GridCellSize;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0.0f, UIMin = 0.0f), Category = "LootProxy")
+	float UpdateInterval;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1, UIMin = 1), Category = "LootProxy")
+	int32 MaxActivationsPerUpdate;
+
+private:
+
+	void UpdateProxies();
+	void ActivateProxy(int32 ProxyIndex);
+	void DeactivateProxy(int32 ProxyIndex);
+	void RemoveProxy(int32 ProxyIndex);
+
+	void AddProxyToGrid(int32 ProxyIndex);
+	void RemoveProxyFromGrid(int32 ProxyIndex);
+
+	void OnPickupReleased(APickup* Pickup);
+
+	FIntPoint GetGridCell(const FVector& Location) const;
+
+	UPROPERTY()
+	TArray<FLootProxy> Proxies;
+
+	TArray<int32> FreeProxyIndices;
+	TArray<int32> ActiveProxyIndices;
+	TMap<FIntPoint, TArray<int32>> Grid;
+
+	float TimeSinceLastUpdate;
+
+	FDelegateHandle PickupReleasedHandle;
+
+};
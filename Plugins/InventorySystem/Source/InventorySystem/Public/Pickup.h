@@ -6,7 +6,8 @@
 #include "GameFramework/Actor.h"
 #include "Pickup.generated.h"
 
-class UItemInstance;
+class UItem;
+struct FStreamableHandle;
 
 UCLASS(Blueprintable, BlueprintType)
 class INVENTORYSYSTEM_API APickup : public AActor
@@ -18,22 +19,47 @@ public:
 	APickup();
 	
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	void OnPickupDataReceived() const;
+	/** Assigns the item mesh, streaming it in first if it isn't loaded yet */
+	void OnPickupDataReceived();
+	void OnPickupMeshLoaded();
+
+	void OnAcquiredFromPool(const FTransform& Transform);
+	void OnReleasedToPool();
+
+	UFUNCTION()
+	void OnPickupMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName);
 
 	UFUNCTION(BlueprintCallable, Category = "Pickup")
-	void SetPickupData(UItemInstance* InItemInstance, int32 InQuantity);
+	void SetPickupData(UItem* InItem, int32 InQuantity);
 
 	UFUNCTION(BlueprintImplementableEvent, meta = (DisplayName = "OnPickupDataReceived"), Category = "Pickup")
 	void K2_OnPickupDataReceived();
 
 	UPROPERTY(BlueprintReadWrite, Category = "Pickup")
-	UItemInstance* ItemInstance;
+	UItem* Item;
 
 	UPROPERTY(BlueprintReadWrite, Category = "Pickup")
 	int32 Quantity;
 	
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Meta = (AllowPrivateAccess = true), Category = "Pickup")
 	UStaticMeshComponent* PickupMesh;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = "Pickup")
+	uint8 bIsPooled : 1;
+
+	UPROPERTY(Transient)
+	uint8 bWasSimulatingPhysics : 1;
+
+	/** Cell of the pickup subsystem spatial hash this pickup is currently registered in */
+	FIntPoint SpatialHashCell;
+	uint8 bIsInSpatialHash : 1;
+
+	/** Handle of the pending pickup mesh load, cancelled when the pickup data changes */
+	TSharedPtr<FStreamableHandle> PickupMeshHandle;
+
+	/** Index of the loot proxy record this pickup represents, INDEX_NONE if it isn't proxied */
+	int32 LootProxyIndex;
 	
 };
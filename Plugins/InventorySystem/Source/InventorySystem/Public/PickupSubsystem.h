@@ -0,0 +1,156 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tickable.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PickupSubsystem.generated.h"
+
+class APickup;
+class UItem;
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPickupReleased, APickup*);
+
+/**
+ * Pickup Pool
+ */
+USTRUCT()
+struct INVENTORYSYSTEM_API FPickupPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<APickup*> AvailablePickups;
+};
+
+/**
+ * Pending Pickup Spawn
+ */
+USTRUCT()
+struct INVENTORYSYSTEM_API FPendingPickupSpawn
+{
+	GENERATED_BODY()
+
+	FPendingPickupSpawn()
+	{
+		Item = nullptr;
+		Quantity = 0;
+	}
+
+	UPROPERTY()
+	UItem* Item;
+
+	UPROPERTY()
+	int32 Quantity;
+
+	UPROPERTY()
+	FTransform Transform;
+};
+
+/**
+ * UPickupSubsystem
+ */
+UCLASS(Config = Game)
+class INVENTORYSYSTEM_API UPickupSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPickupSubsystem();
+
+	virtual void Deinitialize() override;
+
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+	/**
+	 * Returns an active pickup of the given class, reusing a pooled one when possible
+	 * The first time a class is used its pool is queued to be prewarmed to PrewarmCount within the spawn budget
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Pickup")
+	APickup* AcquirePickup(TSubclassOf<APickup> PickupClass, const FTransform& Transform, UItem* Item, int32 Quantity);
+
+	/** Hides, disables and resets the pickup then returns it to its pool, destroys it if the pool is full */
+	UFUNCTION(BlueprintCallable, Category = "Pickup")
+	void ReleasePickup(APickup* Pickup);
+
+	UFUNCTION(BlueprintCallable, Category = "Pickup")
+	void PrewarmPool(TSubclassOf<APickup> PickupClass, int32 Count);
+
+	UFUNCTION(BlueprintPure, Category = "Pickup")
+	int32 GetNumPooledPickups(TSubclassOf<APickup> PickupClass) const;
+
+	/**
+	 * Drops a quantity of an item into the world, merging it into nearby pickups of the same item first
+	 * Only the quantity that could not be merged spawns a new pickup
+	 *
+	 * @return The pickup that received the last part of the quantity
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Pickup")
+	APickup* SpawnPickup(UItem* Item, int32 Quantity, const FTransform& Transform);
+
+	/** Queues a pickup spawn, queued spawns are processed over the next frames within SpawnBudgetMs */
+	UFUNCTION(BlueprintCallable, Category = "Pickup")
+	void QueuePickupSpawn(UItem* Item, int32 Quantity, const FTransform& Transform);
+
+	UFUNCTION(BlueprintPure, Category = "Pickup")
+	int32 GetNumPendingPickupSpawns() const;
+
+	UFUNCTION(BlueprintCallable, Category = "Pickup")
+	void GetPickupsInRadius(const FVector& Center, float Radius, TArray<APickup*>& OutPickups) const;
+
+	/** Adds the pickup to the spatial hash, or moves it to the cell matching its current location */
+	void RegisterPickup(APickup* Pickup);
+	void UnregisterPickup(APickup* Pickup);
+
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0, UIMin = 0), Category = "Pickup")
+	int32 PrewarmCount;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0, UIMin = 0), Category = "Pickup")
+	int32 MaxPooledPickupsPerClass;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, Category = "Pickup")
+	uint8 bMergeNearbyPickups : 1;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0.0f, UIMin = 0.0f, EditCondition = "bMergeNearbyPickups"), Category = "Pickup")
+	float MergeRadius;
+
+	/** A merged pickup holds at most this many full stacks of its item */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1, UIMin = 1, EditCondition = "bMergeNearbyPickups"), Category = "Pickup")
+	int32 MaxMergedStacks;
+
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 1.0f, UIMin = 1.0f), Category = "Pickup")
+	float SpatialHashCellSize;
+
+	/** Time in milliseconds spent each frame on queued spawns and pool prewarming, at least one spawn is processed per frame */
+	UPROPERTY(Config, EditDefaultsOnly, BlueprintReadOnly, meta = (ClampMin = 0.0f, UIMin = 0.0f), Category = "Pickup")
+	float SpawnBudgetMs;
+
+	/** Called before a pickup is reset and returned to its pool, or destroyed because the pool is full */
+	FOnPickupReleased OnPickupReleased;
+
+private:
+
+	APickup* SpawnPooledPickup(TSubclassOf<APickup> PickupClass) const;
+	APickup* SpawnPickupDeferred(TSubclassOf<APickup> PickupClass, const FTransform& Transform, UItem* Item, int32 Quantity) const;
+
+	FIntPoint GetSpatialHashCell(const FVector& Location) const;
+
+	TMap<FIntPoint, TArray<TWeakObjectPtr<APickup>>> SpatialHash;
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FPickupPool> Pools;
+
+	UPROPERTY(Transient)
+	TArray<FPendingPickupSpawn> PendingSpawns;
+
+	UPROPERTY(Transient)
+	TArray<UClass*> PendingPrewarmClasses;
+
+};
@@ -9,6 +9,7 @@
 
 class UGridWidget;
 class UDraggedSlotWidget;
+struct FStreamableHandle;
 
 /**
  * USlotWidget
@@ -29,6 +30,12 @@ public:
 	UFUNCTION(BlueprintImplementableEvent, Category = "Slot")
 	void OnSlotDataReceived();
 
+	/** Called once the item icon streamed in, by default this calls OnSlotDataReceived again to refresh the slot */
+	UFUNCTION(BlueprintNativeEvent, Category = "Slot")
+	void OnSlotImageLoaded();
+
+	virtual void NativeDestruct() override;
+
 	UFUNCTION(BlueprintImplementableEvent, BlueprintCallable, Category = "Slot")
 	void SetSlotSize(const float NewSize);
 
@@ -51,6 +58,11 @@ public:
 
 	void NativeOnSlotLeftClick();
 	void NativeOnSlotRightClick();
+
+	/** Streams in the icon of the slot item if it isn't loaded yet */
+	void RequestSlotImage();
+	void OnSlotImageStreamed();
+	void CancelSlotImageRequest();
 	
 
 	UFUNCTION(BlueprintImplementableEvent, Category = "Slot")
@@ -82,5 +94,7 @@ public:
 	
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Slot")
 	TSubclassOf<UDraggedSlotWidget> DraggedSlotWidgetClass;
+
+	TSharedPtr<FStreamableHandle> SlotImageHandle;
 	
 };